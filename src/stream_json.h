@@ -1,259 +1,1043 @@
-/**
- * @file stream_json.h
- * @brief Zero-malloc streaming JSON generator for embedded systems
- *
- * This library provides efficient JSON generation without dynamic memory allocation.
- * Uses a fixed buffer with callback-based streaming, allowing unlimited JSON size
- * from minimal RAM.
- *
- * Features:
- * - Zero malloc: All memory from caller-provided buffer
- * - Streaming: Auto-flush callback when buffer fills
- * - Bounded: Predictable memory usage
- * - Portable: Pure C, no platform dependencies
- * - cJSON-compatible API naming
- *
- * Example:
- *   char buffer[512];
- *   sjson_context_t ctx;
- *   sjson_Init(&ctx, buffer, sizeof(buffer), my_send_callback, user_data);
- *   sjson_AddStringToObject(&ctx, "status", "ok");
- *   sjson_AddIntToObject(&ctx, "count", 42);
- *   sjson_End(&ctx);
- */
-
-#ifndef STREAM_JSON_H
-#define STREAM_JSON_H
-
-#include <stddef.h>
-#include <stdbool.h>
-#include <stdint.h>
-
-/**
- * Status codes returned by sjson functions
- */
-typedef enum {
-    SJSON_OK = 0,              /* Operation successful */
-    SJSON_ERROR_INVALID_STATE, /* Operation not valid in current state */
-    SJSON_ERROR_MAX_DEPTH,     /* Maximum nesting depth reached */
-    SJSON_ERROR_BUFFER_FULL,   /* Buffer full and callback failed */
-    SJSON_ERROR_INVALID_PARAM  /* Invalid parameter (NULL pointer, etc) */
-} sjson_status_t;
-
-/**
- * Callback function type for sending JSON chunks
- * @param buffer The buffer containing JSON data
- * @param length The length of data in the buffer
- * @param user_data User data passed to sjson_Init
- * @return true if sending was successful, false otherwise
- */
-typedef bool (*sjson_send_callback_t)(const char *buffer, size_t length, void *user_data);
-
-/**
- * Maximum nesting depth supported
- * Increase if deeper nesting needed (costs 2 bytes per level)
- */
-#define SJSON_MAX_DEPTH 8
-
-typedef struct {
-    char *buffer;
-    size_t buffer_size;
-    size_t used;
-    void *user_data;
-    sjson_send_callback_t send_callback;
-
-    /* Nesting tracking */
-    char depth_stack[SJSON_MAX_DEPTH + 1];  /* Closing chars: '}' or ']' (+1 for root) */
-    uint8_t depth;                           /* Current depth (0 = root) */
-    uint8_t max_depth;                       /* Max allowed depth */
-
-    /* Comma tracking per depth */
-    bool needs_comma[SJSON_MAX_DEPTH + 1];  /* true if next item needs ',' prefix (+1 for root) */
-
-    /* Finalization flag */
-    bool finalized;                          /* true when closed to depth 0 and flushed */
-} sjson_context_t;
-
-
-/* ========================================================================
- * Initialization and Finalization
- * ======================================================================== */
-
-/**
- * Initialize streaming JSON context with root object
- * Opens { and prepares for object members
- * @param ctx Context to initialize
- * @param buffer Pre-allocated buffer for JSON generation
- * @param buffer_size Size of buffer (recommended: 512-2048 bytes)
- * @param callback Function called when buffer fills or on sjson_End()
- * @param user_data Pointer passed to callback (e.g., HTTP response handle)
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_InitObject(sjson_context_t *ctx, char *buffer, size_t buffer_size,
-                                sjson_send_callback_t callback, void *user_data);
-
-/**
- * Initialize streaming JSON context with root array
- * Opens [ and prepares for array elements
- * @param ctx Context to initialize
- * @param buffer Pre-allocated buffer for JSON generation
- * @param buffer_size Size of buffer (recommended: 512-2048 bytes)
- * @param callback Function called when buffer fills or on sjson_End()
- * @param user_data Pointer passed to callback (e.g., HTTP response handle)
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_InitArray(sjson_context_t *ctx, char *buffer, size_t buffer_size,
-                               sjson_send_callback_t callback, void *user_data);
-
-/**
- * Close current collection (object or array)
- * Automatically writes } or ] based on what's open
- * @param ctx JSON context
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_Close(sjson_context_t *ctx);
-
-/**
- * Finalize JSON (close all open collections) and flush remaining data
- * @param ctx JSON context
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_End(sjson_context_t *ctx);
-
-/**
- * Flush JSON buffer via callback without closing collections
- * @param ctx JSON context
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_Flush(sjson_context_t *ctx);
-
-/* ========================================================================
- * Add Items to Object (cJSON-compatible naming)
- * ======================================================================== */
-
-/**
- * Add string to current object
- * @param ctx JSON context
- * @param key Key name
- * @param value String value (will be escaped)
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_AddStringToObject(sjson_context_t *ctx, const char *key, const char *value);
-
-/**
- * Add integer to current object
- * @param ctx JSON context
- * @param key Key name
- * @param value Integer value
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_AddIntToObject(sjson_context_t *ctx, const char *key, int64_t value);
-
-/**
- * Add float to current object
- * @param ctx JSON context
- * @param key Key name
- * @param value Float value
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_AddFloatToObject(sjson_context_t *ctx, const char *key, float value);
-
-/**
- * Add number (int or float) to current object
- * @param ctx JSON context
- * @param key Key name
- * @param value Number value (promoted to double)
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_AddNumberToObject(sjson_context_t *ctx, const char *key, double value);
-
-/**
- * Add integer array to current object
- * @param ctx JSON context
- * @param key Key name
- * @param values Array of integers
- * @param count Number of values
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_AddIntArrayToObject(sjson_context_t *ctx, const char *key,
-                                          const int64_t *values, size_t count);
-
-/**
- * Add float array to current object
- * @param ctx JSON context
- * @param key Key name
- * @param values Array of floats
- * @param count Number of values
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_AddFloatArrayToObject(sjson_context_t *ctx, const char *key,
-                                            const float *values, size_t count);
-
-/**
- * Start nested array in current object
- * @param ctx JSON context
- * @param key Array key name
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_AddArrayToObject(sjson_context_t *ctx, const char *key);
-
-/**
- * Start nested object in current object
- * @param ctx JSON context
- * @param key Object key name
- * @return SJSON_OK or SJSON_ERROR_MAX_DEPTH (not supported yet)
- */
-sjson_status_t sjson_AddObjectToObject(sjson_context_t *ctx, const char *key);
-
-/**
- * Add pre-serialized JSON to current object
- * @param ctx JSON context
- * @param key Key name
- * @param value Pre-serialized JSON string (not escaped)
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_AddRawToObject(sjson_context_t *ctx, const char *key, const char *value);
-
-/* ========================================================================
- * Add Items to Array
- * ======================================================================== */
-
-/**
- * Add integer to current array
- * @param ctx JSON context
- * @param value Integer value
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_AddIntToArray(sjson_context_t *ctx, int64_t value);
-
-/**
- * Add float to current array
- * @param ctx JSON context
- * @param value Float value
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_AddFloatToArray(sjson_context_t *ctx, float value);
-
-/**
- * Add string to current array
- * @param ctx JSON context
- * @param value String value
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_AddStringToArray(sjson_context_t *ctx, const char *value);
-
-/**
- * Start nested object in current array
- * @param ctx JSON context
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_AddObjectToArray(sjson_context_t *ctx);
-
-/**
- * Start nested array in current array
- * @param ctx JSON context
- * @return SJSON_OK or error code
- */
-sjson_status_t sjson_AddArrayToArray(sjson_context_t *ctx);
-
+/**
+ * @file stream_json.h
+ * @brief Zero-malloc streaming JSON generator for embedded systems
+ *
+ * This library provides efficient JSON generation without dynamic memory allocation.
+ * Uses a fixed buffer with callback-based streaming, allowing unlimited JSON size
+ * from minimal RAM.
+ *
+ * Features:
+ * - Zero malloc: All memory from caller-provided buffer
+ * - Streaming: Auto-flush callback when buffer fills
+ * - Bounded: Predictable memory usage
+ * - Portable: Pure C, no platform dependencies
+ * - cJSON-compatible API naming
+ *
+ * Example:
+ *   char buffer[512];
+ *   sjson_context_t ctx;
+ *   sjson_Init(&ctx, buffer, sizeof(buffer), my_send_callback, user_data);
+ *   sjson_AddStringToObject(&ctx, "status", "ok");
+ *   sjson_AddIntToObject(&ctx, "count", 42);
+ *   sjson_End(&ctx);
+ */
+
+#ifndef STREAM_JSON_H
+#define STREAM_JSON_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Status codes returned by sjson functions
+ */
+typedef enum {
+    SJSON_OK = 0,              /* Operation successful */
+    SJSON_ERROR_INVALID_STATE, /* Operation not valid in current state */
+    SJSON_ERROR_MAX_DEPTH,     /* Maximum nesting depth reached */
+    SJSON_ERROR_BUFFER_FULL,   /* Buffer full and callback failed */
+    SJSON_ERROR_INVALID_PARAM, /* Invalid parameter (NULL pointer, etc) */
+    SJSON_WOULD_BLOCK          /* Non-blocking mode: sink full, retry the same call later */
+} sjson_status_t;
+
+typedef struct sjson_context sjson_context_t;
+
+/**
+ * Callback function type for sending JSON chunks
+ * Usually called with the context buffer. Values at least as large as the
+ * buffer (long strings, raw JSON) are passed straight from the caller's
+ * memory instead of being copied through the buffer.
+ * @param buffer The buffer containing JSON data
+ * @param length The length of data in the buffer
+ * @param user_data User data passed to sjson_Init
+ * @return true if sending was successful, false otherwise
+ */
+typedef bool (*sjson_send_callback_t)(const char *buffer, size_t length, void *user_data);
+
+/**
+ * Returned by a non-blocking callback on a hard error
+ */
+#define SJSON_SEND_FAILED ((size_t)-1)
+
+/**
+ * Non-blocking callback function type, see sjson_SetNonBlockingCallback()
+ * @param buffer The buffer containing JSON data
+ * @param length The length of data in the buffer
+ * @param user_data User data passed to sjson_Init
+ * @return Number of bytes accepted from the start of buffer (0 if the sink
+ *         would block), or SJSON_SEND_FAILED
+ */
+typedef size_t (*sjson_send_partial_callback_t)(const char *buffer, size_t length, void *user_data);
+
+/**
+ * Frame format applied to every flush, see sjson_SetFramer()
+ * Header and trailer are written in place, in space reserved inside the
+ * context buffer, so each framed chunk reaches the callback as one span.
+ */
+typedef struct {
+    size_t headroom;  /* Maximum header size, reserved before the data */
+    size_t tailroom;  /* Maximum trailer size, reserved after the data */
+
+    /**
+     * Write the header so that it ends at end, return its size
+     * @param end First byte of the payload
+     * @param length Payload length of this frame
+     * @param first true for the first frame of the document
+     * @param final true for the last frame of the document
+     */
+    size_t (*write_header)(char *end, size_t length, bool first, bool final);
+
+    /**
+     * Write the trailer starting at start, return its size
+     * Parameters as for write_header
+     */
+    size_t (*write_trailer)(char *start, size_t length, bool first, bool final);
+} sjson_framer_t;
+
+/** HTTP/1.1 chunked transfer encoding, terminating chunk on sjson_End() */
+extern const sjson_framer_t sjson_framer_chunked;
+
+/** WebSocket text message (server to client, unmasked), FIN on sjson_End() */
+extern const sjson_framer_t sjson_framer_websocket;
+
+/** 4-byte big-endian length prefix per chunk */
+extern const sjson_framer_t sjson_framer_length_prefix;
+
+/**
+ * Producer step for pull mode, see sjson_InitPullObject()
+ * Emits the next piece of the document (typically one Add call, sjson_Close()
+ * or finally sjson_End()) and returns its status. Advance the producer state
+ * only on SJSON_OK; on SJSON_WOULD_BLOCK the same step is run again with the
+ * next chunk.
+ * @param ctx JSON context to write to
+ * @param state State pointer passed to sjson_InitPullObject()/sjson_InitPullArray()
+ * @return Status of the step
+ */
+typedef sjson_status_t (*sjson_producer_t)(sjson_context_t *ctx, void *state);
+
+/**
+ * One span of output for the vectored callback
+ * Same member order as POSIX struct iovec (iov_base, iov_len)
+ */
+typedef struct {
+    const void *base;
+    size_t len;
+} sjson_iovec_t;
+
+/**
+ * Vectored callback function type, see sjson_SetVectoredCallback()
+ * @param iov Spans to send in order (buffered JSON, then external data)
+ * @param iovcnt Number of spans (1 to 3)
+ * @param user_data User data passed to sjson_Init
+ * @return true if all spans were sent, false otherwise
+ */
+typedef bool (*sjson_sendv_callback_t)(const sjson_iovec_t *iov, size_t iovcnt, void *user_data);
+
+/**
+ * Returned by a read callback on error
+ */
+#define SJSON_READ_FAILED ((size_t)-1)
+
+/**
+ * Read callback type for streamed values, see sjson_AddStreamToObject()
+ * @param buffer Where to store the data (free space of the context buffer)
+ * @param capacity Maximum number of bytes to store
+ * @param state State pointer passed with the callback
+ * @return Number of bytes stored, 0 at end of data, or SJSON_READ_FAILED
+ */
+typedef size_t (*sjson_read_callback_t)(char *buffer, size_t capacity, void *state);
+
+/**
+ * Smallest free space a streamed value is read into; the buffer (after a
+ * framer's headroom and tailroom) must also hold the framer's tailroom on
+ * top of this, see sjson_AddStreamToObject()
+ */
+#define SJSON_STREAM_MIN_SPACE 64
+
+/**
+ * How streamed data is written as a JSON value
+ */
+typedef enum {
+    SJSON_ENCODING_STRING,  /* String, escaped (text) */
+    SJSON_ENCODING_BASE64,  /* String, base64 (binary) */
+    SJSON_ENCODING_RAW      /* Copied verbatim, must already be JSON */
+} sjson_encoding_t;
+
+/**
+ * Maximum nesting depth supported
+ * Increase if deeper nesting needed (costs 2 bytes per level)
+ */
+#define SJSON_MAX_DEPTH 8
+
+/**
+ * Output stage hook, used by optional modules (e.g. stream_json_ring.h)
+ * Called instead of the callbacks. Must consume ctx->buffer[0..ctx->used)
+ * and reset ctx->used; may swap ctx->buffer. ctx->finalized is set for the
+ * last call of a document (from sjson_End()).
+ * @param ctx JSON context being flushed
+ * @param stage Stage state registered with the hook
+ * @param sync true when requested by sjson_Flush()/sjson_End() (also with
+ *        ctx->used == 0), false when the buffer is full
+ * @return SJSON_OK or error code
+ */
+typedef sjson_status_t (*sjson_stage_fn_t)(sjson_context_t *ctx, void *stage, bool sync);
+
+/**
+ * Float precision modes for sjson_SetFloatPrecision()
+ * SJSON_FLOAT_SHORTEST writes the shortest digits that round-trip,
+ * 0..SJSON_FLOAT_MAX_PRECISION writes that many decimals
+ */
+#define SJSON_FLOAT_SHORTEST (-1)
+#define SJSON_FLOAT_MAX_PRECISION 9
+
+/**
+ * Largest scale (digits after the point) of decimal values,
+ * see sjson_AddDecimalToObject()
+ */
+#define SJSON_DECIMAL_MAX_SCALE 18
+
+/**
+ * Maximum encoded size of a pre-encoded key (,"key": with escapes)
+ * Increase if longer keys needed
+ */
+#define SJSON_KEY_MAX_ENCODED 64
+
+/**
+ * Pre-encoded object key, see sjson_KeyInit()
+ */
+typedef struct {
+    size_t length;                      /* Bytes in text */
+    char text[SJSON_KEY_MAX_ENCODED];   /* ,"key": escaped, the comma is skipped when not needed */
+} sjson_key_t;
+
+/**
+ * Placeholder types of a template, see sjson_TemplateCompile()
+ */
+typedef enum {
+    SJSON_HOLE_NONE,        /* Static text only */
+    SJSON_HOLE_INT,         /* %i  .i, int64_t */
+    SJSON_HOLE_UINT,        /* %u  .u, uint64_t */
+    SJSON_HOLE_FLOAT,       /* %f  .f, float (follows sjson_SetFloatPrecision) */
+    SJSON_HOLE_NUMBER,      /* %g  .d, double (shortest) */
+    SJSON_HOLE_DECIMAL,     /* %dN .i, mantissa with scale N (0..18) */
+    SJSON_HOLE_TIMESTAMP,   /* %tN .i, epoch nanoseconds, N fractional digits (0..9) */
+    SJSON_HOLE_STRING,      /* %s  .s, quoted and escaped (NULL writes null) */
+    SJSON_HOLE_RAW,         /* %r  .s, pre-serialized JSON (NULL writes null) */
+    SJSON_HOLE_BOOL         /* %b  .b, true/false */
+} sjson_hole_t;
+
+/**
+ * Value for one template placeholder, member chosen by the placeholder type
+ */
+typedef union {
+    int64_t i;
+    uint64_t u;
+    float f;
+    double d;
+    const char *s;
+    bool b;
+} sjson_value_t;
+
+/**
+ * One step of a compiled template: a static run, then a placeholder
+ */
+typedef struct {
+    const char *run;        /* Static bytes, inside the skeleton */
+    size_t length;
+    uint8_t hole;           /* sjson_hole_t following the run */
+    uint8_t param;          /* Scale or precision */
+} sjson_template_op_t;
+
+/**
+ * Compiled template, see sjson_TemplateCompile()
+ */
+typedef struct {
+    const sjson_template_op_t *ops;
+    size_t op_count;
+    size_t hole_count;      /* Number of values sjson_EmitTemplate() reads */
+} sjson_template_t;
+
+struct sjson_context {
+    char *buffer;
+    size_t buffer_size;
+    size_t used;
+    void *user_data;
+    sjson_send_callback_t send_callback;
+    sjson_sendv_callback_t sendv_callback;  /* Optional, replaces send_callback when set */
+
+    /* Optional output stage replacing the callbacks */
+    sjson_stage_fn_t stage_fn;
+    void *stage;
+
+    /* Non-blocking mode */
+    sjson_send_partial_callback_t partial_callback; /* Optional, replaces send_callback when set */
+    size_t token_start;                      /* Buffer offset where the call in progress started */
+    bool token_comma;                        /* needs_comma before the call in progress */
+
+    /* Pull mode */
+    sjson_producer_t producer;               /* Set by sjson_InitPull*, NULL otherwise */
+    void *producer_state;
+
+    /* Output accounting */
+    bool dry_run;                            /* Count bytes only, see sjson_SetDryRun() */
+    size_t bytes_out;                        /* JSON bytes that have left the buffer */
+
+    /* Protocol framing */
+    const sjson_framer_t *framer;            /* Optional, see sjson_SetFramer() */
+
+    /* Nesting tracking */
+    char depth_stack[SJSON_MAX_DEPTH + 1];  /* Closing chars: '}' or ']' (+1 for root) */
+    uint8_t depth;                           /* Current depth (0 = root) */
+    uint8_t max_depth;                       /* Max allowed depth */
+
+    /* Comma tracking per depth */
+    bool needs_comma[SJSON_MAX_DEPTH + 1];  /* true if next item needs ',' prefix (+1 for root) */
+
+    /* Finalization flag */
+    bool finalized;                          /* true when closed to depth 0 and flushed */
+
+    /* Incremental string value */
+    bool in_string;                          /* Between sjson_BeginString* and sjson_EndString */
+
+    /* Float formatting */
+    int8_t float_precision;                  /* SJSON_FLOAT_SHORTEST or fixed decimals */
+    bool float_trim_zeros;                   /* Drop trailing zeros in fixed mode */
+
+    /* Timestamp formatting: date and time of the last second written */
+    int64_t ts_second;                       /* Epoch second of ts_prefix, INT64_MIN if none */
+    char ts_prefix[19];                      /* "YYYY-MM-DDTHH:MM:SS" */
+};
+
+
+/* ========================================================================
+ * Initialization and Finalization
+ * ======================================================================== */
+
+/**
+ * Initialize streaming JSON context with root object
+ * Opens { and prepares for object members
+ * @param ctx Context to initialize
+ * @param buffer Pre-allocated buffer for JSON generation
+ * @param buffer_size Size of buffer (recommended: 512-2048 bytes)
+ * @param callback Function called when buffer fills or on sjson_End()
+ * @param user_data Pointer passed to callback (e.g., HTTP response handle)
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_InitObject(sjson_context_t *ctx, char *buffer, size_t buffer_size,
+                                sjson_send_callback_t callback, void *user_data);
+
+/**
+ * Initialize streaming JSON context with root array
+ * Opens [ and prepares for array elements
+ * @param ctx Context to initialize
+ * @param buffer Pre-allocated buffer for JSON generation
+ * @param buffer_size Size of buffer (recommended: 512-2048 bytes)
+ * @param callback Function called when buffer fills or on sjson_End()
+ * @param user_data Pointer passed to callback (e.g., HTTP response handle)
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_InitArray(sjson_context_t *ctx, char *buffer, size_t buffer_size,
+                               sjson_send_callback_t callback, void *user_data);
+
+/**
+ * Initialize context in pull mode with root object
+ * Nothing is written until sjson_Pull(); the producer then generates the
+ * document step by step directly into the caller's chunks.
+ * @param ctx Context to initialize
+ * @param producer Step function, called repeatedly from sjson_Pull()
+ * @param state Pointer passed to producer
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_InitPullObject(sjson_context_t *ctx, sjson_producer_t producer, void *state);
+
+/**
+ * Initialize context in pull mode with root array
+ * @param ctx Context to initialize
+ * @param producer Step function, called repeatedly from sjson_Pull()
+ * @param state Pointer passed to producer
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_InitPullArray(sjson_context_t *ctx, sjson_producer_t producer, void *state);
+
+/**
+ * Get the next chunk of a pull mode document
+ * Runs producer steps until the next step does not fit into out.
+ * Each producer step must fit into capacity bytes on its own.
+ * @param ctx JSON context (after sjson_InitPullObject/Array)
+ * @param out Caller memory to write the chunk to
+ * @param capacity Size of out
+ * @param length Receives the chunk length, 0 once the document is complete
+ * @return SJSON_OK or error code (e.g. from the producer)
+ */
+sjson_status_t sjson_Pull(sjson_context_t *ctx, char *out, size_t capacity, size_t *length);
+
+/**
+ * Close current collection (object or array)
+ * Automatically writes } or ] based on what's open
+ * @param ctx JSON context
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_Close(sjson_context_t *ctx);
+
+/**
+ * Finalize JSON (close all open collections) and flush remaining data
+ * @param ctx JSON context
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_End(sjson_context_t *ctx);
+
+/**
+ * Flush JSON buffer via callback without closing collections
+ * @param ctx JSON context
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_Flush(sjson_context_t *ctx);
+
+/**
+ * Enable dry-run mode: the document is formatted and escaped as usual, but
+ * nothing is copied or sent, only counted. Use it to compute an exact
+ * Content-Length before serializing the same document for real.
+ *   sjson_InitObject(&ctx, buf, sizeof(buf), cb, NULL);
+ *   sjson_SetDryRun(&ctx, true);
+ *   build_document(&ctx);
+ *   sjson_End(&ctx);
+ *   size_t content_length = sjson_GetByteCount(&ctx);
+ * @param ctx JSON context (right after Init, not with non-blocking mode or a stage)
+ * @param enable true to count only
+ * @return SJSON_OK, or SJSON_ERROR_INVALID_STATE once anything has been
+ *         added to the document (dry run cannot be switched mid-document)
+ */
+sjson_status_t sjson_SetDryRun(sjson_context_t *ctx, bool enable);
+
+/**
+ * Wrap every flushed chunk in a protocol frame, e.g. sjson_framer_chunked
+ * The headroom and tailroom are carved out of the Init buffer, so frames are
+ * built in place and sent without copying. sjson_End() emits the final frame
+ * (terminating chunk, WebSocket FIN).
+ * @param ctx JSON context (right after Init, plain or vectored callback only)
+ * @param framer Frame format
+ * @return SJSON_OK, SJSON_ERROR_INVALID_PARAM if the buffer is too small
+ *         for the framer, or SJSON_ERROR_INVALID_STATE if output was sent
+ */
+sjson_status_t sjson_SetFramer(sjson_context_t *ctx, const sjson_framer_t *framer);
+
+/**
+ * Get the number of JSON bytes produced since Init (sent plus buffered)
+ * @param ctx JSON context
+ * @return Byte count, exact in dry-run mode and in every other mode
+ */
+size_t sjson_GetByteCount(const sjson_context_t *ctx);
+
+/**
+ * Switch the context to non-blocking mode
+ * The callback may accept only part of a chunk, or nothing. Unsent bytes stay
+ * in the buffer. A call that cannot get buffer space returns SJSON_WOULD_BLOCK
+ * without any effect on the document; repeat the same call once the sink is
+ * writable again (e.g. after EPOLLOUT). sjson_Flush() and sjson_End() return
+ * SJSON_WOULD_BLOCK while data is pending; call them again to continue.
+ * Each call must fit in the buffer on its own, larger calls (e.g. long
+ * strings, big arrays) fail with SJSON_ERROR_BUFFER_FULL. After
+ * sjson_BeginValueInObject()/sjson_BeginValueInArray(), a NULL from
+ * sjson_Reserve() means the whole value must be retried from the Begin call.
+ * @param ctx JSON context (after Init, not with an output stage)
+ * @param callback Non-blocking callback, or NULL for blocking mode
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_SetNonBlockingCallback(sjson_context_t *ctx, sjson_send_partial_callback_t callback);
+
+/**
+ * Send all output through a vectored callback instead of the one given to Init
+ * A flush that passes a large value without copying (see sjson_send_callback_t)
+ * then delivers the buffered bytes and the value in one call, e.g. one writev().
+ * @param ctx JSON context (after Init)
+ * @param callback Vectored callback, or NULL to go back to the plain callback
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_SetVectoredCallback(sjson_context_t *ctx, sjson_sendv_callback_t callback);
+
+/**
+ * Set how float values are formatted (sjson_AddFloatToObject,
+ * sjson_AddFloatToArray, float and half array writers)
+ * Fixed precision uses integer arithmetic only, e.g. 2 decimals: 23.45
+ * @param ctx JSON context (after Init, default SJSON_FLOAT_SHORTEST)
+ * @param decimals SJSON_FLOAT_SHORTEST or 0..SJSON_FLOAT_MAX_PRECISION
+ * @param trim_zeros Drop trailing zeros in fixed mode (23.50 -> 23.5, 23.00 -> 23)
+ * @return SJSON_OK or SJSON_ERROR_INVALID_PARAM
+ */
+sjson_status_t sjson_SetFloatPrecision(sjson_context_t *ctx, int decimals, bool trim_zeros);
+
+/* ========================================================================
+ * Add Items to Object (cJSON-compatible naming)
+ * ======================================================================== */
+
+/**
+ * Add string to current object
+ * @param ctx JSON context
+ * @param key Key name
+ * @param value String value (will be escaped)
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddStringToObject(sjson_context_t *ctx, const char *key, const char *value);
+
+/**
+ * Add integer to current object
+ * @param ctx JSON context
+ * @param key Key name
+ * @param value Integer value
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddIntToObject(sjson_context_t *ctx, const char *key, int64_t value);
+
+/**
+ * Add float to current object
+ * Written with the shortest digits that round-trip to the same float
+ * @param ctx JSON context
+ * @param key Key name
+ * @param value Float value (NaN/infinity written as null)
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddFloatToObject(sjson_context_t *ctx, const char *key, float value);
+
+/**
+ * Add number (int or float) to current object
+ * Written with the shortest digits that round-trip to the same double
+ * @param ctx JSON context
+ * @param key Key name
+ * @param value Number value (promoted to double, NaN/infinity written as null)
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddNumberToObject(sjson_context_t *ctx, const char *key, double value);
+
+/**
+ * Add fixed-point decimal (mantissa / 10^scale) to current object
+ * For readings stored as scaled integers: (2345, 2) writes 23.45, (-5, 3)
+ * writes -0.005. Exact, integer arithmetic only; always scale decimals.
+ * @param ctx JSON context
+ * @param key Key name
+ * @param mantissa Scaled integer value
+ * @param scale Digits after the point, 0..SJSON_DECIMAL_MAX_SCALE
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddDecimalToObject(sjson_context_t *ctx, const char *key,
+                                        int64_t mantissa, unsigned scale);
+
+/**
+ * Add RFC 3339 UTC timestamp string to current object, e.g.
+ * "2025-03-14T15:09:26.535Z" for precision 3
+ * Date and time of the last second written are kept in the context, so
+ * records within the same second only format the fraction.
+ * @param ctx JSON context
+ * @param key Key name
+ * @param epoch_ns Nanoseconds since 1970-01-01T00:00:00Z (negative before)
+ * @param precision Fractional second digits 0..9 (3 = ms, 6 = us, 9 = ns), truncated
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddTimestampToObject(sjson_context_t *ctx, const char *key,
+                                          int64_t epoch_ns, unsigned precision);
+
+/**
+ * Add integer array to current object
+ * @param ctx JSON context
+ * @param key Key name
+ * @param values Array of integers
+ * @param count Number of values
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddIntArrayToObject(sjson_context_t *ctx, const char *key,
+                                          const int64_t *values, size_t count);
+
+/**
+ * Add float array to current object
+ * @param ctx JSON context
+ * @param key Key name
+ * @param values Array of floats
+ * @param count Number of values
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddFloatArrayToObject(sjson_context_t *ctx, const char *key,
+                                            const float *values, size_t count);
+
+/**
+ * Add integer array to current object from every stride bytes of memory
+ * For a field of an array of structs, without gathering it first:
+ *   sjson_AddIntArrayStridedToObject(&ctx, "ts", &samples[0].ts, sizeof(samples[0]), 360);
+ * @param ctx JSON context
+ * @param key Key name
+ * @param base Address of the first int64_t (any alignment)
+ * @param stride Distance in bytes between consecutive values
+ * @param count Number of values
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddIntArrayStridedToObject(sjson_context_t *ctx, const char *key,
+                                                const void *base, size_t stride, size_t count);
+
+/**
+ * Add float array to current object from every stride bytes of memory
+ * @param ctx JSON context
+ * @param key Key name
+ * @param base Address of the first float (any alignment)
+ * @param stride Distance in bytes between consecutive values
+ * @param count Number of values
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddFloatArrayStridedToObject(sjson_context_t *ctx, const char *key,
+                                                  const void *base, size_t stride, size_t count);
+
+/**
+ * Typed array writers for the other element types, used like
+ * sjson_AddIntArrayToObject() and sjson_AddIntArrayStridedToObject().
+ * Each type is formatted at its native width, without widening copies.
+ * Half values are IEEE 754 binary16 passed as raw bits and, like float,
+ * follow sjson_SetFloatPrecision(); doubles are always written shortest.
+ */
+sjson_status_t sjson_AddInt8ArrayToObject(sjson_context_t *ctx, const char *key,
+                                          const int8_t *values, size_t count);
+sjson_status_t sjson_AddInt8ArrayStridedToObject(sjson_context_t *ctx, const char *key,
+                                                 const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddInt16ArrayToObject(sjson_context_t *ctx, const char *key,
+                                           const int16_t *values, size_t count);
+sjson_status_t sjson_AddInt16ArrayStridedToObject(sjson_context_t *ctx, const char *key,
+                                                  const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddInt32ArrayToObject(sjson_context_t *ctx, const char *key,
+                                           const int32_t *values, size_t count);
+sjson_status_t sjson_AddInt32ArrayStridedToObject(sjson_context_t *ctx, const char *key,
+                                                  const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddUInt8ArrayToObject(sjson_context_t *ctx, const char *key,
+                                           const uint8_t *values, size_t count);
+sjson_status_t sjson_AddUInt8ArrayStridedToObject(sjson_context_t *ctx, const char *key,
+                                                  const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddUInt16ArrayToObject(sjson_context_t *ctx, const char *key,
+                                            const uint16_t *values, size_t count);
+sjson_status_t sjson_AddUInt16ArrayStridedToObject(sjson_context_t *ctx, const char *key,
+                                                   const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddUInt32ArrayToObject(sjson_context_t *ctx, const char *key,
+                                            const uint32_t *values, size_t count);
+sjson_status_t sjson_AddUInt32ArrayStridedToObject(sjson_context_t *ctx, const char *key,
+                                                   const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddUInt64ArrayToObject(sjson_context_t *ctx, const char *key,
+                                            const uint64_t *values, size_t count);
+sjson_status_t sjson_AddUInt64ArrayStridedToObject(sjson_context_t *ctx, const char *key,
+                                                   const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddDoubleArrayToObject(sjson_context_t *ctx, const char *key,
+                                            const double *values, size_t count);
+sjson_status_t sjson_AddDoubleArrayStridedToObject(sjson_context_t *ctx, const char *key,
+                                                   const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddHalfArrayToObject(sjson_context_t *ctx, const char *key,
+                                          const uint16_t *values, size_t count);
+sjson_status_t sjson_AddHalfArrayStridedToObject(sjson_context_t *ctx, const char *key,
+                                                 const void *base, size_t stride, size_t count);
+
+/**
+ * Add array of decimals with a common scale to current object
+ * (see sjson_AddDecimalToObject())
+ * @param ctx JSON context
+ * @param key Key name
+ * @param mantissas Scaled integer values
+ * @param count Number of values
+ * @param scale Digits after the point, 0..SJSON_DECIMAL_MAX_SCALE
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddDecimalArrayToObject(sjson_context_t *ctx, const char *key,
+                                             const int64_t *mantissas, size_t count,
+                                             unsigned scale);
+
+/**
+ * Add array of decimals from every stride bytes of memory
+ * @param ctx JSON context
+ * @param key Key name
+ * @param base Address of the first int64_t mantissa (any alignment)
+ * @param stride Distance in bytes between consecutive values
+ * @param count Number of values
+ * @param scale Digits after the point, 0..SJSON_DECIMAL_MAX_SCALE
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddDecimalArrayStridedToObject(sjson_context_t *ctx, const char *key,
+                                                    const void *base, size_t stride,
+                                                    size_t count, unsigned scale);
+
+/**
+ * Start nested array in current object
+ * @param ctx JSON context
+ * @param key Array key name
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddArrayToObject(sjson_context_t *ctx, const char *key);
+
+/**
+ * Start nested object in current object
+ * @param ctx JSON context
+ * @param key Object key name
+ * @return SJSON_OK, SJSON_ERROR_MAX_DEPTH if SJSON_MAX_DEPTH levels (root
+ *         included) are already open, or error code
+ */
+sjson_status_t sjson_AddObjectToObject(sjson_context_t *ctx, const char *key);
+
+/**
+ * Add pre-serialized JSON to current object
+ * @param ctx JSON context
+ * @param key Key name
+ * @param value Pre-serialized JSON string (not escaped)
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddRawToObject(sjson_context_t *ctx, const char *key, const char *value);
+
+/**
+ * Add binary data to current object as a base64 string (RFC 4648, padded)
+ * Encoded in batches straight into the buffer; data of any size is fine.
+ * @param ctx JSON context
+ * @param key Key name
+ * @param data Bytes to encode
+ * @param length Number of bytes
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddBase64ToObject(sjson_context_t *ctx, const char *key, const void *data, size_t length);
+
+/* ========================================================================
+ * Add Items to Array
+ * ======================================================================== */
+
+/**
+ * Add integer to current array
+ * @param ctx JSON context
+ * @param value Integer value
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddIntToArray(sjson_context_t *ctx, int64_t value);
+
+/**
+ * Add float to current array
+ * @param ctx JSON context
+ * @param value Float value
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddFloatToArray(sjson_context_t *ctx, float value);
+
+/**
+ * Add fixed-point decimal (mantissa / 10^scale) to current array
+ * @param ctx JSON context
+ * @param mantissa Scaled integer value
+ * @param scale Digits after the point, 0..SJSON_DECIMAL_MAX_SCALE
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddDecimalToArray(sjson_context_t *ctx, int64_t mantissa, unsigned scale);
+
+/**
+ * Add RFC 3339 UTC timestamp string to current array
+ * (see sjson_AddTimestampToObject())
+ * @param ctx JSON context
+ * @param epoch_ns Nanoseconds since 1970-01-01T00:00:00Z
+ * @param precision Fractional second digits 0..9
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddTimestampToArray(sjson_context_t *ctx, int64_t epoch_ns, unsigned precision);
+
+/**
+ * Add string to current array
+ * @param ctx JSON context
+ * @param value String value
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddStringToArray(sjson_context_t *ctx, const char *value);
+
+/**
+ * Add binary data to current array as a base64 string (RFC 4648, padded)
+ * @param ctx JSON context
+ * @param data Bytes to encode
+ * @param length Number of bytes
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddBase64ToArray(sjson_context_t *ctx, const void *data, size_t length);
+
+/**
+ * Start nested object in current array
+ * @param ctx JSON context
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddObjectToArray(sjson_context_t *ctx);
+
+/**
+ * Start nested array in current array
+ * @param ctx JSON context
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AddArrayToArray(sjson_context_t *ctx);
+
+/* ========================================================================
+ * Incremental Strings
+ * For string values produced piecewise (log tails, UART input): begin the
+ * value, append any number of pieces, end it. Pieces are escaped on the fly,
+ * so the value can be longer than the buffer. No other value may be added
+ * until sjson_EndString().
+ * ======================================================================== */
+
+/**
+ * Write comma (if needed), "key": and the opening quote in the current object
+ * @param ctx JSON context
+ * @param key Key name
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_BeginStringInObject(sjson_context_t *ctx, const char *key);
+
+/**
+ * Write comma (if needed) and the opening quote in the current array
+ * @param ctx JSON context
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_BeginStringInArray(sjson_context_t *ctx);
+
+/**
+ * Append a piece to the open string value (escaped, may contain '\0')
+ * In non-blocking mode each piece must fit in the buffer; on
+ * SJSON_WOULD_BLOCK retry the same append.
+ * @param ctx JSON context (after sjson_BeginStringInObject/InArray)
+ * @param str Piece to append (UTF-8 may be split across pieces)
+ * @param length Piece length in bytes
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_AppendString(sjson_context_t *ctx, const char *str, size_t length);
+
+/**
+ * Write the closing quote of the open string value
+ * @param ctx JSON context
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_EndString(sjson_context_t *ctx);
+
+/* ========================================================================
+ * Streamed Values
+ * The value is read piece by piece straight into the free space of the
+ * buffer and escaped or base64-encoded there in place, so data of any size
+ * (files, sockets, flash) is embedded without a second buffer. Not
+ * available in non-blocking or pull mode. For file descriptors see
+ * stream_json_fd.h.
+ *
+ * Minimum buffer: SJSON_STREAM_MIN_SPACE (64) bytes. With a framer the
+ * whole buffer must be headroom + 2 * tailroom + 64 bytes, e.g. 96 for
+ * sjson_framer_chunked (18 + 2 * 7 + 64) or 74 for sjson_framer_websocket;
+ * smaller buffers fail with SJSON_ERROR_INVALID_PARAM, although other
+ * values still fit.
+ * ======================================================================== */
+
+/**
+ * Add a value read from a callback to the current object
+ * @param ctx JSON context
+ * @param key Key name
+ * @param reader Called until it returns 0 (end of data)
+ * @param state Pointer passed to reader
+ * @param encoding How the data is written
+ * @return SJSON_OK, SJSON_ERROR_BUFFER_FULL if reader or callback failed
+ *         (the document is then incomplete), SJSON_ERROR_INVALID_PARAM if
+ *         the buffer is below the minimum above, SJSON_ERROR_INVALID_STATE
+ *         in non-blocking mode, or other error code
+ */
+sjson_status_t sjson_AddStreamToObject(sjson_context_t *ctx, const char *key,
+                                       sjson_read_callback_t reader, void *state,
+                                       sjson_encoding_t encoding);
+
+/**
+ * Add a value read from a callback to the current array
+ * @param ctx JSON context
+ * @param reader Called until it returns 0 (end of data)
+ * @param state Pointer passed to reader
+ * @param encoding How the data is written
+ * @return SJSON_OK or error code, as for sjson_AddStreamToObject()
+ */
+sjson_status_t sjson_AddStreamToArray(sjson_context_t *ctx, sjson_read_callback_t reader, void *state,
+                                      sjson_encoding_t encoding);
+
+/* ========================================================================
+ * Pre-encoded Keys
+ * ======================================================================== */
+
+/**
+ * Escape and quote a key once, for the ...ByKey object writers
+ * In hot loops the same few keys are written over and over; a pre-encoded
+ * key is copied together with its comma in one go, without strlen() or
+ * escaping. The key handle does not refer to name and can be shared by
+ * any number of contexts.
+ * @param key Key handle to initialize
+ * @param name Key name
+ * @return SJSON_OK or SJSON_ERROR_INVALID_PARAM (empty name, or encoded key
+ *         longer than SJSON_KEY_MAX_ENCODED)
+ */
+sjson_status_t sjson_KeyInit(sjson_key_t *key, const char *name);
+
+/**
+ * Object writers taking a pre-encoded key, used like the variants without
+ * the ByKey suffix.
+ */
+sjson_status_t sjson_AddStringToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key, const char *value);
+sjson_status_t sjson_AddIntToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key, int64_t value);
+sjson_status_t sjson_AddFloatToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key, float value);
+sjson_status_t sjson_AddNumberToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key, double value);
+sjson_status_t sjson_AddDecimalToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                             int64_t mantissa, unsigned scale);
+sjson_status_t sjson_AddTimestampToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                               int64_t epoch_ns, unsigned precision);
+sjson_status_t sjson_AddArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key);
+sjson_status_t sjson_AddObjectToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key);
+sjson_status_t sjson_AddRawToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key, const char *value);
+sjson_status_t sjson_AddBase64ToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                            const void *data, size_t length);
+sjson_status_t sjson_BeginValueInObjectByKey(sjson_context_t *ctx, const sjson_key_t *key);
+sjson_status_t sjson_BeginStringInObjectByKey(sjson_context_t *ctx, const sjson_key_t *key);
+sjson_status_t sjson_AddStreamToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                            sjson_read_callback_t reader, void *state,
+                                            sjson_encoding_t encoding);
+
+sjson_status_t sjson_AddIntArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                              const int64_t *values, size_t count);
+sjson_status_t sjson_AddIntArrayStridedToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                     const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddFloatArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                const float *values, size_t count);
+sjson_status_t sjson_AddFloatArrayStridedToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                       const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddInt8ArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                               const int8_t *values, size_t count);
+sjson_status_t sjson_AddInt8ArrayStridedToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                      const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddInt16ArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                const int16_t *values, size_t count);
+sjson_status_t sjson_AddInt16ArrayStridedToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                       const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddInt32ArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                const int32_t *values, size_t count);
+sjson_status_t sjson_AddInt32ArrayStridedToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                       const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddUInt8ArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                const uint8_t *values, size_t count);
+sjson_status_t sjson_AddUInt8ArrayStridedToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                       const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddUInt16ArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                 const uint16_t *values, size_t count);
+sjson_status_t sjson_AddUInt16ArrayStridedToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                        const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddUInt32ArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                 const uint32_t *values, size_t count);
+sjson_status_t sjson_AddUInt32ArrayStridedToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                        const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddUInt64ArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                 const uint64_t *values, size_t count);
+sjson_status_t sjson_AddUInt64ArrayStridedToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                        const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddDoubleArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                 const double *values, size_t count);
+sjson_status_t sjson_AddDoubleArrayStridedToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                        const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddHalfArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                               const uint16_t *values, size_t count);
+sjson_status_t sjson_AddHalfArrayStridedToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                      const void *base, size_t stride, size_t count);
+sjson_status_t sjson_AddDecimalArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                  const int64_t *mantissas, size_t count,
+                                                  unsigned scale);
+sjson_status_t sjson_AddDecimalArrayStridedToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                         const void *base, size_t stride,
+                                                         size_t count, unsigned scale);
+
+/* ========================================================================
+ * Templates
+ *
+ * Documents of a fixed shape are compiled once from a JSON skeleton with
+ * typed placeholders, then emitted with one state check: static runs are
+ * copied, only the placeholders are formatted.
+ *   static sjson_template_op_t ops[4];
+ *   sjson_template_t tmpl;
+ *   sjson_TemplateCompile(&tmpl, "\"id\":%i,\"temp\":%d2,\"ts\":%t3", ops, 4);
+ *
+ *   sjson_value_t v[3];
+ *   v[0].i = id; v[1].i = centi_degrees; v[2].i = epoch_ns;
+ *   sjson_EmitTemplate(&ctx, &tmpl, v);
+ * ======================================================================== */
+
+/**
+ * Compile a skeleton into static runs and placeholders
+ * The skeleton is JSON text (copied as is, not validated) with placeholders
+ * %i %u %f %g %dN %tN %s %r %b (see sjson_hole_t); %% writes a '%'.
+ * @param tmpl Template to initialize
+ * @param skeleton Template text, must stay valid while the template is used
+ * @param ops Storage for the compiled steps: one per placeholder and per %%,
+ *        plus one
+ * @param max_ops Number of elements in ops
+ * @return SJSON_OK or SJSON_ERROR_INVALID_PARAM (unknown placeholder, scale
+ *         or precision out of range, ops too small)
+ */
+sjson_status_t sjson_TemplateCompile(sjson_template_t *tmpl, const char *skeleton,
+                                     sjson_template_op_t *ops, size_t max_ops);
+
+/**
+ * Write a compiled template into the current object or array
+ * Adds a comma first if needed, like one Add call. In an object the
+ * template holds members ("a":%i,"b":%g), in an array values ({"a":%i}).
+ * @param ctx JSON context
+ * @param tmpl Compiled template
+ * @param values One value per placeholder, in order
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_EmitTemplate(sjson_context_t *ctx, const sjson_template_t *tmpl,
+                                  const sjson_value_t *values);
+
+/* ========================================================================
+ * Low-level Output (custom value formatters)
+ *
+ * Start a value with sjson_BeginValueInObject()/sjson_BeginValueInArray(),
+ * then write its bytes with plain stores:
+ *   char *p = sjson_Reserve(&ctx, 8);
+ *   if (p) { memcpy(p, "\"0xBEEF\"", 8); sjson_Commit(&ctx, 8); }
+ * Bytes written this way are not escaped or validated.
+ * ======================================================================== */
+
+/**
+ * Write comma (if needed) and "key": in the current object
+ * The caller must then write exactly one JSON value via sjson_Reserve()
+ * @param ctx JSON context
+ * @param key Key name
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_BeginValueInObject(sjson_context_t *ctx, const char *key);
+
+/**
+ * Write comma (if needed) in the current array
+ * The caller must then write exactly one JSON value via sjson_Reserve()
+ * @param ctx JSON context
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_BeginValueInArray(sjson_context_t *ctx);
+
+/**
+ * Slow path of sjson_Reserve(): flushes the buffer to make room
+ * @param ctx JSON context
+ * @param n Number of contiguous bytes needed
+ * @return Pointer to n free bytes, or NULL if n > buffer size or flush failed
+ */
+char *sjson_ReserveSlow(sjson_context_t *ctx, size_t n);
+
+/**
+ * Get a pointer to n contiguous free bytes in the buffer
+ * Only flushes when the buffer does not have n bytes left.
+ * @param ctx JSON context
+ * @param n Number of bytes needed (at most the buffer size)
+ * @return Pointer to write to, or NULL on flush failure / n too large
+ */
+static inline char *sjson_Reserve(sjson_context_t *ctx, size_t n)
+{
+    if (ctx->buffer_size - ctx->used >= n)
+    {
+        return ctx->buffer + ctx->used;
+    }
+    return sjson_ReserveSlow(ctx, n);
+}
+
+/**
+ * Mark n bytes written after sjson_Reserve() as used
+ * @param ctx JSON context
+ * @param n Number of bytes written (at most the reserved amount)
+ */
+static inline void sjson_Commit(sjson_context_t *ctx, size_t n)
+{
+    ctx->used += n;
+}
+
 #endif /* STREAM_JSON_H */
\ No newline at end of file
@@ -0,0 +1,200 @@
+/**
+ * @file stream_json_deflate.c
+ * @brief Streaming deflate/gzip output stage
+ *
+ * zlib allocates everything it needs once in deflateInit2() and only resets
+ * it in deflateReset(), so a bump allocator over the caller's work area is
+ * sufficient and free() can be a no-op.
+ */
+#include "stream_json_deflate.h"
+
+/* ========================================================================
+ * Internal Helper Functions
+ * ======================================================================== */
+
+#define WORK_ALIGN 16
+
+static voidpf work_alloc(voidpf opaque, uInt items, uInt size)
+{
+    sjson_deflate_t *z = (sjson_deflate_t *)opaque;
+    size_t offset = (z->work_used + WORK_ALIGN - 1) & ~(size_t)(WORK_ALIGN - 1);
+    size_t bytes = (size_t)items * size;
+
+    if (offset > z->work_size || bytes > z->work_size - offset)
+    {
+        return Z_NULL;
+    }
+
+    z->work_used = offset + bytes;
+    return z->work + offset;
+}
+
+static void work_free(voidpf opaque, voidpf address)
+{
+    (void)opaque;
+    (void)address;
+}
+
+/* Pass the collected compressed bytes to the callback (vectored if one is set) */
+static sjson_status_t send_out(sjson_context_t *ctx, sjson_deflate_t *z)
+{
+    if (z->out_used == 0)
+    {
+        return SJSON_OK;
+    }
+
+    bool ok;
+    if (ctx->sendv_callback)
+    {
+        sjson_iovec_t iov = { z->out, z->out_used };
+        ok = ctx->sendv_callback(&iov, 1, ctx->user_data);
+    }
+    else
+    {
+        ok = ctx->send_callback(z->out, z->out_used, ctx->user_data);
+    }
+    z->out_used = 0;
+    return ok ? SJSON_OK : SJSON_ERROR_BUFFER_FULL;
+}
+
+/*
+ * Stage hook: compress the buffer. A full buffer is only compressed, output
+ * goes out whenever the out buffer fills; sjson_Flush() adds a sync flush and
+ * sjson_End() finishes the stream.
+ */
+static sjson_status_t deflate_stage(sjson_context_t *ctx, void *stage, bool sync)
+{
+    sjson_deflate_t *z = (sjson_deflate_t *)stage;
+    int flush = ctx->finalized ? Z_FINISH : (sync ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+    int ret;
+
+    z->strm.next_in = (Bytef *)ctx->buffer;
+    z->strm.avail_in = (uInt)ctx->used;
+    ctx->used = 0;
+
+    for (;;)
+    {
+        z->strm.next_out = (Bytef *)z->out + z->out_used;
+        z->strm.avail_out = (uInt)(z->out_size - z->out_used);
+
+        ret = deflate(&z->strm, flush);
+        if (ret == Z_STREAM_ERROR)
+        {
+            return SJSON_ERROR_INVALID_STATE;
+        }
+        z->out_used = z->out_size - z->strm.avail_out;
+
+        // Space left over means deflate has nothing more for now
+        if (z->strm.avail_out != 0 && (flush != Z_FINISH || ret == Z_STREAM_END))
+        {
+            break;
+        }
+
+        sjson_status_t status = send_out(ctx, z);
+        if (status != SJSON_OK)
+        {
+            return status;
+        }
+    }
+
+    return (flush == Z_NO_FLUSH) ? SJSON_OK : send_out(ctx, z);
+}
+
+/* ========================================================================
+ * Public API
+ * ======================================================================== */
+
+sjson_status_t sjson_DeflateInit(sjson_deflate_t *z, sjson_deflate_format_t format, int level,
+                                 int window_bits, char *work, size_t work_size,
+                                 char *out, size_t out_size)
+{
+    if (!z || !work || !out || out_size < 64 || level < -1 || level > 9 ||
+        window_bits < 9 || window_bits > 15)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    int bits;
+    switch (format)
+    {
+    case SJSON_DEFLATE_RAW:  bits = -window_bits; break;
+    case SJSON_DEFLATE_ZLIB: bits = window_bits; break;
+    case SJSON_DEFLATE_GZIP: bits = window_bits + 16; break;
+    default: return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    z->format = format;
+    z->dict = NULL;
+    z->dict_length = 0;
+    z->work = work;
+    z->work_size = work_size;
+    z->work_used = 0;
+    z->out = out;
+    z->out_size = out_size;
+    z->out_used = 0;
+
+    z->strm.zalloc = work_alloc;
+    z->strm.zfree = work_free;
+    z->strm.opaque = z;
+
+    // Hash table sized like the window, as zlib's defaults do (15 -> 8)
+    if (deflateInit2(&z->strm, level, Z_DEFLATED, bits, window_bits - 7, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_DeflateAttach(sjson_context_t *ctx, sjson_deflate_t *z)
+{
+    if (!ctx || !z)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    // The stage takes over the callback; other output modes do not combine
+    if (ctx->stage_fn || ctx->partial_callback || ctx->producer || ctx->dry_run ||
+        ctx->framer || ctx->bytes_out > 0 || !ctx->send_callback)
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    if (deflateReset(&z->strm) != Z_OK)
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    // Every document starts from the same primed window
+    if (z->dict)
+    {
+        if (deflateSetDictionary(&z->strm, (const Bytef *)z->dict, (uInt)z->dict_length) != Z_OK)
+        {
+            return SJSON_ERROR_INVALID_STATE;
+        }
+        // zlib counts the dictionary as input; total_in is the JSON only
+        z->strm.total_in = 0;
+    }
+    z->out_used = 0;
+
+    ctx->stage_fn = deflate_stage;
+    ctx->stage = z;
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_DeflateSetDictionary(sjson_deflate_t *z, const char *dict, size_t length)
+{
+    if (!z || (dict && (length == 0 || length > UINT32_MAX)))
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    if (dict && z->format == SJSON_DEFLATE_GZIP)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    z->dict = dict;
+    z->dict_length = dict ? length : 0;
+    return SJSON_OK;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file stream_json_deflate.h
+ * @brief Streaming deflate/gzip output stage
+ *
+ * Optional add-on to stream_json (requires zlib). Every flushed buffer is
+ * compressed before it reaches the send callback. zlib allocates from a
+ * caller-provided work area, so compression stays zero-malloc:
+ * sjson_Flush() ends in a sync flush (everything so far can be decoded),
+ * sjson_End() finishes the stream. A preset dictionary makes even small
+ * documents compress well.
+ *
+ * Example:
+ *   static char work[SJSON_DEFLATE_WORK_SIZE(12)];
+ *   static char out[512];
+ *   sjson_deflate_t z;
+ *   sjson_DeflateInit(&z, SJSON_DEFLATE_GZIP, 6, 12, work, sizeof(work), out, sizeof(out));
+ *
+ *   sjson_InitObject(&ctx, buffer, sizeof(buffer), my_send_callback, user_data);
+ *   sjson_DeflateAttach(&ctx, &z);
+ *   sjson_AddIntToObject(&ctx, "count", 42);
+ *   sjson_End(&ctx);              // gzip trailer sent
+ */
+
+#ifndef STREAM_JSON_DEFLATE_H
+#define STREAM_JSON_DEFLATE_H
+
+#include <zlib.h>
+#include "stream_json.h"
+
+/**
+ * Work area needed for a window of 2^window_bits bytes
+ * Window and hash table (2^(window_bits+2) each) plus zlib's internal state
+ */
+#define SJSON_DEFLATE_WORK_SIZE(window_bits) ((1u << ((window_bits) + 3)) + 8192u)
+
+/**
+ * Compressed stream format
+ */
+typedef enum {
+    SJSON_DEFLATE_RAW,   /* Raw deflate (RFC 1951), e.g. WebSocket permessage-deflate */
+    SJSON_DEFLATE_ZLIB,  /* zlib wrapper (RFC 1950), HTTP Content-Encoding: deflate */
+    SJSON_DEFLATE_GZIP   /* gzip wrapper (RFC 1952), HTTP Content-Encoding: gzip */
+} sjson_deflate_format_t;
+
+typedef struct {
+    z_stream strm;                 /* strm.total_in/total_out: JSON/compressed bytes */
+    sjson_deflate_format_t format;
+
+    /* Preset dictionary, primed into every document (see sjson_DeflateSetDictionary) */
+    const char *dict;
+    size_t dict_length;
+
+    /* Bump allocator for zlib, nothing is freed until sjson_DeflateInit() */
+    char *work;
+    size_t work_size;
+    size_t work_used;
+
+    /* Compressed output, sent when full or on sjson_Flush()/sjson_End() */
+    char *out;
+    size_t out_size;
+    size_t out_used;
+} sjson_deflate_t;
+
+/**
+ * Set up a compressor (once; it can then be attached to one document after another)
+ * @param z Compressor to initialize
+ * @param format Stream format
+ * @param level Compression level 0..9, or -1 for zlib's default (6)
+ * @param window_bits Window size 9..15 (512 bytes to 32 KB), sizes the work area
+ * @param work Memory for zlib, at least SJSON_DEFLATE_WORK_SIZE(window_bits) bytes
+ * @param work_size Size of work
+ * @param out Buffer collecting compressed bytes for the send callback
+ * @param out_size Size of out (at least 64 bytes)
+ * @return SJSON_OK or SJSON_ERROR_INVALID_PARAM (also if work is too small)
+ */
+sjson_status_t sjson_DeflateInit(sjson_deflate_t *z, sjson_deflate_format_t format, int level,
+                                 int window_bits, char *work, size_t work_size,
+                                 char *out, size_t out_size);
+
+/**
+ * Compress the document written to ctx
+ * Starts a new compressed stream; the compressed bytes go to the callback
+ * given to Init, or to the vectored callback if one is set.
+ * @param ctx JSON context (right after Init, plain callback only)
+ * @param z Initialized compressor (one context at a time)
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_DeflateAttach(sjson_context_t *ctx, sjson_deflate_t *z);
+
+/**
+ * Compress every following document against a preset dictionary
+ * Small documents of a recurring shape (heartbeats, telemetry) then compress
+ * several times better, since key names and structure are already known to
+ * both sides. Train the dictionary offline with tools/sjson_train_dict from
+ * captured output. The receiver must use the same dictionary
+ * (inflateSetDictionary(): right after inflateInit2() for SJSON_DEFLATE_RAW,
+ * on Z_NEED_DICT for SJSON_DEFLATE_ZLIB).
+ * @param z Initialized compressor, RAW or ZLIB format (gzip has no dictionary)
+ * @param dict Dictionary bytes, must stay valid while set; NULL to remove it.
+ *        Only the last 2^window_bits bytes are used.
+ * @param length Dictionary length
+ * @return SJSON_OK or SJSON_ERROR_INVALID_PARAM
+ */
+sjson_status_t sjson_DeflateSetDictionary(sjson_deflate_t *z, const char *dict, size_t length);
+
+#endif /* STREAM_JSON_DEFLATE_H */
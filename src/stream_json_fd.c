@@ -0,0 +1,73 @@
+/**
+ * @file stream_json_fd.c
+ * @brief Embed the contents of a file descriptor as a JSON value
+ */
+#define _POSIX_C_SOURCE 200112L
+#include "stream_json_fd.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+/* ========================================================================
+ * Internal Helper Functions
+ * ======================================================================== */
+
+/* Read callback over read(), retried on EINTR */
+static size_t fd_reader(char *buffer, size_t capacity, void *state)
+{
+    int fd = *(const int *)state;
+
+    if (capacity > SSIZE_MAX)
+    {
+        capacity = SSIZE_MAX;
+    }
+
+    for (;;)
+    {
+        ssize_t n = read(fd, buffer, capacity);
+        if (n >= 0)
+        {
+            return (size_t)n;
+        }
+        if (errno != EINTR)
+        {
+            return SJSON_READ_FAILED;
+        }
+    }
+}
+
+/* ========================================================================
+ * Public API
+ * ======================================================================== */
+
+sjson_status_t sjson_AddFdToObject(sjson_context_t *ctx, const char *key, int fd, sjson_encoding_t encoding)
+{
+    if (fd < 0)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    return sjson_AddStreamToObject(ctx, key, fd_reader, &fd, encoding);
+}
+
+sjson_status_t sjson_AddFdToArray(sjson_context_t *ctx, int fd, sjson_encoding_t encoding)
+{
+    if (fd < 0)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    return sjson_AddStreamToArray(ctx, fd_reader, &fd, encoding);
+}
+
+sjson_status_t sjson_AddFdToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key, int fd,
+                                        sjson_encoding_t encoding)
+{
+    if (fd < 0)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    return sjson_AddStreamToObjectByKey(ctx, key, fd_reader, &fd, encoding);
+}
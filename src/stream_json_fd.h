@@ -0,0 +1,53 @@
+/**
+ * @file stream_json_fd.h
+ * @brief Embed the contents of a file descriptor as a JSON value
+ *
+ * Optional add-on to stream_json (requires POSIX read()). The data is read
+ * straight into the free space of the context buffer and escaped or base64
+ * encoded there in place, so files of any size are embedded with the one
+ * bounded buffer and no extra copy (see sjson_AddStreamToObject()).
+ *
+ * The buffer needs at least SJSON_STREAM_MIN_SPACE (64) bytes; with a
+ * framer, headroom + 2 * tailroom + 64 (96 for sjson_framer_chunked).
+ * Below that the calls return SJSON_ERROR_INVALID_PARAM.
+ *
+ * Example:
+ *   int fd = open("/var/log/app.log", O_RDONLY);
+ *   sjson_AddFdToObject(&ctx, "log", fd, SJSON_ENCODING_STRING);
+ *   close(fd);
+ */
+
+#ifndef STREAM_JSON_FD_H
+#define STREAM_JSON_FD_H
+
+#include "stream_json.h"
+
+/**
+ * Add everything readable from fd (up to end of file) to the current object
+ * @param ctx JSON context (not in non-blocking or pull mode)
+ * @param key Key name
+ * @param fd Open file descriptor, read until read() returns 0
+ * @param encoding SJSON_ENCODING_STRING (text), SJSON_ENCODING_BASE64
+ *        (binary) or SJSON_ENCODING_RAW (file already holds JSON)
+ * @return SJSON_OK, SJSON_ERROR_BUFFER_FULL if read() or the send callback
+ *         failed (the document is then incomplete), SJSON_ERROR_INVALID_PARAM
+ *         if fd < 0 or the buffer is below the minimum, or other error code
+ */
+sjson_status_t sjson_AddFdToObject(sjson_context_t *ctx, const char *key, int fd, sjson_encoding_t encoding);
+
+/**
+ * Add everything readable from fd (up to end of file) to the current array
+ * @param ctx JSON context (not in non-blocking or pull mode)
+ * @param fd Open file descriptor, read until read() returns 0
+ * @param encoding As for sjson_AddFdToObject()
+ * @return SJSON_OK or error code, as for sjson_AddFdToObject()
+ */
+sjson_status_t sjson_AddFdToArray(sjson_context_t *ctx, int fd, sjson_encoding_t encoding);
+
+/**
+ * sjson_AddFdToObject() with a pre-encoded key (see sjson_KeyInit())
+ */
+sjson_status_t sjson_AddFdToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key, int fd,
+                                        sjson_encoding_t encoding);
+
+#endif /* STREAM_JSON_FD_H */
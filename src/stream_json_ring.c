@@ -0,0 +1,226 @@
+/**
+ * @file stream_json_ring.c
+ * @brief Multi-buffer output ring with a background sender thread
+ *
+ * The writer (producer) and the sender thread (consumer) share only the
+ * head/tail counters, updated with atomics. The mutex and condition
+ * variables are used solely to park a side that has nothing to do; the
+ * waiting flags let the other side skip the wakeup when nobody is parked.
+ */
+#include "stream_json_ring.h"
+
+/* ========================================================================
+ * Internal Helper Functions
+ * ======================================================================== */
+
+static char *ring_slot(const sjson_ring_t *ring, uint32_t index)
+{
+    return ring->memory + (size_t)(index % ring->count) * ring->buffer_size;
+}
+
+/* True once the sender has finished buffers up to (not including) target */
+static bool tail_reached(sjson_ring_t *ring, uint32_t target)
+{
+    return (int32_t)(__atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST) - target) >= 0;
+}
+
+/* Park the writer until the sender has finished buffers up to target */
+static void wait_for_tail(sjson_ring_t *ring, uint32_t target)
+{
+    if (tail_reached(ring, target))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&ring->lock);
+    __atomic_store_n(&ring->writer_waiting, true, __ATOMIC_SEQ_CST);
+    while (!tail_reached(ring, target))
+    {
+        pthread_cond_wait(&ring->writer_cond, &ring->lock);
+    }
+    __atomic_store_n(&ring->writer_waiting, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+static void wake(sjson_ring_t *ring, bool *waiting, pthread_cond_t *cond)
+{
+    if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST))
+    {
+        pthread_mutex_lock(&ring->lock);
+        pthread_cond_signal(cond);
+        pthread_mutex_unlock(&ring->lock);
+    }
+}
+
+static void *sender_main(void *arg)
+{
+    sjson_ring_t *ring = (sjson_ring_t *)arg;
+
+    for (;;)
+    {
+        uint32_t tail = ring->tail;
+
+        if (__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) == tail)
+        {
+            // Queue empty: park until the writer publishes or stop is requested
+            pthread_mutex_lock(&ring->lock);
+            __atomic_store_n(&ring->sender_waiting, true, __ATOMIC_SEQ_CST);
+            while (__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) == tail && !ring->stop)
+            {
+                pthread_cond_wait(&ring->sender_cond, &ring->lock);
+            }
+            __atomic_store_n(&ring->sender_waiting, false, __ATOMIC_SEQ_CST);
+            bool done = ring->stop && __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) == tail;
+            pthread_mutex_unlock(&ring->lock);
+
+            if (done)
+            {
+                return NULL;
+            }
+            continue;
+        }
+
+        // After a failure the remaining buffers are dropped, but still released
+        if (!__atomic_load_n(&ring->failed, __ATOMIC_ACQUIRE))
+        {
+            uint32_t slot = tail % ring->count;
+            if (!ring->send_callback(ring_slot(ring, tail), ring->lengths[slot], ring->user_data))
+            {
+                __atomic_store_n(&ring->failed, true, __ATOMIC_RELEASE);
+            }
+        }
+
+        __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_SEQ_CST);
+        wake(ring, &ring->writer_waiting, &ring->writer_cond);
+    }
+}
+
+/* Stage hook: queue the current buffer and continue in the next free one */
+static sjson_status_t ring_stage(sjson_context_t *ctx, void *stage, bool sync)
+{
+    sjson_ring_t *ring = (sjson_ring_t *)stage;
+    uint32_t head = ring->head;
+
+    // Buffers are queued as they fill, an explicit flush adds nothing
+    (void)sync;
+    if (ctx->used == 0)
+    {
+        return SJSON_OK;
+    }
+
+    ring->lengths[head % ring->count] = ctx->used;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_SEQ_CST);
+    wake(ring, &ring->sender_waiting, &ring->sender_cond);
+    ctx->used = 0;
+    head++;
+
+    if (ctx->finalized)
+    {
+        // Document complete: return only once everything has been sent
+        wait_for_tail(ring, head);
+    }
+    else
+    {
+        // Backpressure only when every buffer is in flight
+        wait_for_tail(ring, head - ring->count + 1);
+        ctx->buffer = ring_slot(ring, head);
+    }
+
+    if (__atomic_load_n(&ring->failed, __ATOMIC_ACQUIRE))
+    {
+        return SJSON_ERROR_BUFFER_FULL;
+    }
+    return SJSON_OK;
+}
+
+static sjson_status_t ring_init(sjson_context_t *ctx, sjson_ring_t *ring, bool array)
+{
+    if (!ctx || !ring)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    wait_for_tail(ring, ring->head - ring->count + 1);
+    char *buffer = ring_slot(ring, ring->head);
+
+    sjson_status_t status = array
+        ? sjson_InitArray(ctx, buffer, ring->buffer_size, ring->send_callback, ring->user_data)
+        : sjson_InitObject(ctx, buffer, ring->buffer_size, ring->send_callback, ring->user_data);
+    if (status != SJSON_OK)
+        return status;
+
+    ctx->stage_fn = ring_stage;
+    ctx->stage = ring;
+    return SJSON_OK;
+}
+
+/* ========================================================================
+ * Public API
+ * ======================================================================== */
+
+sjson_status_t sjson_RingStart(sjson_ring_t *ring, char *memory, size_t buffer_size, uint32_t count,
+                               sjson_send_callback_t callback, void *user_data)
+{
+    if (!ring || !memory || buffer_size == 0 || !callback ||
+        count < 2 || count > SJSON_RING_MAX_BUFFERS)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    ring->memory = memory;
+    ring->buffer_size = buffer_size;
+    ring->count = count;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->send_callback = callback;
+    ring->user_data = user_data;
+    ring->failed = false;
+    ring->stop = false;
+    ring->sender_waiting = false;
+    ring->writer_waiting = false;
+
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->sender_cond, NULL);
+    pthread_cond_init(&ring->writer_cond, NULL);
+
+    if (pthread_create(&ring->thread, NULL, sender_main, ring) != 0)
+    {
+        pthread_cond_destroy(&ring->writer_cond);
+        pthread_cond_destroy(&ring->sender_cond);
+        pthread_mutex_destroy(&ring->lock);
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_RingStop(sjson_ring_t *ring)
+{
+    if (!ring)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&ring->lock);
+    ring->stop = true;
+    pthread_cond_signal(&ring->sender_cond);
+    pthread_mutex_unlock(&ring->lock);
+
+    pthread_join(ring->thread, NULL);
+
+    pthread_cond_destroy(&ring->writer_cond);
+    pthread_cond_destroy(&ring->sender_cond);
+    pthread_mutex_destroy(&ring->lock);
+
+    return ring->failed ? SJSON_ERROR_BUFFER_FULL : SJSON_OK;
+}
+
+sjson_status_t sjson_RingInitObject(sjson_context_t *ctx, sjson_ring_t *ring)
+{
+    return ring_init(ctx, ring, false);
+}
+
+sjson_status_t sjson_RingInitArray(sjson_context_t *ctx, sjson_ring_t *ring)
+{
+    return ring_init(ctx, ring, true);
+}
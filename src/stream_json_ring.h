@@ -0,0 +1,97 @@
+/**
+ * @file stream_json_ring.h
+ * @brief Multi-buffer output ring with a background sender thread
+ *
+ * Optional add-on to stream_json (requires POSIX threads). The caller
+ * supplies N equally sized buffers. Full buffers are handed to a sender
+ * thread over a lock-free single-producer/single-consumer queue while the
+ * writer keeps formatting into the next free buffer, so serialization
+ * overlaps with the (blocking) callback. The writer only waits when all
+ * buffers are in flight.
+ *
+ * Example:
+ *   static char memory[4 * 1024];
+ *   sjson_ring_t ring;
+ *   sjson_RingStart(&ring, memory, 1024, 4, my_send_callback, user_data);
+ *
+ *   sjson_RingInitObject(&ctx, &ring);
+ *   sjson_AddIntToObject(&ctx, "count", 42);
+ *   sjson_End(&ctx);              // waits until the document is sent
+ *
+ *   sjson_RingStop(&ring);
+ */
+
+#ifndef STREAM_JSON_RING_H
+#define STREAM_JSON_RING_H
+
+#include <pthread.h>
+#include "stream_json.h"
+
+/**
+ * Maximum number of buffers in a ring
+ */
+#define SJSON_RING_MAX_BUFFERS 8
+
+typedef struct {
+    char *memory;                            /* count * buffer_size bytes */
+    size_t buffer_size;
+    uint32_t count;
+    size_t lengths[SJSON_RING_MAX_BUFFERS];  /* Bytes used in each queued buffer */
+
+    /* SPSC queue: buffers [tail, head) are queued, head is the writer's buffer */
+    uint32_t head;                           /* Written by writer only */
+    uint32_t tail;                           /* Written by sender only */
+
+    sjson_send_callback_t send_callback;
+    void *user_data;
+    bool failed;                             /* Callback returned false */
+    bool stop;                               /* Sender should exit when drained */
+
+    /* Parking for an idle sender or a writer waiting on a free buffer */
+    bool sender_waiting;
+    bool writer_waiting;
+    pthread_mutex_t lock;
+    pthread_cond_t sender_cond;
+    pthread_cond_t writer_cond;
+    pthread_t thread;
+} sjson_ring_t;
+
+/**
+ * Initialize ring and start its sender thread
+ * @param ring Ring to initialize
+ * @param memory count * buffer_size bytes, split into count buffers
+ * @param buffer_size Size of each buffer
+ * @param count Number of buffers (2..SJSON_RING_MAX_BUFFERS)
+ * @param callback Called on the sender thread for each full buffer
+ * @param user_data Pointer passed to callback
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_RingStart(sjson_ring_t *ring, char *memory, size_t buffer_size, uint32_t count,
+                               sjson_send_callback_t callback, void *user_data);
+
+/**
+ * Wait until all queued buffers are sent, then stop the sender thread
+ * @param ring Ring to stop (no context may still be writing to it)
+ * @return SJSON_OK, or SJSON_ERROR_BUFFER_FULL if a callback failed
+ */
+sjson_status_t sjson_RingStop(sjson_ring_t *ring);
+
+/**
+ * Initialize streaming JSON context with root object, writing into the ring
+ * sjson_Flush() queues the current buffer without waiting for it to be
+ * sent; sjson_End() waits until the whole document has been sent.
+ * @param ctx Context to initialize
+ * @param ring Started ring (one writing context at a time)
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_RingInitObject(sjson_context_t *ctx, sjson_ring_t *ring);
+
+/**
+ * Initialize streaming JSON context with root array, writing into the ring
+ * @param ctx Context to initialize
+ * @param ring Started ring (one writing context at a time)
+ * @return SJSON_OK or error code
+ */
+sjson_status_t sjson_RingInitArray(sjson_context_t *ctx, sjson_ring_t *ring);
+
+#endif /* STREAM_JSON_RING_H */
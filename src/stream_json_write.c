@@ -1,722 +1,3814 @@
-/**
- * @file stream_json_write.c
- * @brief Implementation of streaming JSON writer
- *
- * Zero-malloc JSON generator using fixed buffer with streaming callback.
- * Uses depth stack for nesting and comma tracking per depth level.
- */
-#include "stream_json.h"
-#include <string.h>
-#include <stdio.h>
-
-/* ========================================================================
- * Internal Helper Functions
- * ======================================================================== */
-static sjson_status_t write(sjson_context_t *ctx, const char *data, size_t len)
-{
-    if (!ctx || !data)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    if (ctx->buffer_size == ctx->used)
-    {
-        sjson_status_t status = sjson_Flush(ctx);
-        if (status != SJSON_OK)
-        {
-            return status;
-        }
-    }
-
-    while (len > 0)
-    {
-        size_t available = ctx->buffer_size - ctx->used;
-        size_t to_write = (len < available) ? len : available; // > 0 since we checked len > 0 and available > 0 because we checked before
-
-        memcpy(ctx->buffer + ctx->used, data, to_write);
-        ctx->used += to_write;
-        data += to_write;
-        len -= to_write;
-
-        // If buffer is full flush it, independent of remaining len
-        if (ctx->used == ctx->buffer_size)
-        {
-            sjson_status_t status = sjson_Flush(ctx);
-            if (status != SJSON_OK)
-            {
-                return status;
-            }
-        }
-    }
-
-    return SJSON_OK;
-}
-
-static sjson_status_t write_str(sjson_context_t *ctx, const char *str)
-{
-    return write(ctx, str, strlen(str));
-}
-
-static sjson_status_t write_char(sjson_context_t *ctx, char c)
-{
-    return write(ctx, &c, 1);
-}
-
-/* Write comma if needed before next item at current depth */
-static sjson_status_t add_comma_if_needed(sjson_context_t *ctx)
-{
-    if (ctx->needs_comma[ctx->depth])
-    {
-        sjson_status_t status = write_char(ctx, ',');
-        if (status != SJSON_OK)
-            return status;
-    }
-    ctx->needs_comma[ctx->depth] = true; // Next item will need comma
-    return SJSON_OK;
-}
-
-/* Check if in valid object state (for AddXToObject functions) */
-static sjson_status_t check_object_state(sjson_context_t *ctx)
-{
-    if (!ctx)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    if (ctx->finalized)
-    {
-        return SJSON_ERROR_INVALID_STATE;
-    }
-
-    // Must be in an object (depth > 0 and top of stack is '}')
-    if (ctx->depth == 0 || ctx->depth_stack[ctx->depth - 1] != '}')
-    {
-        return SJSON_ERROR_INVALID_STATE;
-    }
-
-    return SJSON_OK;
-}
-
-/* Check if in valid array state (for AddXToArray functions) */
-static sjson_status_t check_array_state(sjson_context_t *ctx)
-{
-    if (!ctx)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    if (ctx->finalized)
-    {
-        return SJSON_ERROR_INVALID_STATE;
-    }
-
-    // Must be in an array (depth > 0 and top of stack is ']')
-    if (ctx->depth == 0 || ctx->depth_stack[ctx->depth - 1] != ']')
-    {
-        return SJSON_ERROR_INVALID_STATE;
-    }
-
-    return SJSON_OK;
-}
-
-/* ========================================================================
- * Public API - Initialization
- * ======================================================================== */
-
-sjson_status_t sjson_InitObject(sjson_context_t *ctx, char *buffer, size_t buffer_size,
-                                sjson_send_callback_t callback, void *user_data)
-{
-    if (!ctx || !buffer || buffer_size == 0 || !callback)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    ctx->buffer = buffer;
-    ctx->buffer_size = buffer_size;
-    ctx->used = 0;
-    ctx->user_data = user_data;
-    ctx->send_callback = callback;
-    ctx->depth = 0;
-    ctx->max_depth = SJSON_MAX_DEPTH; // Allow 1 level of nesting by default
-    ctx->finalized = false;
-
-    // Initialize stacks
-    memset(ctx->depth_stack, 0, sizeof(ctx->depth_stack));
-    memset(ctx->needs_comma, 0, sizeof(ctx->needs_comma));
-
-    // Start root object
-    sjson_status_t status = write_char(ctx, '{');
-    if (status != SJSON_OK)
-        return status;
-
-    ctx->depth_stack[ctx->depth] = '}'; // Will close with '}'
-    ctx->depth++;
-    ctx->needs_comma[ctx->depth] = false;
-
-    return SJSON_OK;
-}
-
-sjson_status_t sjson_InitArray(sjson_context_t *ctx, char *buffer, size_t buffer_size,
-                               sjson_send_callback_t callback, void *user_data)
-{
-    if (!ctx || !buffer || buffer_size == 0 || !callback)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    ctx->buffer = buffer;
-    ctx->buffer_size = buffer_size;
-    ctx->used = 0;
-    ctx->user_data = user_data;
-    ctx->send_callback = callback;
-    ctx->depth = 0;
-    ctx->max_depth = SJSON_MAX_DEPTH; // Allow 1 level of nesting by default
-    ctx->finalized = false;
-
-    // Initialize stacks
-    memset(ctx->depth_stack, 0, sizeof(ctx->depth_stack));
-    memset(ctx->needs_comma, 0, sizeof(ctx->needs_comma));
-
-    // Start root array
-    sjson_status_t status = write_char(ctx, '[');
-    if (status != SJSON_OK)
-        return status;
-
-    ctx->depth_stack[ctx->depth] = ']'; // Will close with ']'
-    ctx->depth++;
-    ctx->needs_comma[ctx->depth] = false;
-
-    return SJSON_OK;
-}
-
-sjson_status_t sjson_Close(sjson_context_t *ctx)
-{
-    if (!ctx)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    if (ctx->finalized || ctx->depth == 0)
-    {
-        return SJSON_ERROR_INVALID_STATE;
-    }
-
-    // Pop from stack and write closing char
-    ctx->depth--;
-    sjson_status_t status = write_char(ctx, ctx->depth_stack[ctx->depth]);
-    if (status != SJSON_OK)
-    {
-        ctx->depth++; // Restore depth on failure
-        return status;
-    }
-
-    // If we just closed root collection, finalize
-    if (ctx->depth == 0)
-    {
-        ctx->finalized = true;
-        status = sjson_Flush(ctx);
-        if (status != SJSON_OK)
-        {
-            return status;
-        }
-    }
-    else
-    {
-        // Parent now has an element
-        ctx->needs_comma[ctx->depth] = true;
-    }
-
-    return SJSON_OK;
-}
-
-sjson_status_t sjson_End(sjson_context_t *ctx)
-{
-    if (!ctx)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    if (ctx->finalized)
-    {
-        return sjson_Flush(ctx);
-    }
-
-    // Close all open collections using sjson_Close
-    // Last close will auto-flush and finalize when depth hits 0
-    while (ctx->depth > 0)
-    {
-        sjson_status_t status = sjson_Close(ctx);
-        if (status != SJSON_OK)
-        {
-            return status; // sjson_Close already restored state on failure
-        }
-    }
-
-    return SJSON_OK;
-}
-
-sjson_status_t sjson_Flush(sjson_context_t *ctx)
-{
-    if (ctx->used == 0)
-    {
-        return SJSON_OK;
-    }
-
-    bool result = ctx->send_callback(ctx->buffer, ctx->used, ctx->user_data);
-    if (!result)
-    {
-        return SJSON_ERROR_BUFFER_FULL;
-    }
-    ctx->used = 0;
-    return SJSON_OK;
-}
-
-
-/* ========================================================================
- * Add to Object
- * Note: All Add functions check finalized flag to prevent use after close
- * ======================================================================== */
-
-sjson_status_t sjson_AddStringToObject(sjson_context_t *ctx, const char *key, const char *value)
-{
-    if (!ctx || !key || !value)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    sjson_status_t status = check_object_state(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    status = add_comma_if_needed(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    // Write: "key":"value"
-    char buffer[256];
-    int written = snprintf(buffer, sizeof(buffer), "\"%s\":\"%s\"", key, value);
-
-    if (written < 0 || written >= (int)sizeof(buffer))
-    {
-        return SJSON_ERROR_BUFFER_FULL;
-    }
-
-    return write_str(ctx, buffer);
-}
-
-sjson_status_t sjson_AddIntToObject(sjson_context_t *ctx, const char *key, int64_t value)
-{
-    if (!ctx || !key)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    sjson_status_t status = check_object_state(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    status = add_comma_if_needed(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    // Write: "key":value
-    char buffer[128];
-    int written = snprintf(buffer, sizeof(buffer), "\"%s\":%ld", key, (long)value);
-
-    if (written < 0 || written >= (int)sizeof(buffer))
-    {
-        return SJSON_ERROR_BUFFER_FULL;
-    }
-
-    return write_str(ctx, buffer);
-}
-
-sjson_status_t sjson_AddFloatToObject(sjson_context_t *ctx, const char *key, float value)
-{
-    if (!ctx || !key)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    sjson_status_t status = check_object_state(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    status = add_comma_if_needed(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    // Write: "key":value
-    char buffer[128];
-    int written = snprintf(buffer, sizeof(buffer), "\"%s\":%.6f", key, value);
-
-    if (written < 0 || written >= (int)sizeof(buffer))
-    {
-        return SJSON_ERROR_BUFFER_FULL;
-    }
-
-    return write_str(ctx, buffer);
-}
-
-sjson_status_t sjson_AddNumberToObject(sjson_context_t *ctx, const char *key, double value)
-{
-    return sjson_AddFloatToObject(ctx, key, (float)value);
-}
-
-sjson_status_t sjson_AddIntArrayToObject(sjson_context_t *ctx, const char *key,
-                                         const int64_t *values, size_t count)
-{
-    if (!ctx || !key || !values)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    sjson_status_t status = check_object_state(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    status = add_comma_if_needed(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    // Write: "key":[
-    char buffer[64];
-    int written = snprintf(buffer, sizeof(buffer), "\"%s\":[", key);
-
-    if (written < 0 || written >= (int)sizeof(buffer))
-    {
-        return SJSON_ERROR_BUFFER_FULL;
-    }
-
-    status = write_str(ctx, buffer);
-    if (status != SJSON_OK)
-        return status;
-
-    // Add array elements
-    for (size_t i = 0; i < count; i++)
-    {
-        char value_buffer[32];
-        written = snprintf(value_buffer, sizeof(value_buffer), "%s%ld",
-                           i > 0 ? "," : "", (long)values[i]);
-
-        if (written < 0 || written >= (int)sizeof(value_buffer))
-        {
-            return SJSON_ERROR_BUFFER_FULL;
-        }
-
-        status = write_str(ctx, value_buffer);
-        if (status != SJSON_OK)
-            return status;
-    }
-
-    // Close array
-    return write_char(ctx, ']');
-}
-
-sjson_status_t sjson_AddFloatArrayToObject(sjson_context_t *ctx, const char *key,
-                                           const float *values, size_t count)
-{
-    if (!ctx || !key || !values)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    sjson_status_t status = check_object_state(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    status = add_comma_if_needed(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    // Write: "key":[
-    char buffer[64];
-    int written = snprintf(buffer, sizeof(buffer), "\"%s\":[", key);
-
-    if (written < 0 || written >= (int)sizeof(buffer))
-    {
-        return SJSON_ERROR_BUFFER_FULL;
-    }
-
-    status = write_str(ctx, buffer);
-    if (status != SJSON_OK)
-        return status;
-
-    // Add array elements
-    for (size_t i = 0; i < count; i++)
-    {
-        char value_buffer[32];
-        written = snprintf(value_buffer, sizeof(value_buffer), "%s%.6f",
-                           i > 0 ? "," : "", values[i]);
-
-        if (written < 0 || written >= (int)sizeof(value_buffer))
-        {
-            return SJSON_ERROR_BUFFER_FULL;
-        }
-
-        status = write_str(ctx, value_buffer);
-        if (status != SJSON_OK)
-            return status;
-    }
-
-    // Close array
-    return write_char(ctx, ']');
-}
-
-sjson_status_t sjson_AddArrayToObject(sjson_context_t *ctx, const char *key)
-{
-    if (!ctx || !key ||strlen(key) == 0 || strlen(key) > 128)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    sjson_status_t status = check_object_state(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    if (ctx->depth >= ctx->max_depth)
-    {
-        return SJSON_ERROR_MAX_DEPTH;
-    }
-
-    status = add_comma_if_needed(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    // Write: "<key>":[
-    char buffer[128+5]; // extraspsaces for "":[ and null terminator
-    int written = snprintf(buffer, sizeof(buffer), "\"%s\":[", key);
-
-    if (written < 0 || written >= (int)sizeof(buffer))
-    {
-        return SJSON_ERROR_BUFFER_FULL;
-    }
-
-    status = write_str(ctx, buffer);
-    if (status != SJSON_OK)
-        return status;
-
-    // Push array onto stack
-    ctx->depth_stack[ctx->depth] = ']';
-    ctx->depth++;
-    ctx->needs_comma[ctx->depth] = false;
-
-    return SJSON_OK;
-}
-
-sjson_status_t sjson_AddObjectToObject(sjson_context_t *ctx, const char *key)
-{
-    if (!ctx || !key)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    sjson_status_t status = check_object_state(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    if (ctx->depth >= ctx->max_depth)
-    {
-        return SJSON_ERROR_MAX_DEPTH;
-    }
-
-    status = add_comma_if_needed(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    // Write: "key":{
-    char buffer[128];
-    int written = snprintf(buffer, sizeof(buffer), "\"%s\":{", key);
-
-    if (written < 0 || written >= (int)sizeof(buffer))
-    {
-        return SJSON_ERROR_BUFFER_FULL;
-    }
-
-    status = write_str(ctx, buffer);
-    if (status != SJSON_OK)
-        return status;
-
-    // Push object onto stack
-    ctx->depth_stack[ctx->depth] = '}';
-    ctx->depth++;
-    ctx->needs_comma[ctx->depth] = false;
-
-    return SJSON_OK;
-}
-
-sjson_status_t sjson_AddRawToObject(sjson_context_t *ctx, const char *key, const char *value)
-{
-    if (!ctx || !key || !value)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    sjson_status_t status = check_object_state(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    status = add_comma_if_needed(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    // Write: "key":value (value is raw JSON)
-    status = write_char(ctx, '"');
-    if (status != SJSON_OK)
-        return status;
-
-    status = write_str(ctx, key);
-    if (status != SJSON_OK)
-        return status;
-
-    status = write_str(ctx, "\":");
-    if (status != SJSON_OK)
-        return status;
-
-    return write_str(ctx, value);
-}
-
-/* ========================================================================
- * Add to Array
- * ======================================================================== */
-
-sjson_status_t sjson_AddIntToArray(sjson_context_t *ctx, int64_t value)
-{
-    if (!ctx)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    // Check we're in an array (not object)
-    sjson_status_t status = check_array_state(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    status = add_comma_if_needed(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    char buffer[32];
-    int written = snprintf(buffer, sizeof(buffer), "%ld", (long)value);
-
-    if (written < 0 || written >= (int)sizeof(buffer))
-    {
-        return SJSON_ERROR_BUFFER_FULL;
-    }
-
-    return write_str(ctx, buffer);
-}
-
-sjson_status_t sjson_AddFloatToArray(sjson_context_t *ctx, float value)
-{
-    if (!ctx)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    sjson_status_t status = check_array_state(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    status = add_comma_if_needed(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    char buffer[32];
-    int written = snprintf(buffer, sizeof(buffer), "%.6f", value);
-
-    if (written < 0 || written >= (int)sizeof(buffer))
-    {
-        return SJSON_ERROR_BUFFER_FULL;
-    }
-
-    return write_str(ctx, buffer);
-}
-
-sjson_status_t sjson_AddStringToArray(sjson_context_t *ctx, const char *value)
-{
-    if (!ctx || !value)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    sjson_status_t status = check_array_state(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    status = add_comma_if_needed(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    status = write_char(ctx, '"');
-    if (status != SJSON_OK)
-        return status;
-
-    status = write_str(ctx, value);
-    if (status != SJSON_OK)
-        return status;
-
-    return write_char(ctx, '"');
-}
-
-sjson_status_t sjson_AddObjectToArray(sjson_context_t *ctx)
-{
-    if (!ctx)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    sjson_status_t status = check_array_state(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    if (ctx->depth >= ctx->max_depth)
-    {
-        return SJSON_ERROR_MAX_DEPTH;
-    }
-
-    status = add_comma_if_needed(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    status = write_char(ctx, '{');
-    if (status != SJSON_OK)
-        return status;
-
-    ctx->depth_stack[ctx->depth] = '}';
-    ctx->depth++;
-    ctx->needs_comma[ctx->depth] = false;
-
-    return SJSON_OK;
-}
-
-sjson_status_t sjson_AddArrayToArray(sjson_context_t *ctx)
-{
-    if (!ctx)
-    {
-        return SJSON_ERROR_INVALID_PARAM;
-    }
-
-    sjson_status_t status = check_array_state(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    if (ctx->depth >= ctx->max_depth)
-    {
-        return SJSON_ERROR_MAX_DEPTH;
-    }
-
-    status = add_comma_if_needed(ctx);
-    if (status != SJSON_OK)
-        return status;
-
-    status = write_char(ctx, '[');
-    if (status != SJSON_OK)
-        return status;
-
-    ctx->depth_stack[ctx->depth] = ']';
-    ctx->depth++;
-    ctx->needs_comma[ctx->depth] = false;
-
-    return SJSON_OK;
-}
+/**
+ * @file stream_json_write.c
+ * @brief Implementation of streaming JSON writer
+ *
+ * Zero-malloc JSON generator using fixed buffer with streaming callback.
+ * Uses depth stack for nesting and comma tracking per depth level.
+ */
+#include "stream_json.h"
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/* ========================================================================
+ * Internal Helper Functions
+ * ======================================================================== */
+
+/* Send spans through the vectored callback, or one by one through the plain one */
+static sjson_status_t send_spans(sjson_context_t *ctx, const sjson_iovec_t *iov, size_t iovcnt)
+{
+    if (ctx->sendv_callback)
+    {
+        return ctx->sendv_callback(iov, iovcnt, ctx->user_data) ? SJSON_OK : SJSON_ERROR_BUFFER_FULL;
+    }
+
+    for (size_t i = 0; i < iovcnt; i++)
+    {
+        if (!ctx->send_callback((const char *)iov[i].base, iov[i].len, ctx->user_data))
+        {
+            return SJSON_ERROR_BUFFER_FULL;
+        }
+    }
+    return SJSON_OK;
+}
+
+/*
+ * Send the buffered bytes, optionally followed by external data, wrapped in
+ * one frame when a framer is set. The header goes into the headroom before
+ * ctx->buffer and the trailer right after the last byte, so the framed
+ * buffer is sent as one contiguous span.
+ */
+static sjson_status_t send_buffer(sjson_context_t *ctx, const char *data, size_t len)
+{
+    sjson_iovec_t iov[3];
+    size_t iovcnt = 0;
+    const sjson_framer_t *framer = ctx->framer;
+    size_t payload = ctx->used + len;
+    bool first = (ctx->bytes_out == 0);
+
+    if (framer)
+    {
+        size_t head = framer->write_header(ctx->buffer, payload, first, ctx->finalized);
+        iov[iovcnt].base = ctx->buffer - head;
+        iov[iovcnt].len = head + ctx->used;
+        iovcnt++;
+    }
+    else if (ctx->used > 0)
+    {
+        iov[iovcnt].base = ctx->buffer;
+        iov[iovcnt].len = ctx->used;
+        iovcnt++;
+    }
+
+    if (len > 0)
+    {
+        iov[iovcnt].base = data;
+        iov[iovcnt].len = len;
+        iovcnt++;
+    }
+
+    if (framer)
+    {
+        // Behind the buffered bytes, or in the unused tail when data follows
+        char *tail = (len > 0) ? ctx->buffer + ctx->buffer_size : ctx->buffer + ctx->used;
+        size_t tail_len = framer->write_trailer(tail, payload, first, ctx->finalized);
+        if (len == 0)
+        {
+            iov[0].len += tail_len;
+        }
+        else if (tail_len > 0)
+        {
+            iov[iovcnt].base = tail;
+            iov[iovcnt].len = tail_len;
+            iovcnt++;
+        }
+    }
+
+    sjson_status_t status = send_spans(ctx, iov, iovcnt);
+    if (status != SJSON_OK)
+    {
+        return status;
+    }
+
+    ctx->bytes_out += payload;
+    ctx->used = 0;
+    return SJSON_OK;
+}
+
+/*
+ * Zero-copy path for blocks that cannot fit the buffer anyway: the
+ * buffered bytes and the caller's memory are sent together, without
+ * copying the block (one call with a vectored callback).
+ */
+static sjson_status_t write_passthrough(sjson_context_t *ctx, const char *data, size_t len)
+{
+    return send_buffer(ctx, data, len);
+}
+
+/*
+ * Non-blocking mode: offer the first len buffered bytes to the partial
+ * callback until it stops accepting, and drop what it took from the buffer.
+ */
+static sjson_status_t send_partial(sjson_context_t *ctx, size_t len, size_t *sent)
+{
+    size_t total = 0;
+
+    while (total < len)
+    {
+        size_t accepted = ctx->partial_callback(ctx->buffer + total, len - total, ctx->user_data);
+        if (accepted > len - total)
+        {
+            return SJSON_ERROR_BUFFER_FULL; // SJSON_SEND_FAILED or bogus count
+        }
+        if (accepted == 0)
+        {
+            break;
+        }
+        total += accepted;
+    }
+
+    if (total > 0)
+    {
+        memmove(ctx->buffer, ctx->buffer + total, ctx->used - total);
+        ctx->used -= total;
+        ctx->bytes_out += total;
+        ctx->token_start -= total;
+    }
+
+    *sent = total;
+    return SJSON_OK;
+}
+
+/* Record where the public call in progress starts, for non-blocking rollback */
+static void begin_token(sjson_context_t *ctx)
+{
+    ctx->token_start = ctx->used;
+    ctx->token_comma = ctx->needs_comma[ctx->depth];
+}
+
+/* Undo everything the public call in progress has written */
+static void rollback_token(sjson_context_t *ctx)
+{
+    ctx->used = ctx->token_start;
+    ctx->needs_comma[ctx->depth] = ctx->token_comma;
+}
+
+/*
+ * Hand the buffered bytes to the output. sync is set when the caller asked
+ * for the flush (sjson_Flush/sjson_End) rather than the buffer being full;
+ * output stages get that call even with an empty buffer, e.g. to flush a
+ * compressor.
+ */
+static sjson_status_t flush_buffer(sjson_context_t *ctx, bool sync)
+{
+    if (ctx->used == 0 && !(sync && ctx->stage_fn))
+    {
+        return SJSON_OK;
+    }
+
+    if (ctx->dry_run)
+    {
+        // Count only: formatted bytes are discarded, no callback
+        ctx->bytes_out += ctx->used;
+        ctx->used = 0;
+        return SJSON_OK;
+    }
+
+    if (ctx->stage_fn)
+    {
+        ctx->bytes_out += ctx->used;
+        return ctx->stage_fn(ctx, ctx->stage, sync);
+    }
+
+    if (ctx->producer)
+    {
+        // Pull mode: bytes are handed out when sjson_Pull() returns
+        ctx->token_start = ctx->used;
+        return SJSON_OK;
+    }
+
+    if (ctx->partial_callback)
+    {
+        // Everything written so far is complete; keep what is not accepted
+        size_t sent;
+        ctx->token_start = ctx->used;
+        sjson_status_t status = send_partial(ctx, ctx->used, &sent);
+        if (status != SJSON_OK)
+        {
+            return status;
+        }
+        return (ctx->used == 0) ? SJSON_OK : SJSON_WOULD_BLOCK;
+    }
+
+    return send_buffer(ctx, NULL, 0);
+}
+
+/*
+ * Free buffer space when the buffer is full. Blocking modes flush it all.
+ * In non-blocking mode only bytes of completed calls may be sent; if none
+ * can be sent the call in progress is rolled back so it can be retried.
+ */
+static sjson_status_t make_room(sjson_context_t *ctx)
+{
+    if (!ctx->partial_callback)
+    {
+        return flush_buffer(ctx, false);
+    }
+
+    size_t sent;
+    sjson_status_t status = send_partial(ctx, ctx->token_start, &sent);
+    if (status == SJSON_OK && sent == 0)
+    {
+        // Nothing completed is left to send: the call alone exceeds the buffer
+        status = (ctx->token_start == 0) ? SJSON_ERROR_BUFFER_FULL : SJSON_WOULD_BLOCK;
+    }
+
+    if (status != SJSON_OK)
+    {
+        rollback_token(ctx);
+    }
+    return status;
+}
+
+static sjson_status_t write(sjson_context_t *ctx, const char *data, size_t len)
+{
+    if (ctx->dry_run)
+    {
+        ctx->bytes_out += len;
+        return SJSON_OK;
+    }
+
+    // Output stages own the buffers and non-blocking sends may stop early,
+    // so large blocks are only passed through in plain callback mode
+    if (len >= ctx->buffer_size && !ctx->stage_fn && !ctx->partial_callback)
+    {
+        return write_passthrough(ctx, data, len);
+    }
+
+    while (len > 0)
+    {
+        // Flush lazily, only when there is more to write
+        if (ctx->used == ctx->buffer_size)
+        {
+            sjson_status_t status = make_room(ctx);
+            if (status != SJSON_OK)
+            {
+                return status;
+            }
+        }
+
+        size_t available = ctx->buffer_size - ctx->used;
+        size_t to_write = (len < available) ? len : available;
+
+        memcpy(ctx->buffer + ctx->used, data, to_write);
+        ctx->used += to_write;
+        data += to_write;
+        len -= to_write;
+    }
+
+    return SJSON_OK;
+}
+
+static sjson_status_t write_str(sjson_context_t *ctx, const char *str)
+{
+    return write(ctx, str, strlen(str));
+}
+
+/* Make room for n contiguous bytes, flushing if needed */
+static sjson_status_t reserve(sjson_context_t *ctx, size_t n)
+{
+    if (n > ctx->buffer_size)
+    {
+        // No amount of flushing makes this fit
+        if (ctx->partial_callback)
+        {
+            rollback_token(ctx);
+        }
+        return SJSON_ERROR_BUFFER_FULL;
+    }
+
+    while (ctx->buffer_size - ctx->used < n)
+    {
+        sjson_status_t status = make_room(ctx);
+        if (status != SJSON_OK)
+            return status;
+    }
+    return SJSON_OK;
+}
+
+static sjson_status_t write_char(sjson_context_t *ctx, char c)
+{
+    sjson_status_t status = reserve(ctx, 1);
+    if (status != SJSON_OK)
+        return status;
+
+    ctx->buffer[ctx->used++] = c;
+    return SJSON_OK;
+}
+
+/* ========================================================================
+ * Integer Formatting
+ * Locale-free, table-driven replacement for snprintf("%ld").
+ * ======================================================================== */
+
+/* Longest decimal int64/uint64: "-9223372036854775808" / "18446744073709551615" */
+#define SJSON_INT_MAX_CHARS 20
+
+static const char digit_pairs[200] = {
+    '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+    '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+    '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+    '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+    '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+    '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+    '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+    '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+    '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+    '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9'
+};
+
+/* Number of decimal digits in value (1..20) */
+static unsigned count_digits_u64(uint64_t value)
+{
+    unsigned digits = 1;
+    for (;;)
+    {
+        if (value < 10U) return digits;
+        if (value < 100U) return digits + 1;
+        if (value < 1000U) return digits + 2;
+        if (value < 10000U) return digits + 3;
+        value /= 10000U;
+        digits += 4;
+    }
+}
+
+/* Write value as decimal to out (no terminator), returns number of chars */
+static size_t format_u64(char *out, uint64_t value)
+{
+    size_t len = count_digits_u64(value);
+    char *p = out + len;
+
+    // Two digits per division, working backwards from the last digit
+    while (value >= 100U)
+    {
+        unsigned pair = (unsigned)(value % 100U) * 2U;
+        value /= 100U;
+        p -= 2;
+        p[0] = digit_pairs[pair];
+        p[1] = digit_pairs[pair + 1];
+    }
+
+    if (value >= 10U)
+    {
+        unsigned pair = (unsigned)value * 2U;
+        p -= 2;
+        p[0] = digit_pairs[pair];
+        p[1] = digit_pairs[pair + 1];
+    }
+    else
+    {
+        *--p = (char)('0' + value);
+    }
+
+    return len;
+}
+
+/* Index of the lowest set bit (mask != 0) */
+#if defined(__GNUC__)
+#define first_set_bit(mask) ((size_t)__builtin_ctz(mask))
+#else
+static size_t first_set_bit(uint32_t mask)
+{
+    size_t i = 0;
+    while ((mask & 1U) == 0)
+    {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+}
+#endif
+
+#if defined(__SSE2__)
+/*
+ * Sixteen digits of value (< 10^16) as bytes 0..9, most significant first.
+ * Every step splits all lanes at once with a reciprocal multiply:
+ * 8-digit halves -> 4-digit groups (32-bit lanes) -> digit pairs (16-bit
+ * lanes) -> digits (bytes).
+ */
+static __m128i digits16_sse2(uint64_t value)
+{
+    __m128i x = _mm_set_epi64x((long long)(value % 100000000U), (long long)(value / 100000000U));
+
+    // x / 10^4 = (x * 0xD1B71759) >> 45 for x < 10^8
+    __m128i q = _mm_srli_epi64(_mm_mul_epu32(x, _mm_set1_epi32((int)0xD1B71759)), 45);
+    __m128i r = _mm_sub_epi32(x, _mm_mul_epu32(q, _mm_set1_epi32(10000)));
+    x = _mm_or_si128(q, _mm_slli_epi64(r, 32));
+
+    // x / 100 = (x * 5243) >> 19 for x < 10^4
+    q = _mm_srli_epi16(_mm_mulhi_epu16(x, _mm_set1_epi32(5243)), 3);
+    r = _mm_sub_epi16(x, _mm_mullo_epi16(q, _mm_set1_epi32(100)));
+    x = _mm_or_si128(q, _mm_slli_epi32(r, 16));
+
+    // x / 10 = (x * 6554) >> 16 for x < 100
+    q = _mm_mulhi_epu16(x, _mm_set1_epi16(6554));
+    r = _mm_sub_epi16(x, _mm_mullo_epi16(q, _mm_set1_epi16(10)));
+    return _mm_or_si128(q, _mm_slli_epi16(r, 8));
+}
+#endif
+
+/*
+ * format_u64 for callers with at least 16 bytes of room at out: values of
+ * 9 to 16 digits (epoch timestamps, counters) are converted in one SSE2
+ * register and stored with their leading zeros dropped.
+ */
+static size_t format_u64_wide(char *out, uint64_t value)
+{
+#if defined(__SSE2__)
+    if (value >= 100000000U && value < UINT64_C(10000000000000000))
+    {
+        const __m128i zeros = _mm_set1_epi8('0');
+        __m128i digits = _mm_add_epi8(digits16_sse2(value), zeros);
+
+        // At least 9 digits, so the first non-zero is in the low half
+        size_t skip = first_set_bit(~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(digits, zeros)));
+
+        // Shift the leading zeros out in the register (a store and reload at
+        // an offset would stall on store forwarding); the tail is overwritten
+        const __m128i bits = _mm_cvtsi32_si128((int)(skip * 8));
+        const __m128i carry = _mm_sll_epi64(digits, _mm_cvtsi32_si128((int)(64 - skip * 8)));
+        digits = _mm_or_si128(_mm_srl_epi64(digits, bits), _mm_srli_si128(carry, 8));
+        _mm_storeu_si128((__m128i *)(void *)out, digits);
+        return 16 - skip;
+    }
+#endif
+    return format_u64(out, value);
+}
+
+static size_t format_i64_wide(char *out, int64_t value)
+{
+    if (value < 0)
+    {
+        // Negate in unsigned arithmetic so INT64_MIN does not overflow
+        out[0] = '-';
+        return 1 + format_u64_wide(out + 1, 0U - (uint64_t)value);
+    }
+    return format_u64_wide(out, (uint64_t)value);
+}
+
+/* 32-bit versions: narrower division, cheaper on 32-bit targets */
+static unsigned count_digits_u32(uint32_t value)
+{
+    unsigned digits = 1;
+    for (;;)
+    {
+        if (value < 10U) return digits;
+        if (value < 100U) return digits + 1;
+        if (value < 1000U) return digits + 2;
+        if (value < 10000U) return digits + 3;
+        value /= 10000U;
+        digits += 4;
+    }
+}
+
+static size_t format_u32(char *out, uint32_t value)
+{
+    size_t len = count_digits_u32(value);
+    char *p = out + len;
+
+    while (value >= 100U)
+    {
+        unsigned pair = (value % 100U) * 2U;
+        value /= 100U;
+        p -= 2;
+        p[0] = digit_pairs[pair];
+        p[1] = digit_pairs[pair + 1];
+    }
+
+    if (value >= 10U)
+    {
+        unsigned pair = value * 2U;
+        p -= 2;
+        p[0] = digit_pairs[pair];
+        p[1] = digit_pairs[pair + 1];
+    }
+    else
+    {
+        *--p = (char)('0' + value);
+    }
+
+    return len;
+}
+
+static size_t format_i32(char *out, int32_t value)
+{
+    if (value < 0)
+    {
+        out[0] = '-';
+        return 1 + format_u32(out + 1, 0U - (uint32_t)value);
+    }
+    return format_u32(out, (uint32_t)value);
+}
+
+/* Format integer straight into the context buffer when it fits */
+static sjson_status_t write_int(sjson_context_t *ctx, int64_t value)
+{
+    if (ctx->buffer_size - ctx->used >= SJSON_INT_MAX_CHARS)
+    {
+        ctx->used += format_i64_wide(ctx->buffer + ctx->used, value);
+        return SJSON_OK;
+    }
+
+    // Near the end of the buffer: format on the stack and let write() split it
+    char digits[SJSON_INT_MAX_CHARS];
+    return write(ctx, digits, format_i64_wide(digits, value));
+}
+
+static sjson_status_t write_uint(sjson_context_t *ctx, uint64_t value)
+{
+    if (ctx->buffer_size - ctx->used >= SJSON_INT_MAX_CHARS)
+    {
+        ctx->used += format_u64_wide(ctx->buffer + ctx->used, value);
+        return SJSON_OK;
+    }
+
+    char digits[SJSON_INT_MAX_CHARS];
+    return write(ctx, digits, format_u64_wide(digits, value));
+}
+
+/* ========================================================================
+ * Floating Point Formatting
+ * Shortest round-trip output using Grisu2 (Loitsch, "Printing Floating-Point
+ * Numbers Quickly and Accurately with Integers"). The digits always parse
+ * back to the same float/double. Grisu2 searches a slightly narrowed
+ * rounding interval without its boundaries, so about 0.1% of doubles and
+ * 0.2% of floats get one to three digits more than the shortest, e.g. the
+ * float 49665072, whose shorter form 49665070 lies exactly halfway to the
+ * next float (measured in tests/test_float_shortest.c).
+ * ======================================================================== */
+
+/* Longest output: "-1.2345678901234567e-308" */
+#define SJSON_FLOAT_MAX_CHARS 25
+
+/* Decimal exponent range printed without exponent notation */
+#define SJSON_FLOAT_MIN_EXP (-4)
+#define SJSON_FLOAT_MAX_EXP 15
+
+typedef struct {
+    uint64_t f;
+    int e;
+} diyfp_t;
+
+typedef struct {
+    uint64_t f;
+    int e;
+    int k;
+} cached_power_t;
+
+/* Normalized 64-bit approximations of 10^k for k = -300, -292, ..., 324 */
+static const cached_power_t cached_powers[] = {
+    { UINT64_C(0xAB70FE17C79AC6CA), -1060, -300 },
+    { UINT64_C(0xFF77B1FCBEBCDC4F), -1034, -292 },
+    { UINT64_C(0xBE5691EF416BD60C), -1007, -284 },
+    { UINT64_C(0x8DD01FAD907FFC3C),  -980, -276 },
+    { UINT64_C(0xD3515C2831559A83),  -954, -268 },
+    { UINT64_C(0x9D71AC8FADA6C9B5),  -927, -260 },
+    { UINT64_C(0xEA9C227723EE8BCB),  -901, -252 },
+    { UINT64_C(0xAECC49914078536D),  -874, -244 },
+    { UINT64_C(0x823C12795DB6CE57),  -847, -236 },
+    { UINT64_C(0xC21094364DFB5637),  -821, -228 },
+    { UINT64_C(0x9096EA6F3848984F),  -794, -220 },
+    { UINT64_C(0xD77485CB25823AC7),  -768, -212 },
+    { UINT64_C(0xA086CFCD97BF97F4),  -741, -204 },
+    { UINT64_C(0xEF340A98172AACE5),  -715, -196 },
+    { UINT64_C(0xB23867FB2A35B28E),  -688, -188 },
+    { UINT64_C(0x84C8D4DFD2C63F3B),  -661, -180 },
+    { UINT64_C(0xC5DD44271AD3CDBA),  -635, -172 },
+    { UINT64_C(0x936B9FCEBB25C996),  -608, -164 },
+    { UINT64_C(0xDBAC6C247D62A584),  -582, -156 },
+    { UINT64_C(0xA3AB66580D5FDAF6),  -555, -148 },
+    { UINT64_C(0xF3E2F893DEC3F126),  -529, -140 },
+    { UINT64_C(0xB5B5ADA8AAFF80B8),  -502, -132 },
+    { UINT64_C(0x87625F056C7C4A8B),  -475, -124 },
+    { UINT64_C(0xC9BCFF6034C13053),  -449, -116 },
+    { UINT64_C(0x964E858C91BA2655),  -422, -108 },
+    { UINT64_C(0xDFF9772470297EBD),  -396, -100 },
+    { UINT64_C(0xA6DFBD9FB8E5B88F),  -369,  -92 },
+    { UINT64_C(0xF8A95FCF88747D94),  -343,  -84 },
+    { UINT64_C(0xB94470938FA89BCF),  -316,  -76 },
+    { UINT64_C(0x8A08F0F8BF0F156B),  -289,  -68 },
+    { UINT64_C(0xCDB02555653131B6),  -263,  -60 },
+    { UINT64_C(0x993FE2C6D07B7FAC),  -236,  -52 },
+    { UINT64_C(0xE45C10C42A2B3B06),  -210,  -44 },
+    { UINT64_C(0xAA242499697392D3),  -183,  -36 },
+    { UINT64_C(0xFD87B5F28300CA0E),  -157,  -28 },
+    { UINT64_C(0xBCE5086492111AEB),  -130,  -20 },
+    { UINT64_C(0x8CBCCC096F5088CC),  -103,  -12 },
+    { UINT64_C(0xD1B71758E219652C),   -77,   -4 },
+    { UINT64_C(0x9C40000000000000),   -50,    4 },
+    { UINT64_C(0xE8D4A51000000000),   -24,   12 },
+    { UINT64_C(0xAD78EBC5AC620000),     3,   20 },
+    { UINT64_C(0x813F3978F8940984),    30,   28 },
+    { UINT64_C(0xC097CE7BC90715B3),    56,   36 },
+    { UINT64_C(0x8F7E32CE7BEA5C70),    83,   44 },
+    { UINT64_C(0xD5D238A4ABE98068),   109,   52 },
+    { UINT64_C(0x9F4F2726179A2245),   136,   60 },
+    { UINT64_C(0xED63A231D4C4FB27),   162,   68 },
+    { UINT64_C(0xB0DE65388CC8ADA8),   189,   76 },
+    { UINT64_C(0x83C7088E1AAB65DB),   216,   84 },
+    { UINT64_C(0xC45D1DF942711D9A),   242,   92 },
+    { UINT64_C(0x924D692CA61BE758),   269,  100 },
+    { UINT64_C(0xDA01EE641A708DEA),   295,  108 },
+    { UINT64_C(0xA26DA3999AEF774A),   322,  116 },
+    { UINT64_C(0xF209787BB47D6B85),   348,  124 },
+    { UINT64_C(0xB454E4A179DD1877),   375,  132 },
+    { UINT64_C(0x865B86925B9BC5C2),   402,  140 },
+    { UINT64_C(0xC83553C5C8965D3D),   428,  148 },
+    { UINT64_C(0x952AB45CFA97A0B3),   455,  156 },
+    { UINT64_C(0xDE469FBD99A05FE3),   481,  164 },
+    { UINT64_C(0xA59BC234DB398C25),   508,  172 },
+    { UINT64_C(0xF6C69A72A3989F5C),   534,  180 },
+    { UINT64_C(0xB7DCBF5354E9BECE),   561,  188 },
+    { UINT64_C(0x88FCF317F22241E2),   588,  196 },
+    { UINT64_C(0xCC20CE9BD35C78A5),   614,  204 },
+    { UINT64_C(0x98165AF37B2153DF),   641,  212 },
+    { UINT64_C(0xE2A0B5DC971F303A),   667,  220 },
+    { UINT64_C(0xA8D9D1535CE3B396),   694,  228 },
+    { UINT64_C(0xFB9B7CD9A4A7443C),   720,  236 },
+    { UINT64_C(0xBB764C4CA7A44410),   747,  244 },
+    { UINT64_C(0x8BAB8EEFB6409C1A),   774,  252 },
+    { UINT64_C(0xD01FEF10A657842C),   800,  260 },
+    { UINT64_C(0x9B10A4E5E9913129),   827,  268 },
+    { UINT64_C(0xE7109BFBA19C0C9D),   853,  276 },
+    { UINT64_C(0xAC2820D9623BF429),   880,  284 },
+    { UINT64_C(0x80444B5E7AA7CF85),   907,  292 },
+    { UINT64_C(0xBF21E44003ACDD2D),   933,  300 },
+    { UINT64_C(0x8E679C2F5E44FF8F),   960,  308 },
+    { UINT64_C(0xD433179D9C8CB841),   986,  316 },
+    { UINT64_C(0x9E19DB92B4E31BA9),  1013,  324 }
+};
+
+#define CACHED_POWERS_MIN_DEC_EXP (-300)
+#define CACHED_POWERS_DEC_STEP 8
+
+/* Target range for the binary exponent of the scaled value */
+#define GRISU_ALPHA (-60)
+#define GRISU_GAMMA (-32)
+
+static diyfp_t diyfp_sub(diyfp_t x, diyfp_t y)
+{
+    diyfp_t r = { x.f - y.f, x.e };
+    return r;
+}
+
+/* Upper 64 bits of the 128-bit product, rounded */
+static diyfp_t diyfp_mul(diyfp_t x, diyfp_t y)
+{
+    uint64_t x_lo = x.f & 0xFFFFFFFFU;
+    uint64_t x_hi = x.f >> 32;
+    uint64_t y_lo = y.f & 0xFFFFFFFFU;
+    uint64_t y_hi = y.f >> 32;
+
+    uint64_t p0 = x_lo * y_lo;
+    uint64_t p1 = x_lo * y_hi;
+    uint64_t p2 = x_hi * y_lo;
+    uint64_t p3 = x_hi * y_hi;
+
+    uint64_t mid = (p0 >> 32) + (p1 & 0xFFFFFFFFU) + (p2 & 0xFFFFFFFFU);
+    mid += (uint64_t)1 << 31;
+
+    diyfp_t r = { p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32), x.e + y.e + 64 };
+    return r;
+}
+
+static diyfp_t diyfp_normalize(diyfp_t x)
+{
+    while ((x.f >> 63) == 0)
+    {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+static diyfp_t diyfp_normalize_to(diyfp_t x, int target_e)
+{
+    x.f <<= x.e - target_e;
+    x.e = target_e;
+    return x;
+}
+
+/*
+ * Compute the normalized value v and the boundaries m- and m+ of the
+ * rounding interval for a finite positive value with the given significand
+ * field, exponent field and format parameters.
+ */
+static void compute_boundaries(uint64_t fraction, int biased_exp, int precision, int bias,
+                               diyfp_t *m_minus, diyfp_t *v, diyfp_t *m_plus)
+{
+    diyfp_t value;
+    if (biased_exp == 0)
+    {
+        value.f = fraction;
+        value.e = 1 - bias;
+    }
+    else
+    {
+        value.f = fraction | ((uint64_t)1 << (precision - 1));
+        value.e = biased_exp - bias;
+    }
+
+    // The lower boundary is closer if the significand is a power of two
+    bool lower_closer = (fraction == 0 && biased_exp > 1);
+
+    diyfp_t plus = { 2 * value.f + 1, value.e - 1 };
+    diyfp_t minus;
+    if (lower_closer)
+    {
+        minus.f = 4 * value.f - 1;
+        minus.e = value.e - 2;
+    }
+    else
+    {
+        minus.f = 2 * value.f - 1;
+        minus.e = value.e - 1;
+    }
+
+    *m_plus = diyfp_normalize(plus);
+    *m_minus = diyfp_normalize_to(minus, m_plus->e);
+    *v = diyfp_normalize(value);
+}
+
+static cached_power_t get_cached_power(int e)
+{
+    // k = ceil((alpha - e - 1) * log10(2)), 78913 / 2^18 ~= log10(2)
+    int f = GRISU_ALPHA - e - 1;
+    int k = (f * 78913) / (1 << 18) + (f > 0);
+    int index = (-CACHED_POWERS_MIN_DEC_EXP + k + (CACHED_POWERS_DEC_STEP - 1)) / CACHED_POWERS_DEC_STEP;
+    return cached_powers[index];
+}
+
+/* Number of decimal digits in n (1..10), pow10 receives 10^(digits-1) */
+static int find_largest_pow10(uint32_t n, uint32_t *pow10)
+{
+    uint32_t p = 1000000000U;
+    int digits = 10;
+    while (digits > 1 && n < p)
+    {
+        p /= 10U;
+        digits--;
+    }
+    *pow10 = p;
+    return digits;
+}
+
+/* Nudge the last digit towards the exact value while staying in range */
+static void grisu2_round(char *buf, int len, uint64_t dist, uint64_t delta,
+                         uint64_t rest, uint64_t ten_k)
+{
+    while (rest < dist && delta - rest >= ten_k &&
+           (rest + ten_k < dist || dist - rest > rest + ten_k - dist))
+    {
+        buf[len - 1]--;
+        rest += ten_k;
+    }
+}
+
+/*
+ * Generate the shortest digit string within (M-, M+). On return
+ * value = digits * 10^decimal_exponent.
+ */
+static int grisu2_digit_gen(char *buf, int *decimal_exponent,
+                            diyfp_t m_minus, diyfp_t w, diyfp_t m_plus)
+{
+    uint64_t delta = diyfp_sub(m_plus, m_minus).f;
+    uint64_t dist = diyfp_sub(m_plus, w).f;
+
+    int shift = -m_plus.e;
+    uint64_t one = (uint64_t)1 << shift;
+
+    uint32_t p1 = (uint32_t)(m_plus.f >> shift);
+    uint64_t p2 = m_plus.f & (one - 1);
+
+    uint32_t pow10;
+    int n = find_largest_pow10(p1, &pow10);
+    int len = 0;
+
+    // Integral digits
+    while (n > 0)
+    {
+        uint32_t d = p1 / pow10;
+        p1 %= pow10;
+        buf[len++] = (char)('0' + d);
+        n--;
+
+        uint64_t rest = ((uint64_t)p1 << shift) + p2;
+        if (rest <= delta)
+        {
+            *decimal_exponent += n;
+            grisu2_round(buf, len, dist, delta, rest, (uint64_t)pow10 << shift);
+            return len;
+        }
+        pow10 /= 10U;
+    }
+
+    // Fractional digits
+    int m = 0;
+    for (;;)
+    {
+        p2 *= 10U;
+        buf[len++] = (char)('0' + (p2 >> shift));
+        p2 &= one - 1;
+        m++;
+
+        delta *= 10U;
+        dist *= 10U;
+        if (p2 <= delta)
+        {
+            break;
+        }
+    }
+
+    *decimal_exponent -= m;
+    grisu2_round(buf, len, dist, delta, p2, one);
+    return len;
+}
+
+static int grisu2(char *buf, int *decimal_exponent,
+                  diyfp_t m_minus, diyfp_t v, diyfp_t m_plus)
+{
+    cached_power_t cached = get_cached_power(m_plus.e);
+    diyfp_t c_minus_k = { cached.f, cached.e };
+
+    diyfp_t w = diyfp_mul(v, c_minus_k);
+    diyfp_t w_minus = diyfp_mul(m_minus, c_minus_k);
+    diyfp_t w_plus = diyfp_mul(m_plus, c_minus_k);
+
+    // Shrink the interval by one ulp on both sides to stay conservative
+    diyfp_t lo = { w_minus.f + 1, w_minus.e };
+    diyfp_t hi = { w_plus.f - 1, w_plus.e };
+
+    *decimal_exponent = -cached.k;
+    return grisu2_digit_gen(buf, decimal_exponent, lo, w, hi);
+}
+
+/*
+ * Lay out digits (value = digits * 10^decimal_exponent) as a JSON number,
+ * choosing plain or exponent notation. Returns number of chars written.
+ */
+static size_t format_decimal_digits(char *out, const char *digits, int len, int decimal_exponent)
+{
+    // Position of the decimal point relative to the first digit
+    int point = len + decimal_exponent;
+    char *p = out;
+
+    if (len <= point && point <= SJSON_FLOAT_MAX_EXP)
+    {
+        // Integer: digits followed by zeros, e.g. 1500
+        memcpy(p, digits, (size_t)len);
+        p += len;
+        memset(p, '0', (size_t)(point - len));
+        p += point - len;
+    }
+    else if (0 < point && point <= SJSON_FLOAT_MAX_EXP)
+    {
+        // Decimal point inside the digits, e.g. 23.5
+        memcpy(p, digits, (size_t)point);
+        p += point;
+        *p++ = '.';
+        memcpy(p, digits + point, (size_t)(len - point));
+        p += len - point;
+    }
+    else if (SJSON_FLOAT_MIN_EXP < point && point <= 0)
+    {
+        // Leading zeros, e.g. 0.0025
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', (size_t)(-point));
+        p += -point;
+        memcpy(p, digits, (size_t)len);
+        p += len;
+    }
+    else
+    {
+        // Exponent notation, e.g. 1e20 or 1.5e-7
+        *p++ = digits[0];
+        if (len > 1)
+        {
+            *p++ = '.';
+            memcpy(p, digits + 1, (size_t)(len - 1));
+            p += len - 1;
+        }
+        *p++ = 'e';
+
+        int exp10 = point - 1;
+        if (exp10 < 0)
+        {
+            *p++ = '-';
+            exp10 = -exp10;
+        }
+        p += format_u64(p, (uint64_t)exp10);
+    }
+
+    return (size_t)(p - out);
+}
+
+/* Shortest round-trip double. NaN and infinity are not JSON and become null. */
+static size_t format_double(char *out, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint64_t fraction = bits & ((UINT64_C(1) << 52) - 1);
+    int biased_exp = (int)((bits >> 52) & 0x7FF);
+    char *p = out;
+
+    if (biased_exp == 0x7FF)
+    {
+        memcpy(out, "null", 4);
+        return 4;
+    }
+
+    if (bits >> 63)
+    {
+        *p++ = '-';
+    }
+
+    if (biased_exp == 0 && fraction == 0)
+    {
+        *p++ = '0';
+        return (size_t)(p - out);
+    }
+
+    diyfp_t m_minus, v, m_plus;
+    compute_boundaries(fraction, biased_exp, 53, 1075, &m_minus, &v, &m_plus);
+
+    char digits[18];
+    int decimal_exponent;
+    int len = grisu2(digits, &decimal_exponent, m_minus, v, m_plus);
+
+    return (size_t)(p - out) + format_decimal_digits(p, digits, len, decimal_exponent);
+}
+
+/* Shortest round-trip float, using single precision rounding boundaries */
+static size_t format_float(char *out, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t fraction = bits & ((UINT32_C(1) << 23) - 1);
+    int biased_exp = (int)((bits >> 23) & 0xFF);
+    char *p = out;
+
+    if (biased_exp == 0xFF)
+    {
+        memcpy(out, "null", 4);
+        return 4;
+    }
+
+    if (bits >> 31)
+    {
+        *p++ = '-';
+    }
+
+    if (biased_exp == 0 && fraction == 0)
+    {
+        *p++ = '0';
+        return (size_t)(p - out);
+    }
+
+    diyfp_t m_minus, v, m_plus;
+    compute_boundaries(fraction, biased_exp, 24, 150, &m_minus, &v, &m_plus);
+
+    char digits[18];
+    int decimal_exponent;
+    int len = grisu2(digits, &decimal_exponent, m_minus, v, m_plus);
+
+    return (size_t)(p - out) + format_decimal_digits(p, digits, len, decimal_exponent);
+}
+
+/*
+ * IEEE 754 binary16, digits that round-trip to the same half. Shortest
+ * except for about 1.7% of halves (1098 of 63488 finite ones), whose
+ * shorter form lies exactly halfway to a neighbour: Grisu2 leaves the
+ * boundaries out, so e.g. 4112 is not written as 4110 (a tie).
+ */
+static size_t format_half(char *out, uint16_t bits)
+{
+    uint32_t fraction = bits & 0x3FFU;
+    int biased_exp = (int)((bits >> 10) & 0x1F);
+    char *p = out;
+
+    if (biased_exp == 0x1F)
+    {
+        memcpy(out, "null", 4);
+        return 4;
+    }
+
+    if (bits >> 15)
+    {
+        *p++ = '-';
+    }
+
+    if (biased_exp == 0 && fraction == 0)
+    {
+        *p++ = '0';
+        return (size_t)(p - out);
+    }
+
+    diyfp_t m_minus, v, m_plus;
+    compute_boundaries(fraction, biased_exp, 11, 25, &m_minus, &v, &m_plus);
+
+    char digits[18];
+    int decimal_exponent;
+    int len = grisu2(digits, &decimal_exponent, m_minus, v, m_plus);
+
+    return (size_t)(p - out) + format_decimal_digits(p, digits, len, decimal_exponent);
+}
+
+/* Exact value of a binary16 (every half is representable as a float) */
+static float half_to_float(uint16_t bits)
+{
+    uint32_t sign = (uint32_t)(bits >> 15) << 31;
+    uint32_t exp = (bits >> 10) & 0x1F;
+    uint32_t fraction = bits & 0x3FFU;
+    uint32_t out;
+
+    if (exp == 0x1F)
+    {
+        out = sign | 0x7F800000U | (fraction << 13);
+    }
+    else if (exp != 0)
+    {
+        out = sign | ((exp + 112U) << 23) | (fraction << 13);
+    }
+    else if (fraction == 0)
+    {
+        out = sign;
+    }
+    else
+    {
+        // Subnormal half: normalize into a float
+        exp = 113;
+        while ((fraction & 0x400U) == 0)
+        {
+            fraction <<= 1;
+            exp--;
+        }
+        out = sign | (exp << 23) | ((fraction & 0x3FFU) << 13);
+    }
+
+    float value;
+    memcpy(&value, &out, sizeof(value));
+    return value;
+}
+
+/* Powers of ten for fixed precision and decimals, 10^0 .. 10^SJSON_DECIMAL_MAX_SCALE */
+static const uint64_t pow10_u64[SJSON_DECIMAL_MAX_SCALE + 1] = {
+    UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+    UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+    UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+    UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+    UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+    UINT64_C(100000000000000000), UINT64_C(1000000000000000000)
+};
+
+/* Longest decimal: "-9.223372036854775808" */
+#define SJSON_DECIMAL_MAX_CHARS 21
+
+/*
+ * Format mantissa / 10^scale exactly, e.g. (2345, 2) -> 23.45.
+ * With trim set, trailing fractional zeros (and a bare '.') are dropped.
+ */
+static size_t format_scaled_i64(char *out, int64_t mantissa, unsigned scale, bool trim)
+{
+    char *p = out;
+    uint64_t magnitude = (uint64_t)mantissa;
+    if (mantissa < 0)
+    {
+        *p++ = '-';
+        magnitude = 0U - magnitude;
+    }
+
+    if (scale == 0)
+    {
+        return (size_t)(p - out) + format_u64(p, magnitude);
+    }
+
+    uint64_t divisor = pow10_u64[scale];
+    uint64_t frac = magnitude % divisor;
+    p += format_u64(p, magnitude / divisor);
+
+    if (trim)
+    {
+        if (frac == 0)
+        {
+            return (size_t)(p - out);
+        }
+        while (frac % 10U == 0)
+        {
+            frac /= 10U;
+            scale--;
+        }
+    }
+
+    // Fraction with leading zeros, e.g. 5 with scale 3 -> .005
+    *p++ = '.';
+    unsigned frac_digits = count_digits_u64(frac);
+    memset(p, '0', scale - frac_digits);
+    p += scale - frac_digits;
+    p += format_u64(p, frac);
+
+    return (size_t)(p - out);
+}
+
+/*
+ * Fixed precision formatting of a float (or half, which converts exactly)
+ * via a scaled integer. Values whose scaled magnitude does not fit an int64
+ * fall back to shortest float formatting.
+ */
+static size_t format_fixed(char *out, float value, unsigned decimals, bool trim)
+{
+    double scaled = (double)value * (double)pow10_u64[decimals];
+
+    // Also rejects NaN (comparisons false) and infinity
+    if (!(scaled > -9.0e18 && scaled < 9.0e18))
+    {
+        return format_float(out, value);
+    }
+
+    // Round half away from zero
+    int64_t mantissa = (int64_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+    return format_scaled_i64(out, mantissa, decimals, trim);
+}
+
+static sjson_status_t write_double(sjson_context_t *ctx, double value)
+{
+    if (ctx->buffer_size - ctx->used >= SJSON_FLOAT_MAX_CHARS)
+    {
+        ctx->used += format_double(ctx->buffer + ctx->used, value);
+        return SJSON_OK;
+    }
+
+    char digits[SJSON_FLOAT_MAX_CHARS];
+    return write(ctx, digits, format_double(digits, value));
+}
+
+static sjson_status_t write_decimal(sjson_context_t *ctx, int64_t mantissa, unsigned scale)
+{
+    if (ctx->buffer_size - ctx->used >= SJSON_DECIMAL_MAX_CHARS)
+    {
+        ctx->used += format_scaled_i64(ctx->buffer + ctx->used, mantissa, scale, false);
+        return SJSON_OK;
+    }
+
+    char digits[SJSON_DECIMAL_MAX_CHARS];
+    return write(ctx, digits, format_scaled_i64(digits, mantissa, scale, false));
+}
+
+/* Float in the context's configured mode: shortest or fixed decimals */
+static size_t format_float_ctx(const sjson_context_t *ctx, char *out, float value)
+{
+    if (ctx->float_precision == SJSON_FLOAT_SHORTEST)
+    {
+        return format_float(out, value);
+    }
+    return format_fixed(out, value, (unsigned)ctx->float_precision, ctx->float_trim_zeros);
+}
+
+static size_t format_half_ctx(const sjson_context_t *ctx, char *out, uint16_t bits)
+{
+    if (ctx->float_precision == SJSON_FLOAT_SHORTEST)
+    {
+        return format_half(out, bits);
+    }
+    return format_fixed(out, half_to_float(bits), (unsigned)ctx->float_precision, ctx->float_trim_zeros);
+}
+
+static sjson_status_t write_float(sjson_context_t *ctx, float value)
+{
+    if (ctx->buffer_size - ctx->used >= SJSON_FLOAT_MAX_CHARS)
+    {
+        ctx->used += format_float_ctx(ctx, ctx->buffer + ctx->used, value);
+        return SJSON_OK;
+    }
+
+    char digits[SJSON_FLOAT_MAX_CHARS];
+    return write(ctx, digits, format_float_ctx(ctx, digits, value));
+}
+
+/* ========================================================================
+ * Timestamp Formatting
+ * RFC 3339 in UTC with integer arithmetic only; the date and time of the
+ * last second are cached in the context.
+ * ======================================================================== */
+
+/* Longest timestamp, with quotes: "YYYY-MM-DDTHH:MM:SS.nnnnnnnnnZ" */
+#define SJSON_TIMESTAMP_MAX_CHARS 32
+#define SJSON_TIMESTAMP_MAX_PRECISION 9
+
+static void put_2digits(char *out, unsigned value)
+{
+    out[0] = digit_pairs[value * 2U];
+    out[1] = digit_pairs[value * 2U + 1U];
+}
+
+/* "YYYY-MM-DDTHH:MM:SS" for an epoch second (int64 nanoseconds stay in years 1677..2262) */
+static void format_date_time(char *out, int64_t second)
+{
+    int64_t days = second / 86400;
+    int64_t rest = second % 86400;
+    if (rest < 0)
+    {
+        rest += 86400;
+        days--;
+    }
+
+    // Civil date from days since 1970-01-01 (H. Hinnant, "chrono-Compatible
+    // Low-Level Date Algorithms"), in 400-year eras starting on March 1st
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned doe = (unsigned)(days - era * 146097);
+    unsigned yoe = (doe - doe / 1460U + doe / 36524U - doe / 146096U) / 365U;
+    unsigned doy = doe - (365U * yoe + yoe / 4U - yoe / 100U);
+    unsigned mp = (5U * doy + 2U) / 153U;
+    unsigned day = doy - (153U * mp + 2U) / 5U + 1U;
+    unsigned month = mp < 10U ? mp + 3U : mp - 9U;
+    unsigned year = (unsigned)(era * 400 + yoe) + (month <= 2U);
+
+    unsigned sec = (unsigned)rest;
+    put_2digits(out, year / 100U);
+    put_2digits(out + 2, year % 100U);
+    out[4] = '-';
+    put_2digits(out + 5, month);
+    out[7] = '-';
+    put_2digits(out + 8, day);
+    out[10] = 'T';
+    put_2digits(out + 11, sec / 3600U);
+    out[13] = ':';
+    put_2digits(out + 14, sec / 60U % 60U);
+    out[16] = ':';
+    put_2digits(out + 17, sec % 60U);
+}
+
+/* Quoted timestamp with precision fractional digits (truncated) */
+static size_t format_timestamp(sjson_context_t *ctx, char *out, int64_t epoch_ns, unsigned precision)
+{
+    int64_t second = epoch_ns / 1000000000;
+    int64_t nanos = epoch_ns % 1000000000;
+    if (nanos < 0)
+    {
+        nanos += 1000000000;
+        second--;
+    }
+
+    if (second != ctx->ts_second)
+    {
+        format_date_time(ctx->ts_prefix, second);
+        ctx->ts_second = second;
+    }
+
+    char *p = out;
+    *p++ = '"';
+    memcpy(p, ctx->ts_prefix, sizeof(ctx->ts_prefix));
+    p += sizeof(ctx->ts_prefix);
+
+    if (precision > 0)
+    {
+        // Fixed width: the fraction with its leading zeros
+        uint32_t frac = (uint32_t)((uint64_t)nanos / pow10_u64[SJSON_TIMESTAMP_MAX_PRECISION - precision]);
+        *p++ = '.';
+        char *end = p + precision;
+        for (char *q = end; q > p; frac /= 10U)
+        {
+            *--q = (char)('0' + frac % 10U);
+        }
+        p = end;
+    }
+
+    *p++ = 'Z';
+    *p++ = '"';
+    return (size_t)(p - out);
+}
+
+static sjson_status_t write_timestamp(sjson_context_t *ctx, int64_t epoch_ns, unsigned precision)
+{
+    if (ctx->buffer_size - ctx->used >= SJSON_TIMESTAMP_MAX_CHARS)
+    {
+        ctx->used += format_timestamp(ctx, ctx->buffer + ctx->used, epoch_ns, precision);
+        return SJSON_OK;
+    }
+
+    char chars[SJSON_TIMESTAMP_MAX_CHARS];
+    return write(ctx, chars, format_timestamp(ctx, chars, epoch_ns, precision));
+}
+
+/* ========================================================================
+ * Base64 Encoding
+ * RFC 4648 standard alphabet with padding, encoded straight into the buffer.
+ * ======================================================================== */
+
+static const char base64_chars[64] = {
+    'A','B','C','D','E','F','G','H','I','J','K','L','M','N','O','P',
+    'Q','R','S','T','U','V','W','X','Y','Z','a','b','c','d','e','f',
+    'g','h','i','j','k','l','m','n','o','p','q','r','s','t','u','v',
+    'w','x','y','z','0','1','2','3','4','5','6','7','8','9','+','/'
+};
+
+/* Encoded length of len bytes, including padding */
+static size_t base64_length(size_t len)
+{
+    return (len + 2) / 3 * 4;
+}
+
+/* Encode 1 or 2 trailing bytes as one padded quad */
+static void base64_encode_tail(char *out, const unsigned char *in, size_t len)
+{
+    uint32_t v = (uint32_t)in[0] << 16 | (len > 1 ? (uint32_t)in[1] << 8 : 0);
+    out[0] = base64_chars[v >> 18];
+    out[1] = base64_chars[(v >> 12) & 0x3F];
+    out[2] = (len > 1) ? base64_chars[(v >> 6) & 0x3F] : '=';
+    out[3] = '=';
+}
+
+/* Encode groups * 3 bytes into groups * 4 chars */
+static void base64_encode_groups(char *out, const unsigned char *in, size_t groups)
+{
+    size_t i = 0;
+
+#if defined(__SSSE3__)
+    // 12 bytes -> 16 chars per step (16 byte loads, so stop one step early)
+    const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i offsets = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    for (; i + 6 <= groups; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(const void *)(in + i * 3));
+        // Spread each 3-byte group over 32 bits, then move the four 6-bit
+        // fields into separate bytes with two multiplies
+        v = _mm_shuffle_epi8(v, shuffle);
+        __m128i hi = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0FC0FC00)),
+                                     _mm_set1_epi32(0x04000040));
+        __m128i lo = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003F03F0)),
+                                     _mm_set1_epi32(0x01000010));
+        v = _mm_or_si128(hi, lo);
+        // Map 0..63 to the alphabet: add a per-range offset picked by pshufb
+        __m128i index = _mm_subs_epu8(v, _mm_set1_epi8(51));
+        index = _mm_sub_epi8(index, _mm_cmpgt_epi8(v, _mm_set1_epi8(25)));
+        v = _mm_add_epi8(v, _mm_shuffle_epi8(offsets, index));
+        _mm_storeu_si128((__m128i *)(void *)(out + i * 4), v);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    // 48 bytes -> 64 chars per step, de-interleaved loads and a 64-entry lookup
+    const uint8x16x4_t table = vld1q_u8_x4((const uint8_t *)base64_chars);
+    const uint8x16_t low6 = vdupq_n_u8(0x3F);
+    for (; i + 16 <= groups; i += 16)
+    {
+        uint8x16x3_t v = vld3q_u8(in + i * 3);
+        uint8x16x4_t r;
+        r.val[0] = vshrq_n_u8(v.val[0], 2);
+        r.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(v.val[0], 4), vshrq_n_u8(v.val[1], 4)), low6);
+        r.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(v.val[1], 2), vshrq_n_u8(v.val[2], 6)), low6);
+        r.val[3] = vandq_u8(v.val[2], low6);
+        r.val[0] = vqtbl4q_u8(table, r.val[0]);
+        r.val[1] = vqtbl4q_u8(table, r.val[1]);
+        r.val[2] = vqtbl4q_u8(table, r.val[2]);
+        r.val[3] = vqtbl4q_u8(table, r.val[3]);
+        vst4q_u8((uint8_t *)out + i * 4, r);
+    }
+#endif
+
+    for (; i < groups; i++)
+    {
+        const unsigned char *p = in + i * 3;
+        uint32_t v = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+        char *q = out + i * 4;
+        q[0] = base64_chars[v >> 18];
+        q[1] = base64_chars[(v >> 12) & 0x3F];
+        q[2] = base64_chars[(v >> 6) & 0x3F];
+        q[3] = base64_chars[v & 0x3F];
+    }
+}
+
+/*
+ * Write data as a quoted base64 string. Whole 3-byte groups are encoded into
+ * the free space of the buffer, flushing between batches, so only the last
+ * 1-2 bytes ever need padding and nothing is staged outside the buffer.
+ */
+static sjson_status_t write_base64(sjson_context_t *ctx, const unsigned char *data, size_t len)
+{
+    if (ctx->dry_run)
+    {
+        ctx->bytes_out += base64_length(len) + 2;
+        return SJSON_OK;
+    }
+
+    sjson_status_t status = write_char(ctx, '"');
+    if (status != SJSON_OK)
+        return status;
+
+    size_t groups = len / 3;
+    while (groups > 0)
+    {
+        status = reserve(ctx, 4);
+        if (status != SJSON_OK)
+            return status;
+
+        size_t batch = (ctx->buffer_size - ctx->used) / 4;
+        if (batch > groups)
+        {
+            batch = groups;
+        }
+        base64_encode_groups(ctx->buffer + ctx->used, data, batch);
+        ctx->used += batch * 4;
+        data += batch * 3;
+        groups -= batch;
+    }
+
+    if (len % 3 != 0)
+    {
+        status = reserve(ctx, 4);
+        if (status != SJSON_OK)
+            return status;
+
+        base64_encode_tail(ctx->buffer + ctx->used, data, len % 3);
+        ctx->used += 4;
+    }
+
+    return write_char(ctx, '"');
+}
+
+/* ========================================================================
+ * String Escaping (RFC 8259)
+ * '"', '\\' and bytes below 0x20 are escaped, everything else (including
+ * UTF-8 sequences) is copied verbatim. Clean runs are located with SIMD
+ * when the target has it and bulk-copied into the buffer.
+ * ======================================================================== */
+
+static const char hex_digits[16] = {
+    '0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f'
+};
+
+static bool needs_escape(unsigned char c)
+{
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+/* Escape sequence for a byte that needs_escape(), returns its length */
+static size_t escape_byte(unsigned char c, char *out)
+{
+    out[0] = '\\';
+    switch (c)
+    {
+    case '"':  out[1] = '"';  return 2;
+    case '\\': out[1] = '\\'; return 2;
+    case '\b': out[1] = 'b';  return 2;
+    case '\f': out[1] = 'f';  return 2;
+    case '\n': out[1] = 'n';  return 2;
+    case '\r': out[1] = 'r';  return 2;
+    case '\t': out[1] = 't';  return 2;
+    default:
+        out[1] = 'u';
+        out[2] = '0';
+        out[3] = '0';
+        out[4] = hex_digits[c >> 4];
+        out[5] = hex_digits[c & 0x0F];
+        return 6;
+    }
+}
+
+/* Length of the leading run of str that needs no escaping */
+static size_t scan_clean(const char *str, size_t len)
+{
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control_max = _mm256_set1_epi8(0x1F);
+    for (; i + 32 <= len; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(const void *)(str + i));
+        __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(v, control_max), v));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+        if (mask != 0)
+        {
+            return i + first_set_bit(mask);
+        }
+    }
+#endif
+
+#if defined(__SSE2__)
+    const __m128i quote16 = _mm_set1_epi8('"');
+    const __m128i backslash16 = _mm_set1_epi8('\\');
+    const __m128i control_max16 = _mm_set1_epi8(0x1F);
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(const void *)(str + i));
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote16), _mm_cmpeq_epi8(v, backslash16)),
+            _mm_cmpeq_epi8(_mm_min_epu8(v, control_max16), v));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(hit);
+        if (mask != 0)
+        {
+            return i + first_set_bit(mask);
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint8x16_t quote16 = vdupq_n_u8('"');
+    const uint8x16_t backslash16 = vdupq_n_u8('\\');
+    const uint8x16_t control_end16 = vdupq_n_u8(0x20);
+    for (; i + 16 <= len; i += 16)
+    {
+        uint8x16_t v = vld1q_u8((const uint8_t *)str + i);
+        uint8x16_t hit = vorrq_u8(vorrq_u8(vceqq_u8(v, quote16), vceqq_u8(v, backslash16)),
+                                  vcltq_u8(v, control_end16));
+        // Narrow to 4 bits per byte so the first hit can be located in a u64
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(hit), 4)), 0);
+        if (mask != 0)
+        {
+            return i + (size_t)(__builtin_ctzll(mask) >> 2);
+        }
+    }
+#endif
+
+    // SWAR: 8 bytes at a time, exact position found by the scalar loop below
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t v;
+        memcpy(&v, str + i, sizeof(v));
+        const uint64_t ones = UINT64_C(0x0101010101010101);
+        const uint64_t highs = UINT64_C(0x8080808080808080);
+        uint64_t q = v ^ (ones * '"');
+        uint64_t b = v ^ (ones * '\\');
+        uint64_t hit = ((q - ones) & ~q) | ((b - ones) & ~b) | ((v - ones * 0x20) & ~v);
+        if (hit & highs)
+        {
+            break;
+        }
+    }
+
+    while (i < len && !needs_escape((unsigned char)str[i]))
+    {
+        i++;
+    }
+    return i;
+}
+
+/* Write str escaped (without surrounding quotes) */
+static sjson_status_t write_escaped(sjson_context_t *ctx, const char *str, size_t len)
+{
+    while (len > 0)
+    {
+        size_t run = scan_clean(str, len);
+        if (run > 0)
+        {
+            sjson_status_t status = write(ctx, str, run);
+            if (status != SJSON_OK)
+                return status;
+
+            str += run;
+            len -= run;
+            if (len == 0)
+            {
+                break;
+            }
+        }
+
+        char seq[6];
+        sjson_status_t status = write(ctx, seq, escape_byte((unsigned char)*str, seq));
+        if (status != SJSON_OK)
+            return status;
+
+        str++;
+        len--;
+    }
+
+    return SJSON_OK;
+}
+
+/*
+ * Write str quoted and escaped, followed by ':' when it is an object key.
+ * Strings without escapes that fit in the free space are copied in one go.
+ */
+static sjson_status_t write_quoted(sjson_context_t *ctx, const char *str, size_t len, bool is_key)
+{
+    size_t run = 0;
+
+    if (ctx->buffer_size - ctx->used >= len + 3 && !ctx->dry_run)
+    {
+        run = scan_clean(str, len);
+        if (run == len)
+        {
+            char *p = ctx->buffer + ctx->used;
+            *p++ = '"';
+            memcpy(p, str, len);
+            p += len;
+            *p++ = '"';
+            if (is_key)
+            {
+                *p++ = ':';
+            }
+            ctx->used = (size_t)(p - ctx->buffer);
+            return SJSON_OK;
+        }
+    }
+
+    sjson_status_t status = write_char(ctx, '"');
+    if (status != SJSON_OK)
+        return status;
+
+    // Reuse the clean prefix found above, if any
+    status = write(ctx, str, run);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_escaped(ctx, str + run, len - run);
+    if (status != SJSON_OK)
+        return status;
+
+    return is_key ? write(ctx, "\":", 2) : write_char(ctx, '"');
+}
+
+/* Write a quoted, escaped JSON string */
+static sjson_status_t write_string(sjson_context_t *ctx, const char *str)
+{
+    return write_quoted(ctx, str, strlen(str), false);
+}
+
+/* Write object key prefix: "key": */
+static sjson_status_t write_key(sjson_context_t *ctx, const char *key)
+{
+    return write_quoted(ctx, key, strlen(key), true);
+}
+
+/* Write comma if needed before next item at current depth */
+static sjson_status_t add_comma_if_needed(sjson_context_t *ctx)
+{
+    if (ctx->needs_comma[ctx->depth])
+    {
+        sjson_status_t status = write_char(ctx, ',');
+        if (status != SJSON_OK)
+            return status;
+    }
+    ctx->needs_comma[ctx->depth] = true; // Next item will need comma
+    return SJSON_OK;
+}
+
+/* Check if in valid object state (for AddXToObject functions) */
+static sjson_status_t check_object_state(sjson_context_t *ctx)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    // No other values while a string value is open
+    if (ctx->finalized || ctx->in_string)
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    // Must be in an object (depth > 0 and top of stack is '}')
+    if (ctx->depth == 0 || ctx->depth_stack[ctx->depth - 1] != '}')
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    begin_token(ctx);
+    return SJSON_OK;
+}
+
+/* Check if in valid array state (for AddXToArray functions) */
+static sjson_status_t check_array_state(sjson_context_t *ctx)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    // No other values while a string value is open
+    if (ctx->finalized || ctx->in_string)
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    // Must be in an array (depth > 0 and top of stack is ']')
+    if (ctx->depth == 0 || ctx->depth_stack[ctx->depth - 1] != ']')
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    begin_token(ctx);
+    return SJSON_OK;
+}
+
+/* ========================================================================
+ * Array Elements
+ * Tight loops for the array writers: values are read every stride bytes
+ * (fields of an array of structs, or dense arrays) and formatted straight
+ * into the buffer with their separators.
+ * ======================================================================== */
+
+/* Write: "key":[ in the current object */
+static sjson_status_t open_array_member(sjson_context_t *ctx, const char *key)
+{
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_char(ctx, '[');
+}
+
+/*
+ * Element loop for one value type: load (any alignment), format straight
+ * into the buffer while there is room, via the stack near the end.
+ */
+#define SJSON_ELEMENT_WRITER(name, type, max_chars, format)                              \
+    static sjson_status_t name(sjson_context_t *ctx, const char *base, size_t stride,    \
+                               size_t count)                                             \
+    {                                                                                    \
+        for (size_t i = 0; i < count; i++, base += stride)                               \
+        {                                                                                \
+            type value;                                                                  \
+            memcpy(&value, base, sizeof(value));                                         \
+                                                                                         \
+            if (ctx->buffer_size - ctx->used > (max_chars))                              \
+            {                                                                            \
+                char *p = ctx->buffer + ctx->used;                                       \
+                if (i > 0)                                                               \
+                {                                                                        \
+                    *p++ = ',';                                                          \
+                }                                                                        \
+                ctx->used = (size_t)(p - ctx->buffer) + format(ctx, p, value);           \
+                continue;                                                                \
+            }                                                                            \
+                                                                                         \
+            char digits[(max_chars) + 1];                                                \
+            size_t len = 0;                                                              \
+            if (i > 0)                                                                   \
+            {                                                                            \
+                digits[len++] = ',';                                                     \
+            }                                                                            \
+            len += format(ctx, digits + len, value);                                     \
+            sjson_status_t status = write(ctx, digits, len);                             \
+            if (status != SJSON_OK)                                                      \
+                return status;                                                           \
+        }                                                                                \
+        return SJSON_OK;                                                                 \
+    }
+
+/* Formatters with a common signature for the element loops */
+static size_t format_i32_elem(const sjson_context_t *ctx, char *out, int32_t value)
+{
+    (void)ctx;
+    return format_i32(out, value);
+}
+
+static size_t format_u32_elem(const sjson_context_t *ctx, char *out, uint32_t value)
+{
+    (void)ctx;
+    return format_u32(out, value);
+}
+
+static size_t format_i64_elem(const sjson_context_t *ctx, char *out, int64_t value)
+{
+    (void)ctx;
+    return format_i64_wide(out, value);
+}
+
+static size_t format_u64_elem(const sjson_context_t *ctx, char *out, uint64_t value)
+{
+    (void)ctx;
+    return format_u64_wide(out, value);
+}
+
+static size_t format_double_elem(const sjson_context_t *ctx, char *out, double value)
+{
+    (void)ctx;
+    return format_double(out, value);
+}
+
+SJSON_ELEMENT_WRITER(write_int8_elements, int8_t, 4, format_i32_elem)
+SJSON_ELEMENT_WRITER(write_int16_elements, int16_t, 6, format_i32_elem)
+SJSON_ELEMENT_WRITER(write_int32_elements, int32_t, 11, format_i32_elem)
+SJSON_ELEMENT_WRITER(write_int64_elements, int64_t, SJSON_INT_MAX_CHARS, format_i64_elem)
+SJSON_ELEMENT_WRITER(write_uint8_elements, uint8_t, 3, format_u32_elem)
+SJSON_ELEMENT_WRITER(write_uint16_elements, uint16_t, 5, format_u32_elem)
+SJSON_ELEMENT_WRITER(write_uint32_elements, uint32_t, 10, format_u32_elem)
+SJSON_ELEMENT_WRITER(write_uint64_elements, uint64_t, SJSON_INT_MAX_CHARS, format_u64_elem)
+SJSON_ELEMENT_WRITER(write_half_elements, uint16_t, SJSON_FLOAT_MAX_CHARS, format_half_ctx)
+SJSON_ELEMENT_WRITER(write_float_elements, float, SJSON_FLOAT_MAX_CHARS, format_float_ctx)
+SJSON_ELEMENT_WRITER(write_double_elements, double, SJSON_FLOAT_MAX_CHARS, format_double_elem)
+
+/* Element loop for decimals, as above with the scale passed through */
+static sjson_status_t write_decimal_elements(sjson_context_t *ctx, const char *base, size_t stride,
+                                             size_t count, unsigned scale)
+{
+    for (size_t i = 0; i < count; i++, base += stride)
+    {
+        int64_t mantissa;
+        memcpy(&mantissa, base, sizeof(mantissa));
+
+        if (ctx->buffer_size - ctx->used > SJSON_DECIMAL_MAX_CHARS)
+        {
+            char *p = ctx->buffer + ctx->used;
+            if (i > 0)
+            {
+                *p++ = ',';
+            }
+            ctx->used = (size_t)(p - ctx->buffer) + format_scaled_i64(p, mantissa, scale, false);
+            continue;
+        }
+
+        char digits[SJSON_DECIMAL_MAX_CHARS + 1];
+        size_t len = 0;
+        if (i > 0)
+        {
+            digits[len++] = ',';
+        }
+        len += format_scaled_i64(digits + len, mantissa, scale, false);
+        sjson_status_t status = write(ctx, digits, len);
+        if (status != SJSON_OK)
+            return status;
+    }
+    return SJSON_OK;
+}
+
+/* ========================================================================
+ * Public API - Initialization
+ * ======================================================================== */
+
+/* Reset all context state (no output is written) */
+static void reset_context(sjson_context_t *ctx, char *buffer, size_t buffer_size,
+                          sjson_send_callback_t callback, void *user_data)
+{
+    ctx->buffer = buffer;
+    ctx->buffer_size = buffer_size;
+    ctx->used = 0;
+    ctx->user_data = user_data;
+    ctx->send_callback = callback;
+    ctx->sendv_callback = NULL;
+    ctx->stage_fn = NULL;
+    ctx->stage = NULL;
+    ctx->partial_callback = NULL;
+    ctx->token_start = 0;
+    ctx->token_comma = false;
+    ctx->producer = NULL;
+    ctx->producer_state = NULL;
+    ctx->dry_run = false;
+    ctx->bytes_out = 0;
+    ctx->framer = NULL;
+    ctx->depth = 0;
+    ctx->max_depth = SJSON_MAX_DEPTH; // Root plus SJSON_MAX_DEPTH - 1 nested levels
+    ctx->finalized = false;
+    ctx->in_string = false;
+    ctx->float_precision = SJSON_FLOAT_SHORTEST;
+    ctx->float_trim_zeros = false;
+    ctx->ts_second = INT64_MIN;
+
+    // Initialize stacks
+    memset(ctx->depth_stack, 0, sizeof(ctx->depth_stack));
+    memset(ctx->needs_comma, 0, sizeof(ctx->needs_comma));
+}
+
+/* Write the root '{' or '[' and push its closing char */
+static sjson_status_t open_root(sjson_context_t *ctx, char close)
+{
+    sjson_status_t status = write_char(ctx, close == '}' ? '{' : '[');
+    if (status != SJSON_OK)
+        return status;
+
+    ctx->depth_stack[0] = close;
+    ctx->depth = 1;
+    ctx->needs_comma[ctx->depth] = false;
+
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_InitObject(sjson_context_t *ctx, char *buffer, size_t buffer_size,
+                                sjson_send_callback_t callback, void *user_data)
+{
+    if (!ctx || !buffer || buffer_size == 0 || !callback)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    reset_context(ctx, buffer, buffer_size, callback, user_data);
+
+    // Start root object
+    return open_root(ctx, '}');
+}
+
+sjson_status_t sjson_InitArray(sjson_context_t *ctx, char *buffer, size_t buffer_size,
+                               sjson_send_callback_t callback, void *user_data)
+{
+    if (!ctx || !buffer || buffer_size == 0 || !callback)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    reset_context(ctx, buffer, buffer_size, callback, user_data);
+
+    // Start root array
+    return open_root(ctx, ']');
+}
+
+/* Pull mode sink: output stays in the caller's chunk until sjson_Pull() returns */
+static size_t pull_sink(const char *buffer, size_t length, void *user_data)
+{
+    (void)buffer;
+    (void)length;
+    (void)user_data;
+    return 0;
+}
+
+static sjson_status_t init_pull(sjson_context_t *ctx, char close,
+                                sjson_producer_t producer, void *state)
+{
+    if (!ctx || !producer)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    // No buffer until the first sjson_Pull(); the root is opened there
+    reset_context(ctx, NULL, 0, NULL, NULL);
+    ctx->partial_callback = pull_sink;
+    ctx->producer = producer;
+    ctx->producer_state = state;
+    ctx->depth_stack[0] = close;
+
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_InitPullObject(sjson_context_t *ctx, sjson_producer_t producer, void *state)
+{
+    return init_pull(ctx, '}', producer, state);
+}
+
+sjson_status_t sjson_InitPullArray(sjson_context_t *ctx, sjson_producer_t producer, void *state)
+{
+    return init_pull(ctx, ']', producer, state);
+}
+
+sjson_status_t sjson_Pull(sjson_context_t *ctx, char *out, size_t capacity, size_t *length)
+{
+    if (!ctx || !out || capacity == 0 || !length)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    *length = 0;
+    if (!ctx->producer)
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    // Format straight into the caller's memory
+    ctx->buffer = out;
+    ctx->buffer_size = capacity;
+    ctx->used = 0;
+    ctx->token_start = 0;
+
+    sjson_status_t status = SJSON_OK;
+    if (ctx->depth == 0 && !ctx->finalized)
+    {
+        status = open_root(ctx, ctx->depth_stack[0]);
+    }
+
+    // Run producer steps until the chunk is full or the document is done
+    while (status == SJSON_OK && !ctx->finalized)
+    {
+        status = ctx->producer(ctx, ctx->producer_state);
+    }
+
+    *length = ctx->used;
+    ctx->bytes_out += ctx->used;
+    ctx->buffer = NULL;
+    ctx->buffer_size = 0;
+    ctx->used = 0;
+
+    // A step that did not fit is retried on the next pull
+    if (status == SJSON_WOULD_BLOCK && *length > 0)
+    {
+        return SJSON_OK;
+    }
+    return status;
+}
+
+sjson_status_t sjson_Close(sjson_context_t *ctx)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    if (ctx->finalized || ctx->depth == 0 || ctx->in_string)
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    // Pop from stack and write closing char
+    ctx->depth--;
+    begin_token(ctx);
+    sjson_status_t status = write_char(ctx, ctx->depth_stack[ctx->depth]);
+    if (status != SJSON_OK)
+    {
+        ctx->depth++; // Restore depth on failure
+        return status;
+    }
+
+    // If we just closed root collection, finalize
+    if (ctx->depth == 0)
+    {
+        ctx->finalized = true;
+        status = sjson_Flush(ctx);
+        if (status != SJSON_OK)
+        {
+            return status;
+        }
+    }
+    else
+    {
+        // Parent now has an element
+        ctx->needs_comma[ctx->depth] = true;
+    }
+
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_End(sjson_context_t *ctx)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    if (ctx->finalized)
+    {
+        return sjson_Flush(ctx);
+    }
+
+    // Close all open collections using sjson_Close
+    // Last close will auto-flush and finalize when depth hits 0
+    while (ctx->depth > 0)
+    {
+        sjson_status_t status = sjson_Close(ctx);
+        if (status != SJSON_OK)
+        {
+            return status; // sjson_Close already restored state on failure
+        }
+    }
+
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_Flush(sjson_context_t *ctx)
+{
+    return flush_buffer(ctx, true);
+}
+
+sjson_status_t sjson_SetDryRun(sjson_context_t *ctx, bool enable)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    // Only before anything but the opening '{' or '[' has been written
+    if (ctx->stage_fn || ctx->partial_callback || ctx->bytes_out > 0 || ctx->used > 1)
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    ctx->dry_run = enable;
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_SetFramer(sjson_context_t *ctx, const sjson_framer_t *framer)
+{
+    if (!ctx || !framer || !framer->write_header || !framer->write_trailer)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    // Only before the first send, with the plain or vectored callback
+    if (ctx->framer || ctx->stage_fn || ctx->partial_callback || ctx->bytes_out > 0)
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    size_t reserved = framer->headroom + framer->tailroom;
+    if (ctx->buffer_size <= reserved || ctx->buffer_size - reserved < ctx->used)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    // Shift what Init wrote behind the headroom
+    memmove(ctx->buffer + framer->headroom, ctx->buffer, ctx->used);
+    ctx->buffer += framer->headroom;
+    ctx->buffer_size -= reserved;
+    ctx->framer = framer;
+
+    return SJSON_OK;
+}
+
+size_t sjson_GetByteCount(const sjson_context_t *ctx)
+{
+    return ctx ? ctx->bytes_out + ctx->used : 0;
+}
+
+sjson_status_t sjson_SetNonBlockingCallback(sjson_context_t *ctx, sjson_send_partial_callback_t callback)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    if (ctx->stage_fn || ctx->producer || ctx->dry_run || ctx->framer)
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    ctx->partial_callback = callback;
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_SetVectoredCallback(sjson_context_t *ctx, sjson_sendv_callback_t callback)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    ctx->sendv_callback = callback;
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_SetFloatPrecision(sjson_context_t *ctx, int decimals, bool trim_zeros)
+{
+    if (!ctx || decimals < SJSON_FLOAT_SHORTEST || decimals > SJSON_FLOAT_MAX_PRECISION)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    ctx->float_precision = (int8_t)decimals;
+    ctx->float_trim_zeros = trim_zeros;
+    return SJSON_OK;
+}
+
+char *sjson_ReserveSlow(sjson_context_t *ctx, size_t n)
+{
+    if (!ctx || n > ctx->buffer_size)
+    {
+        return NULL;
+    }
+
+    if (reserve(ctx, n) != SJSON_OK)
+    {
+        return NULL;
+    }
+
+    return ctx->buffer + ctx->used;
+}
+
+
+/* ========================================================================
+ * Add to Object
+ * Note: All Add functions check finalized flag to prevent use after close
+ * ======================================================================== */
+
+sjson_status_t sjson_AddStringToObject(sjson_context_t *ctx, const char *key, const char *value)
+{
+    if (!ctx || !key || !value)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    // Write: "key":"value"
+    status = write_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_string(ctx, value);
+}
+
+sjson_status_t sjson_AddIntToObject(sjson_context_t *ctx, const char *key, int64_t value)
+{
+    if (!ctx || !key)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    // Write: "key":value
+    status = write_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_int(ctx, value);
+}
+
+sjson_status_t sjson_AddFloatToObject(sjson_context_t *ctx, const char *key, float value)
+{
+    if (!ctx || !key)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    // Write: "key":value
+    status = write_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_float(ctx, value);
+}
+
+sjson_status_t sjson_AddNumberToObject(sjson_context_t *ctx, const char *key, double value)
+{
+    if (!ctx || !key)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    // Write: "key":value
+    status = write_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_double(ctx, value);
+}
+
+sjson_status_t sjson_AddDecimalToObject(sjson_context_t *ctx, const char *key,
+                                        int64_t mantissa, unsigned scale)
+{
+    if (!ctx || !key || scale > SJSON_DECIMAL_MAX_SCALE)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    // Write: "key":value
+    status = write_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_decimal(ctx, mantissa, scale);
+}
+
+sjson_status_t sjson_AddTimestampToObject(sjson_context_t *ctx, const char *key,
+                                          int64_t epoch_ns, unsigned precision)
+{
+    if (!ctx || !key || precision > SJSON_TIMESTAMP_MAX_PRECISION)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    // Write: "key":"timestamp"
+    status = write_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_timestamp(ctx, epoch_ns, precision);
+}
+
+/*
+ * Typed array writers: sjson_Add<Name>ArrayToObject() for dense arrays and
+ * sjson_Add<Name>ArrayStridedToObject() for every stride bytes of memory
+ */
+#define SJSON_ARRAY_WRITERS(Name, type, elements)                                        \
+    sjson_status_t sjson_Add##Name##ArrayToObject(sjson_context_t *ctx, const char *key, \
+                                                  const type *values, size_t count)      \
+    {                                                                                    \
+        return sjson_Add##Name##ArrayStridedToObject(ctx, key, values, sizeof(type),     \
+                                                     count);                             \
+    }                                                                                    \
+                                                                                         \
+    sjson_status_t sjson_Add##Name##ArrayStridedToObject(sjson_context_t *ctx,           \
+                                                         const char *key,                \
+                                                         const void *base,               \
+                                                         size_t stride, size_t count)    \
+    {                                                                                    \
+        if (!ctx || !key || !base)                                                       \
+        {                                                                                \
+            return SJSON_ERROR_INVALID_PARAM;                                            \
+        }                                                                                \
+                                                                                         \
+        /* Write: "key":[v,v,...] */                                                     \
+        sjson_status_t status = open_array_member(ctx, key);                             \
+        if (status != SJSON_OK)                                                          \
+            return status;                                                               \
+                                                                                         \
+        status = elements(ctx, (const char *)base, stride, count);                       \
+        if (status != SJSON_OK)                                                          \
+            return status;                                                               \
+                                                                                         \
+        return write_char(ctx, ']');                                                     \
+    }
+
+SJSON_ARRAY_WRITERS(Int8, int8_t, write_int8_elements)
+SJSON_ARRAY_WRITERS(Int16, int16_t, write_int16_elements)
+SJSON_ARRAY_WRITERS(Int32, int32_t, write_int32_elements)
+SJSON_ARRAY_WRITERS(Int, int64_t, write_int64_elements)
+SJSON_ARRAY_WRITERS(UInt8, uint8_t, write_uint8_elements)
+SJSON_ARRAY_WRITERS(UInt16, uint16_t, write_uint16_elements)
+SJSON_ARRAY_WRITERS(UInt32, uint32_t, write_uint32_elements)
+SJSON_ARRAY_WRITERS(UInt64, uint64_t, write_uint64_elements)
+SJSON_ARRAY_WRITERS(Half, uint16_t, write_half_elements)
+SJSON_ARRAY_WRITERS(Float, float, write_float_elements)
+SJSON_ARRAY_WRITERS(Double, double, write_double_elements)
+
+sjson_status_t sjson_AddDecimalArrayToObject(sjson_context_t *ctx, const char *key,
+                                             const int64_t *mantissas, size_t count,
+                                             unsigned scale)
+{
+    return sjson_AddDecimalArrayStridedToObject(ctx, key, mantissas, sizeof(int64_t), count, scale);
+}
+
+sjson_status_t sjson_AddDecimalArrayStridedToObject(sjson_context_t *ctx, const char *key,
+                                                    const void *base, size_t stride,
+                                                    size_t count, unsigned scale)
+{
+    if (!ctx || !key || !base || scale > SJSON_DECIMAL_MAX_SCALE)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    // Write: "key":[v,v,...]
+    sjson_status_t status = open_array_member(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_decimal_elements(ctx, (const char *)base, stride, count, scale);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_char(ctx, ']');
+}
+
+sjson_status_t sjson_AddArrayToObject(sjson_context_t *ctx, const char *key)
+{
+    if (!ctx || !key || key[0] == '\0')
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    if (ctx->depth >= ctx->max_depth)
+    {
+        return SJSON_ERROR_MAX_DEPTH;
+    }
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    // Write: "key":[
+    status = write_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_char(ctx, '[');
+    if (status != SJSON_OK)
+        return status;
+
+    // Push array onto stack
+    ctx->depth_stack[ctx->depth] = ']';
+    ctx->depth++;
+    ctx->needs_comma[ctx->depth] = false;
+
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_AddObjectToObject(sjson_context_t *ctx, const char *key)
+{
+    if (!ctx || !key)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    if (ctx->depth >= ctx->max_depth)
+    {
+        return SJSON_ERROR_MAX_DEPTH;
+    }
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    // Write: "key":{
+    status = write_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_char(ctx, '{');
+    if (status != SJSON_OK)
+        return status;
+
+    // Push object onto stack
+    ctx->depth_stack[ctx->depth] = '}';
+    ctx->depth++;
+    ctx->needs_comma[ctx->depth] = false;
+
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_AddRawToObject(sjson_context_t *ctx, const char *key, const char *value)
+{
+    if (!ctx || !key || !value)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    // Write: "key":value (value is raw JSON)
+    status = write_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_str(ctx, value);
+}
+
+sjson_status_t sjson_AddBase64ToObject(sjson_context_t *ctx, const char *key, const void *data, size_t length)
+{
+    if (!ctx || !key || (!data && length > 0))
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    // Write: "key":"base64"
+    status = write_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_base64(ctx, (const unsigned char *)data, length);
+}
+
+sjson_status_t sjson_BeginValueInObject(sjson_context_t *ctx, const char *key)
+{
+    if (!ctx || !key)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_key(ctx, key);
+}
+
+/* ========================================================================
+ * Add to Array
+ * ======================================================================== */
+
+sjson_status_t sjson_AddIntToArray(sjson_context_t *ctx, int64_t value)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    // Check we're in an array (not object)
+    sjson_status_t status = check_array_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_int(ctx, value);
+}
+
+sjson_status_t sjson_AddFloatToArray(sjson_context_t *ctx, float value)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_array_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_float(ctx, value);
+}
+
+sjson_status_t sjson_AddDecimalToArray(sjson_context_t *ctx, int64_t mantissa, unsigned scale)
+{
+    if (!ctx || scale > SJSON_DECIMAL_MAX_SCALE)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_array_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_decimal(ctx, mantissa, scale);
+}
+
+sjson_status_t sjson_AddTimestampToArray(sjson_context_t *ctx, int64_t epoch_ns, unsigned precision)
+{
+    if (!ctx || precision > SJSON_TIMESTAMP_MAX_PRECISION)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_array_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_timestamp(ctx, epoch_ns, precision);
+}
+
+sjson_status_t sjson_AddStringToArray(sjson_context_t *ctx, const char *value)
+{
+    if (!ctx || !value)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_array_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_string(ctx, value);
+}
+
+sjson_status_t sjson_AddBase64ToArray(sjson_context_t *ctx, const void *data, size_t length)
+{
+    if (!ctx || (!data && length > 0))
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_array_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_base64(ctx, (const unsigned char *)data, length);
+}
+
+sjson_status_t sjson_AddObjectToArray(sjson_context_t *ctx)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_array_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    if (ctx->depth >= ctx->max_depth)
+    {
+        return SJSON_ERROR_MAX_DEPTH;
+    }
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_char(ctx, '{');
+    if (status != SJSON_OK)
+        return status;
+
+    ctx->depth_stack[ctx->depth] = '}';
+    ctx->depth++;
+    ctx->needs_comma[ctx->depth] = false;
+
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_AddArrayToArray(sjson_context_t *ctx)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_array_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    if (ctx->depth >= ctx->max_depth)
+    {
+        return SJSON_ERROR_MAX_DEPTH;
+    }
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_char(ctx, '[');
+    if (status != SJSON_OK)
+        return status;
+
+    ctx->depth_stack[ctx->depth] = ']';
+    ctx->depth++;
+    ctx->needs_comma[ctx->depth] = false;
+
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_BeginValueInArray(sjson_context_t *ctx)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_array_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    return add_comma_if_needed(ctx);
+}
+
+/* ========================================================================
+ * Incremental Strings
+ * ======================================================================== */
+
+sjson_status_t sjson_BeginStringInObject(sjson_context_t *ctx, const char *key)
+{
+    if (!ctx || !key)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    // Write: "key":" (value follows via sjson_AppendString)
+    status = write_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_char(ctx, '"');
+    if (status != SJSON_OK)
+        return status;
+
+    ctx->in_string = true;
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_BeginStringInArray(sjson_context_t *ctx)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_array_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_char(ctx, '"');
+    if (status != SJSON_OK)
+        return status;
+
+    ctx->in_string = true;
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_AppendString(sjson_context_t *ctx, const char *str, size_t length)
+{
+    if (!ctx || (!str && length > 0))
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    if (!ctx->in_string)
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    // Each append is its own unit for non-blocking retries
+    begin_token(ctx);
+    return write_escaped(ctx, str, length);
+}
+
+sjson_status_t sjson_EndString(sjson_context_t *ctx)
+{
+    if (!ctx)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    if (!ctx->in_string)
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    begin_token(ctx);
+    sjson_status_t status = write_char(ctx, '"');
+    if (status != SJSON_OK)
+        return status;
+
+    ctx->in_string = false;
+    return SJSON_OK;
+}
+
+/* ========================================================================
+ * Streamed Values
+ * Pieces are read into the free space of the buffer and escaped or encoded
+ * there in place. Expanding transforms work backward so that no input byte
+ * is overwritten before it has been converted.
+ * ======================================================================== */
+
+/* Bytes a framer trailer may overwrite behind the data when flushing */
+static size_t stream_gap(const sjson_context_t *ctx)
+{
+    return ctx->framer ? ctx->framer->tailroom : 0;
+}
+
+/* Free space wanted before the next read: a quarter buffer, at least the minimum */
+static size_t stream_min_free(const sjson_context_t *ctx)
+{
+    size_t want = ctx->buffer_size / 4;
+    size_t floor = stream_gap(ctx) + SJSON_STREAM_MIN_SPACE;
+    return (want > floor) ? want : floor;
+}
+
+static sjson_status_t check_stream(const sjson_context_t *ctx, sjson_encoding_t encoding)
+{
+    if (encoding != SJSON_ENCODING_STRING && encoding != SJSON_ENCODING_BASE64 &&
+        encoding != SJSON_ENCODING_RAW)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    // A read cannot be undone, so there is no non-blocking retry
+    if (ctx->partial_callback)
+    {
+        return SJSON_ERROR_INVALID_STATE;
+    }
+
+    if (ctx->buffer_size < stream_gap(ctx) + SJSON_STREAM_MIN_SPACE)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    return SJSON_OK;
+}
+
+static sjson_status_t read_piece(sjson_read_callback_t reader, void *state,
+                                 char *out, size_t capacity, size_t *length)
+{
+    size_t n = reader(out, capacity, state);
+    if (n > capacity)
+    {
+        return SJSON_ERROR_BUFFER_FULL; // SJSON_READ_FAILED or bogus count
+    }
+    *length = n;
+    return SJSON_OK;
+}
+
+static sjson_status_t stream_raw(sjson_context_t *ctx, sjson_read_callback_t reader, void *state)
+{
+    for (;;)
+    {
+        sjson_status_t status = reserve(ctx, stream_min_free(ctx));
+        if (status != SJSON_OK)
+            return status;
+
+        size_t n;
+        status = read_piece(reader, state, ctx->buffer + ctx->used, ctx->buffer_size - ctx->used, &n);
+        if (status != SJSON_OK || n == 0)
+            return status;
+
+        ctx->used += n;
+    }
+}
+
+/* Encode the groups * 3 bytes at p into groups * 4 chars at p */
+static void base64_encode_in_place(char *p, size_t groups)
+{
+    char block[64 * 4];
+
+    // Last block first: its output lies behind all input still to be read
+    while (groups > 0)
+    {
+        size_t n = (groups % 64 != 0) ? groups % 64 : 64;
+        groups -= n;
+        base64_encode_groups(block, (const unsigned char *)p + groups * 3, n);
+        memcpy(p + groups * 4, block, n * 4);
+    }
+}
+
+static sjson_status_t stream_base64(sjson_context_t *ctx, sjson_read_callback_t reader, void *state)
+{
+    unsigned char carry[2];
+    size_t carry_len = 0;
+
+    for (;;)
+    {
+        sjson_status_t status = reserve(ctx, stream_min_free(ctx));
+        if (status != SJSON_OK)
+            return status;
+
+        // Read behind the 1-2 bytes left over from the previous piece
+        char *p = ctx->buffer + ctx->used;
+        size_t capacity = (ctx->buffer_size - ctx->used) / 4 * 3;
+        memcpy(p, carry, carry_len);
+
+        size_t n;
+        status = read_piece(reader, state, p + carry_len, capacity - carry_len, &n);
+        if (status != SJSON_OK)
+            return status;
+        if (n == 0)
+            break;
+
+        size_t total = carry_len + n;
+        size_t groups = total / 3;
+        carry_len = total % 3;
+        memcpy(carry, p + groups * 3, carry_len);
+
+        base64_encode_in_place(p, groups);
+        ctx->used += groups * 4;
+    }
+
+    if (carry_len > 0)
+    {
+        sjson_status_t status = reserve(ctx, 4);
+        if (status != SJSON_OK)
+            return status;
+
+        base64_encode_tail(ctx->buffer + ctx->used, carry, carry_len);
+        ctx->used += 4;
+    }
+
+    return SJSON_OK;
+}
+
+/*
+ * Length of the leading part of p[0..n) whose escaping adds at most budget
+ * bytes; *extra receives the bytes it adds
+ */
+static size_t escape_fit(const char *p, size_t n, size_t budget, size_t *extra)
+{
+    size_t i = 0;
+    size_t added = 0;
+
+    for (;;)
+    {
+        i += scan_clean(p + i, n - i);
+        if (i == n)
+        {
+            break;
+        }
+
+        char seq[6];
+        size_t grow = escape_byte((unsigned char)p[i], seq) - 1;
+        if (added + grow > budget)
+        {
+            break;
+        }
+        added += grow;
+        i++;
+    }
+
+    *extra = added;
+    return i;
+}
+
+/* Escape p[0..n) in place, growing it by extra bytes */
+static void escape_in_place(char *p, size_t n, size_t extra)
+{
+    char *out = p + n + extra;
+    size_t i = n;
+
+    // Stop once the output meets the input: the rest needs no escaping
+    while (out != p + i)
+    {
+        unsigned char c = (unsigned char)p[--i];
+        if (needs_escape(c))
+        {
+            char seq[6];
+            size_t len = escape_byte(c, seq);
+            out -= len;
+            memcpy(out, seq, len);
+        }
+        else
+        {
+            *--out = (char)c;
+        }
+    }
+}
+
+static sjson_status_t stream_escaped(sjson_context_t *ctx, sjson_read_callback_t reader, void *state)
+{
+    size_t gap = stream_gap(ctx);
+    size_t pending = 0; // Unescaped input at ctx->buffer + ctx->used
+
+    for (;;)
+    {
+        sjson_status_t status;
+
+        if (pending == 0)
+        {
+            status = reserve(ctx, stream_min_free(ctx));
+            if (status != SJSON_OK)
+                return status;
+
+            // Read half the free space, leaving the rest for escapes
+            status = read_piece(reader, state, ctx->buffer + ctx->used,
+                                (ctx->buffer_size - ctx->used - gap) / 2, &pending);
+            if (status != SJSON_OK)
+                return status;
+            if (pending == 0)
+                return SJSON_OK;
+        }
+
+        char *p = ctx->buffer + ctx->used;
+        size_t budget = ctx->buffer_size - ctx->used - gap - pending;
+        size_t extra;
+        size_t fit = escape_fit(p, pending, budget, &extra);
+        size_t rest = pending - fit;
+
+        if (rest == 0)
+        {
+            escape_in_place(p, fit, extra);
+            ctx->used += fit + extra;
+            pending = 0;
+            continue;
+        }
+
+        // Escape-heavy piece: park what does not fit at the end of the
+        // buffer, clear of the escaped part and a framer trailer, flush,
+        // then continue with the parked bytes
+        size_t parked = ctx->buffer_size - rest;
+        memmove(ctx->buffer + parked, p + fit, rest);
+        escape_in_place(p, fit, extra);
+        ctx->used += fit + extra;
+
+        const char *old = ctx->buffer;
+        status = flush_buffer(ctx, false);
+        if (status != SJSON_OK)
+            return status;
+
+        // Stages may have switched to another buffer
+        memmove(ctx->buffer + ctx->used, old + parked, rest);
+        pending = rest;
+    }
+}
+
+static sjson_status_t write_stream(sjson_context_t *ctx, sjson_read_callback_t reader, void *state,
+                                   sjson_encoding_t encoding)
+{
+    if (encoding == SJSON_ENCODING_RAW)
+    {
+        return stream_raw(ctx, reader, state);
+    }
+
+    sjson_status_t status = write_char(ctx, '"');
+    if (status != SJSON_OK)
+        return status;
+
+    status = (encoding == SJSON_ENCODING_BASE64)
+        ? stream_base64(ctx, reader, state)
+        : stream_escaped(ctx, reader, state);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_char(ctx, '"');
+}
+
+sjson_status_t sjson_AddStreamToObject(sjson_context_t *ctx, const char *key,
+                                       sjson_read_callback_t reader, void *state,
+                                       sjson_encoding_t encoding)
+{
+    if (!ctx || !key || !reader)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = check_stream(ctx, encoding);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_stream(ctx, reader, state, encoding);
+}
+
+sjson_status_t sjson_AddStreamToArray(sjson_context_t *ctx, sjson_read_callback_t reader, void *state,
+                                      sjson_encoding_t encoding)
+{
+    if (!ctx || !reader)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_array_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = check_stream(ctx, encoding);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_stream(ctx, reader, state, encoding);
+}
+
+/* ========================================================================
+ * Pre-encoded Keys
+ * ,"key": is escaped once by sjson_KeyInit(); the writers below copy it with
+ * the comma (or from the quote when no comma is needed) in one go.
+ * ======================================================================== */
+
+/* Write ,"key": from a pre-encoded key (replaces add_comma_if_needed + write_key) */
+static sjson_status_t write_key_handle(sjson_context_t *ctx, const sjson_key_t *key)
+{
+    size_t skip = ctx->needs_comma[ctx->depth] ? 0 : 1;
+    size_t len = key->length - skip;
+    ctx->needs_comma[ctx->depth] = true;
+
+    if (ctx->buffer_size - ctx->used >= len && !ctx->dry_run)
+    {
+        memcpy(ctx->buffer + ctx->used, key->text + skip, len);
+        ctx->used += len;
+        return SJSON_OK;
+    }
+
+    return write(ctx, key->text + skip, len);
+}
+
+/* Write: ,"key":[ in the current object */
+static sjson_status_t open_array_member_by_key(sjson_context_t *ctx, const sjson_key_t *key)
+{
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_key_handle(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_char(ctx, '[');
+}
+
+/* Write: ,"key":{ or ,"key":[ and push the collection */
+static sjson_status_t open_collection_by_key(sjson_context_t *ctx, const sjson_key_t *key, char close)
+{
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    if (ctx->depth >= ctx->max_depth)
+    {
+        return SJSON_ERROR_MAX_DEPTH;
+    }
+
+    status = write_key_handle(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_char(ctx, close == '}' ? '{' : '[');
+    if (status != SJSON_OK)
+        return status;
+
+    ctx->depth_stack[ctx->depth] = close;
+    ctx->depth++;
+    ctx->needs_comma[ctx->depth] = false;
+
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_KeyInit(sjson_key_t *key, const char *name)
+{
+    if (!key || !name || name[0] == '\0')
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    char *p = key->text;
+    char *end = key->text + sizeof(key->text);
+    *p++ = ',';
+    *p++ = '"';
+
+    for (; *name != '\0'; name++)
+    {
+        unsigned char c = (unsigned char)*name;
+        char seq[6];
+        size_t n = 1;
+        seq[0] = (char)c;
+        if (needs_escape(c))
+        {
+            n = escape_byte(c, seq);
+        }
+
+        // Leave room for the closing ":
+        if (n + 2 > (size_t)(end - p))
+        {
+            return SJSON_ERROR_INVALID_PARAM;
+        }
+        memcpy(p, seq, n);
+        p += n;
+    }
+
+    *p++ = '"';
+    *p++ = ':';
+    key->length = (size_t)(p - key->text);
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_AddStringToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key, const char *value)
+{
+    if (!ctx || !key || !value)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_key_handle(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_string(ctx, value);
+}
+
+sjson_status_t sjson_AddIntToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key, int64_t value)
+{
+    if (!ctx || !key)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_key_handle(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_int(ctx, value);
+}
+
+sjson_status_t sjson_AddFloatToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key, float value)
+{
+    if (!ctx || !key)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_key_handle(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_float(ctx, value);
+}
+
+sjson_status_t sjson_AddNumberToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key, double value)
+{
+    if (!ctx || !key)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_key_handle(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_double(ctx, value);
+}
+
+sjson_status_t sjson_AddDecimalToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                             int64_t mantissa, unsigned scale)
+{
+    if (!ctx || !key || scale > SJSON_DECIMAL_MAX_SCALE)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_key_handle(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_decimal(ctx, mantissa, scale);
+}
+
+sjson_status_t sjson_AddTimestampToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                               int64_t epoch_ns, unsigned precision)
+{
+    if (!ctx || !key || precision > SJSON_TIMESTAMP_MAX_PRECISION)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_key_handle(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_timestamp(ctx, epoch_ns, precision);
+}
+
+sjson_status_t sjson_AddArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key)
+{
+    // Same as sjson_AddArrayToObject(): no empty key (,"":)
+    if (!ctx || !key || key->length <= 4)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    return open_collection_by_key(ctx, key, ']');
+}
+
+sjson_status_t sjson_AddObjectToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key)
+{
+    if (!ctx || !key)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    return open_collection_by_key(ctx, key, '}');
+}
+
+sjson_status_t sjson_AddRawToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key, const char *value)
+{
+    if (!ctx || !key || !value)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_key_handle(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_str(ctx, value);
+}
+
+sjson_status_t sjson_AddBase64ToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                            const void *data, size_t length)
+{
+    if (!ctx || !key || (!data && length > 0))
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_key_handle(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_base64(ctx, (const unsigned char *)data, length);
+}
+
+sjson_status_t sjson_BeginValueInObjectByKey(sjson_context_t *ctx, const sjson_key_t *key)
+{
+    if (!ctx || !key)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_key_handle(ctx, key);
+}
+
+sjson_status_t sjson_BeginStringInObjectByKey(sjson_context_t *ctx, const sjson_key_t *key)
+{
+    if (!ctx || !key)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_key_handle(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_char(ctx, '"');
+    if (status != SJSON_OK)
+        return status;
+
+    ctx->in_string = true;
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_AddStreamToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                            sjson_read_callback_t reader, void *state,
+                                            sjson_encoding_t encoding)
+{
+    if (!ctx || !key || !reader)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = check_object_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = check_stream(ctx, encoding);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_key_handle(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_stream(ctx, reader, state, encoding);
+}
+
+/* Typed array writers with a pre-encoded key, see SJSON_ARRAY_WRITERS */
+#define SJSON_ARRAY_WRITERS_BY_KEY(Name, type, elements)                                   \
+    sjson_status_t sjson_Add##Name##ArrayToObjectByKey(sjson_context_t *ctx,               \
+                                                       const sjson_key_t *key,             \
+                                                       const type *values, size_t count)   \
+    {                                                                                      \
+        return sjson_Add##Name##ArrayStridedToObjectByKey(ctx, key, values, sizeof(type),  \
+                                                          count);                          \
+    }                                                                                      \
+                                                                                           \
+    sjson_status_t sjson_Add##Name##ArrayStridedToObjectByKey(sjson_context_t *ctx,        \
+                                                              const sjson_key_t *key,      \
+                                                              const void *base,            \
+                                                              size_t stride, size_t count) \
+    {                                                                                      \
+        if (!ctx || !key || !base)                                                         \
+        {                                                                                  \
+            return SJSON_ERROR_INVALID_PARAM;                                              \
+        }                                                                                  \
+                                                                                           \
+        sjson_status_t status = open_array_member_by_key(ctx, key);                        \
+        if (status != SJSON_OK)                                                            \
+            return status;                                                                 \
+                                                                                           \
+        status = elements(ctx, (const char *)base, stride, count);                         \
+        if (status != SJSON_OK)                                                            \
+            return status;                                                                 \
+                                                                                           \
+        return write_char(ctx, ']');                                                       \
+    }
+
+SJSON_ARRAY_WRITERS_BY_KEY(Int8, int8_t, write_int8_elements)
+SJSON_ARRAY_WRITERS_BY_KEY(Int16, int16_t, write_int16_elements)
+SJSON_ARRAY_WRITERS_BY_KEY(Int32, int32_t, write_int32_elements)
+SJSON_ARRAY_WRITERS_BY_KEY(Int, int64_t, write_int64_elements)
+SJSON_ARRAY_WRITERS_BY_KEY(UInt8, uint8_t, write_uint8_elements)
+SJSON_ARRAY_WRITERS_BY_KEY(UInt16, uint16_t, write_uint16_elements)
+SJSON_ARRAY_WRITERS_BY_KEY(UInt32, uint32_t, write_uint32_elements)
+SJSON_ARRAY_WRITERS_BY_KEY(UInt64, uint64_t, write_uint64_elements)
+SJSON_ARRAY_WRITERS_BY_KEY(Half, uint16_t, write_half_elements)
+SJSON_ARRAY_WRITERS_BY_KEY(Float, float, write_float_elements)
+SJSON_ARRAY_WRITERS_BY_KEY(Double, double, write_double_elements)
+
+sjson_status_t sjson_AddDecimalArrayToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                  const int64_t *mantissas, size_t count,
+                                                  unsigned scale)
+{
+    return sjson_AddDecimalArrayStridedToObjectByKey(ctx, key, mantissas, sizeof(int64_t), count, scale);
+}
+
+sjson_status_t sjson_AddDecimalArrayStridedToObjectByKey(sjson_context_t *ctx, const sjson_key_t *key,
+                                                         const void *base, size_t stride,
+                                                         size_t count, unsigned scale)
+{
+    if (!ctx || !key || !base || scale > SJSON_DECIMAL_MAX_SCALE)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    sjson_status_t status = open_array_member_by_key(ctx, key);
+    if (status != SJSON_OK)
+        return status;
+
+    status = write_decimal_elements(ctx, (const char *)base, stride, count, scale);
+    if (status != SJSON_OK)
+        return status;
+
+    return write_char(ctx, ']');
+}
+
+/* ========================================================================
+ * Templates
+ * The skeleton is split once into static runs, each followed by a typed
+ * placeholder; emitting copies the runs and formats only the values.
+ * ======================================================================== */
+
+/* Parse the digits of %dN / %tN (at most two), advancing *p */
+static bool parse_hole_param(const char **p, unsigned max, uint8_t *param)
+{
+    unsigned value = 0;
+    const char *q = *p;
+    while (*q >= '0' && *q <= '9' && q - *p < 2)
+    {
+        value = value * 10U + (unsigned)(*q - '0');
+        q++;
+    }
+
+    if (q == *p || value > max)
+    {
+        return false;
+    }
+    *param = (uint8_t)value;
+    *p = q;
+    return true;
+}
+
+sjson_status_t sjson_TemplateCompile(sjson_template_t *tmpl, const char *skeleton,
+                                     sjson_template_op_t *ops, size_t max_ops)
+{
+    if (!tmpl || !skeleton || !ops || max_ops == 0)
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    size_t count = 0;
+    size_t holes = 0;
+    const char *run = skeleton;
+    const char *p = skeleton;
+
+    for (;;)
+    {
+        while (*p != '\0' && *p != '%')
+        {
+            p++;
+        }
+
+        // Last run: the end of the skeleton
+        if (*p == '\0')
+        {
+            if (count == max_ops)
+            {
+                return SJSON_ERROR_INVALID_PARAM;
+            }
+            ops[count].run = run;
+            ops[count].length = (size_t)(p - run);
+            ops[count].hole = SJSON_HOLE_NONE;
+            ops[count].param = 0;
+            count++;
+            break;
+        }
+
+        const char *next = p + 2;
+        size_t length = (size_t)(p - run);
+        uint8_t hole;
+        uint8_t param = 0;
+        switch (p[1])
+        {
+        case '%': hole = SJSON_HOLE_NONE; length++; break;  // Keep one '%' in the run
+        case 'i': hole = SJSON_HOLE_INT; break;
+        case 'u': hole = SJSON_HOLE_UINT; break;
+        case 'f': hole = SJSON_HOLE_FLOAT; break;
+        case 'g': hole = SJSON_HOLE_NUMBER; break;
+        case 's': hole = SJSON_HOLE_STRING; break;
+        case 'r': hole = SJSON_HOLE_RAW; break;
+        case 'b': hole = SJSON_HOLE_BOOL; break;
+        case 'd':
+            hole = SJSON_HOLE_DECIMAL;
+            if (!parse_hole_param(&next, SJSON_DECIMAL_MAX_SCALE, &param))
+                return SJSON_ERROR_INVALID_PARAM;
+            break;
+        case 't':
+            hole = SJSON_HOLE_TIMESTAMP;
+            if (!parse_hole_param(&next, SJSON_TIMESTAMP_MAX_PRECISION, &param))
+                return SJSON_ERROR_INVALID_PARAM;
+            break;
+        default:
+            return SJSON_ERROR_INVALID_PARAM;
+        }
+
+        if (count == max_ops)
+        {
+            return SJSON_ERROR_INVALID_PARAM;
+        }
+        ops[count].run = run;
+        ops[count].length = length;
+        ops[count].hole = hole;
+        ops[count].param = param;
+        count++;
+        holes += (hole != SJSON_HOLE_NONE);
+
+        run = p = next;
+    }
+
+    tmpl->ops = ops;
+    tmpl->op_count = count;
+    tmpl->hole_count = holes;
+    return SJSON_OK;
+}
+
+sjson_status_t sjson_EmitTemplate(sjson_context_t *ctx, const sjson_template_t *tmpl,
+                                  const sjson_value_t *values)
+{
+    if (!ctx || !tmpl || !tmpl->ops || (!values && tmpl->hole_count > 0))
+    {
+        return SJSON_ERROR_INVALID_PARAM;
+    }
+
+    // One state check and comma for the whole template
+    bool in_object = ctx->depth > 0 && ctx->depth_stack[ctx->depth - 1] == '}';
+    sjson_status_t status = in_object ? check_object_state(ctx) : check_array_state(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    status = add_comma_if_needed(ctx);
+    if (status != SJSON_OK)
+        return status;
+
+    const sjson_template_op_t *op = tmpl->ops;
+    const sjson_template_op_t *end = op + tmpl->op_count;
+    for (; op < end; op++)
+    {
+        if (ctx->buffer_size - ctx->used >= op->length && !ctx->dry_run)
+        {
+            memcpy(ctx->buffer + ctx->used, op->run, op->length);
+            ctx->used += op->length;
+        }
+        else
+        {
+            status = write(ctx, op->run, op->length);
+            if (status != SJSON_OK)
+                return status;
+        }
+
+        switch (op->hole)
+        {
+        case SJSON_HOLE_NONE:      continue;
+        case SJSON_HOLE_INT:       status = write_int(ctx, values->i); break;
+        case SJSON_HOLE_UINT:      status = write_uint(ctx, values->u); break;
+        case SJSON_HOLE_FLOAT:     status = write_float(ctx, values->f); break;
+        case SJSON_HOLE_NUMBER:    status = write_double(ctx, values->d); break;
+        case SJSON_HOLE_DECIMAL:   status = write_decimal(ctx, values->i, op->param); break;
+        case SJSON_HOLE_TIMESTAMP: status = write_timestamp(ctx, values->i, op->param); break;
+        case SJSON_HOLE_STRING:    status = values->s ? write_string(ctx, values->s) : write(ctx, "null", 4); break;
+        case SJSON_HOLE_RAW:       status = values->s ? write_str(ctx, values->s) : write(ctx, "null", 4); break;
+        case SJSON_HOLE_BOOL:      status = values->b ? write(ctx, "true", 4) : write(ctx, "false", 5); break;
+        default:                   return SJSON_ERROR_INVALID_PARAM;
+        }
+        if (status != SJSON_OK)
+            return status;
+        values++;
+    }
+
+    return SJSON_OK;
+}
+
+/* ========================================================================
+ * Built-in Framers
+ * ======================================================================== */
+
+/* HTTP/1.1 chunked transfer encoding: <hex length>\r\n<data>\r\n ... 0\r\n\r\n */
+static size_t chunked_header(char *end, size_t length, bool first, bool final)
+{
+    (void)first;
+    (void)final;
+
+    char *p = end;
+    *--p = '\n';
+    *--p = '\r';
+    do
+    {
+        *--p = "0123456789ABCDEF"[length & 0x0F];
+        length >>= 4;
+    } while (length > 0);
+
+    return (size_t)(end - p);
+}
+
+static size_t chunked_trailer(char *start, size_t length, bool first, bool final)
+{
+    (void)length;
+    (void)first;
+
+    if (final)
+    {
+        // Close this chunk and terminate the body with the zero-length chunk
+        memcpy(start, "\r\n0\r\n\r\n", 7);
+        return 7;
+    }
+    memcpy(start, "\r\n", 2);
+    return 2;
+}
+
+const sjson_framer_t sjson_framer_chunked = {
+    2 * sizeof(size_t) + 2, 7, chunked_header, chunked_trailer
+};
+
+/* WebSocket (RFC 6455) text message, server to client (unmasked), one frame per flush */
+static size_t websocket_header(char *end, size_t length, bool first, bool final)
+{
+    char *p = end;
+    uint64_t len = (uint64_t)length;
+
+    if (len < 126U)
+    {
+        *--p = (char)len;
+    }
+    else if (len <= 0xFFFFU)
+    {
+        *--p = (char)(len & 0xFF);
+        *--p = (char)(len >> 8);
+        *--p = (char)126;
+    }
+    else
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            *--p = (char)(len & 0xFF);
+            len >>= 8;
+        }
+        *--p = (char)127;
+    }
+
+    // FIN on the last frame; text opcode first, continuation afterwards
+    *--p = (char)((final ? 0x80 : 0x00) | (first ? 0x01 : 0x00));
+    return (size_t)(end - p);
+}
+
+static size_t no_trailer(char *start, size_t length, bool first, bool final)
+{
+    (void)start;
+    (void)length;
+    (void)first;
+    (void)final;
+    return 0;
+}
+
+const sjson_framer_t sjson_framer_websocket = {
+    10, 0, websocket_header, no_trailer
+};
+
+/* 4-byte big-endian length before every chunk */
+static size_t length_prefix_header(char *end, size_t length, bool first, bool final)
+{
+    (void)first;
+    (void)final;
+
+    uint32_t len = (uint32_t)length;
+    end[-4] = (char)(len >> 24);
+    end[-3] = (char)(len >> 16);
+    end[-2] = (char)(len >> 8);
+    end[-1] = (char)len;
+    return 4;
+}
+
+const sjson_framer_t sjson_framer_length_prefix = {
+    4, 0, length_prefix_header, no_trailer
+};
@@ -0,0 +1,503 @@
+/**
+ * @file test_arrays.c
+ * @brief Dense, strided and pre-encoded-key array writers
+ *
+ * Built once per SIMD path. Values of every element type are scattered
+ * at random, unaligned strides and must give the same text as the dense
+ * writer and as the reference (snprintf for integers, the single value
+ * writers for float and double), with buffer sizes that leave little room
+ * at the end. Every finite half must round-trip with the shortest digits.
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include "test_util.h"
+
+#define COUNT 48
+#define MAX_STRIDE 24
+
+static char expected[1 << 14];
+static char scattered[1 + COUNT * MAX_STRIDE + 8];
+static sjson_key_t key_b;
+
+/* Place count values of size bytes at 1 + offset + i * stride */
+static const void *scatter(const void *values, size_t size, size_t count, size_t stride)
+{
+    size_t offset = 1 + (size_t)(test_rand() % 7);
+    for (size_t i = 0; i < count; i++)
+        memcpy(scattered + offset + i * stride, (const char *)values + i * size, size);
+    return scattered + offset;
+}
+
+/* Text of one float as the single value writer formats it */
+static size_t float_text(char *out, float value, int precision, bool trim)
+{
+    char buffer[64];
+    test_sink_t sink = { out, 0, 64, 0 };
+    sjson_context_t ctx;
+
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    sjson_SetFloatPrecision(&ctx, precision, trim);
+    sjson_AddFloatToArray(&ctx, value);
+    sjson_End(&ctx);
+
+    // Strip the brackets
+    memmove(out, out + 1, sink.length - 2);
+    return sink.length - 2;
+}
+
+/* Text of one double as sjson_AddNumberToObject() formats it */
+static size_t double_text(char *out, double value)
+{
+    char buffer[64];
+    test_sink_t sink = { out, 0, 64, 0 };
+    sjson_context_t ctx;
+
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    sjson_AddObjectToArray(&ctx);
+    sjson_AddNumberToObject(&ctx, "x", value);
+    sjson_End(&ctx);
+
+    // Strip [{"x": and }]
+    memmove(out, out + 6, sink.length - 8);
+    return sink.length - 8;
+}
+
+/* Writes {"a":[dense],"b":[strided, by key],"c":[strided]} for one type */
+typedef sjson_status_t (*write_arrays_fn)(sjson_context_t *ctx, const void *values, const void *base,
+                                          size_t stride, size_t count);
+
+/* Runs write_arrays at a random stride and buffer size and compares with expected */
+static void check_arrays(const char *type, write_arrays_fn write_arrays, const void *values, size_t size,
+                         size_t count, size_t n, int precision, bool trim)
+{
+    size_t stride = size + (size_t)(test_rand() % (MAX_STRIDE - size + 1));
+    const void *base = scatter(values, size, count, stride);
+    size_t buffer_size = 16 + (size_t)(test_rand() % 300);
+    char *buffer = malloc(buffer_size);
+    test_sink_t sink;
+    sjson_context_t ctx;
+
+    test_sink_init(&sink, sizeof(expected));
+    sjson_InitObject(&ctx, buffer, buffer_size, test_capture, &sink);
+    sjson_SetFloatPrecision(&ctx, precision, trim);
+    CHECK(write_arrays(&ctx, values, base, stride, count) == SJSON_OK, "%s arrays", type);
+    CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+
+    CHECK(test_sink_equals(&sink, expected, n),
+          "%s stride=%zu buffer_size=%zu:\n  got      %.*s\n  expected %.*s", type, stride, buffer_size,
+          (int)sink.length, sink.data, (int)n, expected);
+
+    test_sink_free(&sink);
+    free(buffer);
+}
+
+/* The same element text three times, as {"a":[..],"b":[..],"c":[..]} */
+static size_t expect_three(const char *elements, size_t length)
+{
+    size_t n = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        n += (size_t)sprintf(expected + n, "%s\"%c\":[", i ? "," : "{", 'a' + i);
+        memcpy(expected + n, elements, length);
+        n += length;
+        expected[n++] = ']';
+    }
+    expected[n++] = '}';
+    return n;
+}
+
+/* ========================================================================
+ * int64 and float
+ * ======================================================================== */
+
+static sjson_status_t write_int(sjson_context_t *ctx, const void *values, const void *base, size_t stride,
+                                size_t count)
+{
+    sjson_AddIntArrayToObject(ctx, "a", (const int64_t *)values, count);
+    sjson_AddIntArrayStridedToObjectByKey(ctx, &key_b, base, stride, count);
+    return sjson_AddIntArrayStridedToObject(ctx, "c", base, stride, count);
+}
+
+static sjson_status_t write_float(sjson_context_t *ctx, const void *values, const void *base, size_t stride,
+                                  size_t count)
+{
+    sjson_AddFloatArrayToObject(ctx, "a", (const float *)values, count);
+    sjson_AddFloatArrayStridedToObjectByKey(ctx, &key_b, base, stride, count);
+    return sjson_AddFloatArrayStridedToObject(ctx, "c", base, stride, count);
+}
+
+static void test_int64(void)
+{
+    static char elements[COUNT * 24];
+    int64_t values[COUNT];
+
+    for (int iter = 0; iter < 3000; iter++)
+    {
+        size_t count = (size_t)(test_rand() % (COUNT + 1));
+        size_t length = 0;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            uint64_t bits = test_rand() >> (test_rand() % 64);
+            values[i] = (int64_t)((test_rand() & 1) ? bits : 0 - bits);
+            if (test_rand() % 16 == 0)
+                values[i] = (test_rand() & 1) ? INT64_MIN : INT64_MAX;
+            length += (size_t)sprintf(elements + length, "%s%" PRId64, i ? "," : "", values[i]);
+        }
+
+        check_arrays("int64", write_int, values, sizeof(int64_t), count, expect_three(elements, length),
+                     SJSON_FLOAT_SHORTEST, false);
+    }
+}
+
+static void test_float(void)
+{
+    static char elements[COUNT * 40];
+    float values[COUNT];
+
+    for (int iter = 0; iter < 3000; iter++)
+    {
+        size_t count = (size_t)(test_rand() % (COUNT + 1));
+        int precision = (int)(test_rand() % (SJSON_FLOAT_MAX_PRECISION + 2)) - 1;
+        bool trim = (test_rand() & 1) != 0;
+        size_t length = 0;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t bits = (uint32_t)test_rand();
+            memcpy(&values[i], &bits, sizeof(float));
+            if (test_rand() % 2)
+                values[i] = (float)((int64_t)(test_rand() % 2000001) - 1000000) / 128.0f;
+            if (i)
+                elements[length++] = ',';
+            length += float_text(elements + length, values[i], precision, trim);
+        }
+
+        check_arrays("float", write_float, values, sizeof(float), count, expect_three(elements, length),
+                     precision, trim);
+    }
+}
+
+/* ========================================================================
+ * Narrow and unsigned integers, every type's minimum and maximum
+ * ======================================================================== */
+
+#define INT_ARRAY_TEST(Name, type, print, min, max)                                          \
+    static sjson_status_t write_##Name(sjson_context_t *ctx, const void *values,             \
+                                       const void *base, size_t stride, size_t count)        \
+    {                                                                                        \
+        sjson_Add##Name##ArrayToObject(ctx, "a", (const type *)values, count);               \
+        sjson_Add##Name##ArrayStridedToObjectByKey(ctx, &key_b, base, stride, count);        \
+        return sjson_Add##Name##ArrayStridedToObject(ctx, "c", base, stride, count);         \
+    }                                                                                        \
+                                                                                             \
+    static void test_##Name(void)                                                            \
+    {                                                                                        \
+        static char elements[COUNT * 24];                                                    \
+        type values[COUNT];                                                                  \
+                                                                                             \
+        for (int iter = 0; iter < 1000; iter++)                                              \
+        {                                                                                    \
+            size_t count = (size_t)(test_rand() % (COUNT + 1));                              \
+            size_t length = 0;                                                               \
+                                                                                             \
+            for (size_t i = 0; i < count; i++)                                               \
+            {                                                                                \
+                uint64_t bits = test_rand() >> (test_rand() % 64);                           \
+                memcpy(&values[i], &bits, sizeof(type));                                     \
+                if (test_rand() % 8 == 0)                                                    \
+                    values[i] = (test_rand() & 1) ? (type)(min) : (type)(max);               \
+                length += (size_t)sprintf(elements + length, "%s%" print, i ? "," : "",      \
+                                          values[i]);                                        \
+            }                                                                                \
+                                                                                             \
+            check_arrays(#Name, write_##Name, values, sizeof(type), count,                   \
+                         expect_three(elements, length), SJSON_FLOAT_SHORTEST, false);       \
+        }                                                                                    \
+    }
+
+INT_ARRAY_TEST(Int8, int8_t, PRId8, INT8_MIN, INT8_MAX)
+INT_ARRAY_TEST(Int16, int16_t, PRId16, INT16_MIN, INT16_MAX)
+INT_ARRAY_TEST(Int32, int32_t, PRId32, INT32_MIN, INT32_MAX)
+INT_ARRAY_TEST(UInt8, uint8_t, PRIu8, 0, UINT8_MAX)
+INT_ARRAY_TEST(UInt16, uint16_t, PRIu16, 0, UINT16_MAX)
+INT_ARRAY_TEST(UInt32, uint32_t, PRIu32, 0, UINT32_MAX)
+INT_ARRAY_TEST(UInt64, uint64_t, PRIu64, 0, UINT64_MAX)
+
+/* ========================================================================
+ * double
+ * ======================================================================== */
+
+static sjson_status_t write_double(sjson_context_t *ctx, const void *values, const void *base, size_t stride,
+                                   size_t count)
+{
+    sjson_AddDoubleArrayToObject(ctx, "a", (const double *)values, count);
+    sjson_AddDoubleArrayStridedToObjectByKey(ctx, &key_b, base, stride, count);
+    return sjson_AddDoubleArrayStridedToObject(ctx, "c", base, stride, count);
+}
+
+static void test_double(void)
+{
+    static const double specials[] = { 0.0, -0.0, 5e-324, 2.2250738585072014e-308, 1.7976931348623157e308,
+                                       0.1, 1e21, 123456789012345680.0, INFINITY, -INFINITY, NAN };
+    static char elements[COUNT * 40];
+    double values[COUNT];
+
+    for (int iter = 0; iter < 2000; iter++)
+    {
+        size_t count = (size_t)(test_rand() % (COUNT + 1));
+        size_t length = 0;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            uint64_t bits = test_rand();
+            memcpy(&values[i], &bits, sizeof(double));
+            if (test_rand() % 8 == 0)
+                values[i] = specials[test_rand() % (sizeof(specials) / sizeof(specials[0]))];
+            if (i)
+                elements[length++] = ',';
+
+            // Finite values must read back exactly, the others are null
+            char *text = elements + length;
+            length += double_text(text, values[i]);
+            elements[length] = '\0';
+            if (isfinite(values[i]))
+            {
+                double back = strtod(text, NULL);
+                CHECK(memcmp(&back, &values[i], sizeof(double)) == 0, "double %.17g read back as %.17g",
+                      values[i], back);
+            }
+            else
+            {
+                CHECK(strncmp(text, "null", 4) == 0, "non-finite double %.*s", 4, text);
+            }
+        }
+
+        check_arrays("double", write_double, values, sizeof(double), count, expect_three(elements, length),
+                     SJSON_FLOAT_SHORTEST, false);
+    }
+}
+
+/* ========================================================================
+ * half (IEEE 754 binary16)
+ * ======================================================================== */
+
+#define HALF_FINITE 63488  /* 2 signs * 31 exponents * 1024 fractions */
+
+static char half_texts[0x10000][16];  /* Shortest text of each bit pattern */
+
+static double half_value(uint16_t bits)
+{
+    int exp = (bits >> 10) & 0x1F;
+    int fraction = bits & 0x3FF;
+    double magnitude = exp ? ldexp(1024 + fraction, exp - 25) : ldexp(fraction, -24);
+    return (bits >> 15) ? -magnitude : magnitude;
+}
+
+/* Nearest half, ties to even (the way a reader rounds) */
+static uint16_t half_nearest(double value)
+{
+    uint16_t sign = signbit(value) ? 0x8000 : 0;
+    double magnitude = fabs(value);
+    unsigned low = 0;
+    unsigned high = 0x7BFF;
+
+    if (magnitude >= 65520.0)
+        return (uint16_t)(sign | 0x7C00);
+
+    // Largest half <= magnitude
+    while (low < high)
+    {
+        unsigned mid = (low + high + 1) / 2;
+        if (half_value((uint16_t)mid) <= magnitude)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+
+    double below = magnitude - half_value((uint16_t)low);
+    double above = half_value((uint16_t)(low + 1)) - magnitude;
+    if (above < below || (above == below && (low & 1)))
+        low++;
+    return (uint16_t)(sign | low);
+}
+
+/* Significant digits in a JSON number, without leading or trailing zeros */
+static int significant_digits(const char *text, size_t length)
+{
+    char digits[32];
+    int n = 0;
+
+    for (size_t i = 0; i < length && text[i] != 'e' && text[i] != 'E'; i++)
+    {
+        if (text[i] >= '0' && text[i] <= '9' && (n > 0 || text[i] != '0'))
+            digits[n++] = text[i];
+    }
+    while (n > 0 && digits[n - 1] == '0')
+        n--;
+    return n;
+}
+
+static sjson_status_t write_half(sjson_context_t *ctx, const void *values, const void *base, size_t stride,
+                                 size_t count)
+{
+    sjson_AddHalfArrayToObject(ctx, "a", (const uint16_t *)values, count);
+    sjson_AddHalfArrayStridedToObjectByKey(ctx, &key_b, base, stride, count);
+    return sjson_AddHalfArrayStridedToObject(ctx, "c", base, stride, count);
+}
+
+/* Every finite half, subnormals included, in one strided array */
+static void test_half_all(void)
+{
+    static uint16_t all[HALF_FINITE];
+    static char memory[3 * HALF_FINITE + 8];
+    char buffer[200];
+    test_sink_t sink;
+    sjson_context_t ctx;
+    size_t count = 0;
+    size_t ties = 0;
+
+    for (unsigned bits = 0; bits < 0x10000; bits++)
+    {
+        if (((bits >> 10) & 0x1F) != 0x1F)
+            all[count++] = (uint16_t)bits;
+    }
+    CHECK(count == HALF_FINITE, "finite halves %zu", count);
+
+    // Stride 3 from an odd address: no value is aligned
+    for (size_t i = 0; i < count; i++)
+        memcpy(memory + 1 + 3 * i, &all[i], sizeof(uint16_t));
+
+    test_sink_init(&sink, 16 * HALF_FINITE);
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_AddHalfArrayStridedToObject(&ctx, "h", memory + 1, 3, count) == SJSON_OK, "all halves");
+    CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+    test_sink_append(&sink, "", 1);
+
+    const char *p = sink.data + strlen("{\"h\":[");
+    for (size_t i = 0; i < count; i++)
+    {
+        uint16_t bits = all[i];
+        char *end;
+        double value = strtod(p, &end);
+        size_t length = (size_t)(end - p);
+
+        CHECK(length > 0 && length < sizeof(half_texts[0]), "half 0x%04x: no number at %.20s", bits, p);
+        if (length == 0 || length >= sizeof(half_texts[0]))
+            break;
+        memcpy(half_texts[bits], p, length);
+
+        CHECK(half_nearest(value) == bits, "half 0x%04x (%.9g) written as %.*s", bits, half_value(bits),
+              (int)length, p);
+
+        // No shorter %e text reads back as the same half, except one lying
+        // exactly halfway to a neighbour (Grisu2 leaves the boundaries out)
+        for (int digits = 1; digits < significant_digits(p, length); digits++)
+        {
+            char shorter[32];
+            snprintf(shorter, sizeof(shorter), "%.*e", digits - 1, half_value(bits));
+            double candidate = strtod(shorter, NULL);
+            bool tie = candidate == (half_value(bits) + half_value((uint16_t)(bits + 1))) / 2 ||
+                       candidate == (half_value(bits) + half_value((uint16_t)(bits - 1))) / 2;
+            CHECK(half_nearest(candidate) != bits || tie, "half 0x%04x: %s is shorter than %.*s", bits,
+                  shorter, (int)length, p);
+            ties += (half_nearest(candidate) == bits && tie);
+        }
+
+        p = end + 1;
+    }
+    CHECK(strcmp(p - 1, "]}") == 0, "trailer %s", p - 1);
+    CHECK(ties < count / 50, "%zu halves longer than needed", ties);
+
+    test_sink_free(&sink);
+}
+
+/* Infinities and NaNs have no JSON number: null */
+static void test_half_special(void)
+{
+    static const uint16_t values[] = { 0x7C00, 0xFC00, 0x7E00, 0x7C01, 0xFFFF, 0x3C00, 0x8000, 0x0001 };
+    static const char doc[] = "[null,null,null,null,null,1,-0,";
+    char buffer[64];
+    test_sink_t sink;
+    sjson_context_t ctx;
+
+    test_sink_init(&sink, 256);
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    sjson_AddHalfArrayToObject(&ctx, "h", values, sizeof(values) / sizeof(values[0]));
+    sjson_End(&ctx);
+    test_sink_append(&sink, "", 1);
+    CHECK(strncmp(sink.data + 5, doc, strlen(doc)) == 0, "specials %s", sink.data);
+
+    // The smallest subnormal, 2^-24
+    CHECK(strtod(sink.data + 5 + strlen(doc), NULL) == ldexp(1, -24) ||
+          half_nearest(strtod(sink.data + 5 + strlen(doc), NULL)) == 0x0001, "subnormal %s", sink.data);
+
+    test_sink_free(&sink);
+}
+
+/* Random halves at random strides, shortest and in every fixed precision */
+static void test_half_random(void)
+{
+    static char elements[COUNT * 40];
+    uint16_t values[COUNT];
+
+    for (int iter = 0; iter < 3000; iter++)
+    {
+        size_t count = (size_t)(test_rand() % (COUNT + 1));
+        int precision = (int)(test_rand() % (SJSON_FLOAT_MAX_PRECISION + 2)) - 1;
+        bool trim = (test_rand() & 1) != 0;
+        size_t length = 0;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            values[i] = (uint16_t)test_rand();
+            if (i)
+                elements[length++] = ',';
+
+            if (((values[i] >> 10) & 0x1F) == 0x1F)
+            {
+                memcpy(elements + length, "null", 4);
+                length += 4;
+            }
+            else if (precision == SJSON_FLOAT_SHORTEST)
+            {
+                size_t n = strlen(half_texts[values[i]]);
+                memcpy(elements + length, half_texts[values[i]], n);
+                length += n;
+            }
+            else
+            {
+                // Fixed precision formats the exact value like a float
+                length += float_text(elements + length, (float)half_value(values[i]), precision, trim);
+            }
+        }
+
+        check_arrays("half", write_half, values, sizeof(uint16_t), count, expect_three(elements, length),
+                     precision, trim);
+    }
+}
+
+int main(void)
+{
+    if (!test_isa_supported())
+    {
+        return TEST_SKIP;
+    }
+
+    sjson_KeyInit(&key_b, "b");
+    test_int64();
+    test_float();
+    test_Int8();
+    test_Int16();
+    test_Int32();
+    test_UInt8();
+    test_UInt16();
+    test_UInt32();
+    test_UInt64();
+    test_double();
+    test_half_all();
+    test_half_special();
+    test_half_random();
+    return test_finish("test_arrays");
+}
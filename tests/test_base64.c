@@ -0,0 +1,177 @@
+/**
+ * @file test_base64.c
+ * @brief Base64 values against a scalar reference encoder
+ *
+ * Built once per SIMD path. Covers every buffer size around the 4-byte
+ * group, batches split across flushes, and buffers too small for a group.
+ */
+
+#include "test_util.h"
+
+#define MAX_DATA 4096
+
+static const char reference_chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* One group at a time, straight from RFC 4648 */
+static size_t reference_base64(char *out, const unsigned char *data, size_t length)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < length; i += 3)
+    {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < length)
+            v |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < length)
+            v |= data[i + 2];
+        out[n++] = reference_chars[v >> 18];
+        out[n++] = reference_chars[(v >> 12) & 0x3F];
+        out[n++] = (i + 1 < length) ? reference_chars[(v >> 6) & 0x3F] : '=';
+        out[n++] = (i + 2 < length) ? reference_chars[v & 0x3F] : '=';
+    }
+    return n;
+}
+
+static unsigned char data[MAX_DATA + 3];
+static char expected[2 * MAX_DATA + 64];
+
+/* ["<base64>"] */
+static size_t expected_array(const unsigned char *bytes, size_t length)
+{
+    size_t n = 0;
+    expected[n++] = '[';
+    expected[n++] = '"';
+    n += reference_base64(expected + n, bytes, length);
+    expected[n++] = '"';
+    expected[n++] = ']';
+    return n;
+}
+
+/* Random lengths and buffer sizes, misaligned input */
+static void test_random(void)
+{
+    test_sink_t sink;
+    test_sink_init(&sink, sizeof(expected));
+
+    for (int iter = 0; iter < 3000; iter++)
+    {
+        size_t length = (iter < 200) ? (size_t)iter : (size_t)(test_rand() % MAX_DATA);
+        size_t buffer_size = 4 + (size_t)(test_rand() % 600);
+        const unsigned char *bytes = data + iter % 3;
+        char *buffer = malloc(buffer_size);
+        sjson_context_t ctx;
+
+        sink.length = 0;
+        sjson_InitArray(&ctx, buffer, buffer_size, test_capture, &sink);
+        CHECK(sjson_AddBase64ToArray(&ctx, bytes, length) == SJSON_OK, "add length=%zu", length);
+        CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+
+        size_t n = expected_array(bytes, length);
+        CHECK(test_sink_equals(&sink, expected, n),
+              "length=%zu buffer_size=%zu", length, buffer_size);
+
+        // Dry run counts the same bytes
+        sjson_InitArray(&ctx, buffer, buffer_size, test_capture, &sink);
+        sjson_SetDryRun(&ctx, true);
+        sjson_AddBase64ToArray(&ctx, bytes, length);
+        sjson_End(&ctx);
+        CHECK(sjson_GetByteCount(&ctx) == n, "dry run length=%zu", length);
+
+        free(buffer);
+    }
+
+    test_sink_free(&sink);
+}
+
+/* Every buffer size from 1 byte up: too small for a group fails, never hangs */
+static void test_small_buffers(void)
+{
+    test_sink_t sink;
+    test_sink_init(&sink, sizeof(expected));
+
+    for (size_t buffer_size = 1; buffer_size <= 40; buffer_size++)
+    {
+        for (size_t length = 0; length <= 20; length++)
+        {
+            char buffer[40];
+            sjson_context_t ctx;
+
+            sink.length = 0;
+            sjson_InitArray(&ctx, buffer, buffer_size, test_capture, &sink);
+            sjson_status_t status = sjson_AddBase64ToArray(&ctx, data, length);
+
+            if (buffer_size < 4 && length > 0)
+            {
+                CHECK(status == SJSON_ERROR_BUFFER_FULL,
+                      "buffer_size=%zu length=%zu status=%d", buffer_size, length, status);
+                continue;
+            }
+
+            CHECK(status == SJSON_OK, "buffer_size=%zu length=%zu status=%d",
+                  buffer_size, length, status);
+            CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+            CHECK(test_sink_equals(&sink, expected, expected_array(data, length)),
+                  "buffer_size=%zu length=%zu", buffer_size, length);
+        }
+    }
+
+    test_sink_free(&sink);
+}
+
+/* A framer leaves less usable space than the buffer has */
+static void test_chunked(void)
+{
+    test_sink_t sink;
+    test_sink_init(&sink, 64 * sizeof(expected));
+
+    for (size_t buffer_size = 26; buffer_size <= 64; buffer_size++)
+    {
+        for (size_t length = 1; length <= 50; length += 7)
+        {
+            char buffer[64];
+            sjson_context_t ctx;
+
+            sink.length = 0;
+            sjson_InitArray(&ctx, buffer, buffer_size, test_capture, &sink);
+            CHECK(sjson_SetFramer(&ctx, &sjson_framer_chunked) == SJSON_OK, "framer");
+            sjson_status_t status = sjson_AddBase64ToArray(&ctx, data, length);
+
+            if (ctx.buffer_size < 4)
+            {
+                CHECK(status == SJSON_ERROR_BUFFER_FULL,
+                      "chunked buffer_size=%zu length=%zu status=%d", buffer_size, length, status);
+                continue;
+            }
+
+            CHECK(status == SJSON_OK, "chunked buffer_size=%zu length=%zu status=%d",
+                  buffer_size, length, status);
+            CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+
+            size_t payload = test_dechunk(sink.data, sink.length);
+            sink.length = payload;
+            CHECK(payload != (size_t)-1 && test_sink_equals(&sink, expected, expected_array(data, length)),
+                  "chunked buffer_size=%zu length=%zu", buffer_size, length);
+        }
+    }
+
+    test_sink_free(&sink);
+}
+
+int main(void)
+{
+    if (!test_isa_supported())
+    {
+        return TEST_SKIP;
+    }
+
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (unsigned char)test_rand();
+    }
+
+    test_random();
+    test_small_buffers();
+    test_chunked();
+
+    return test_finish("test_base64");
+}
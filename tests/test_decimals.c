@@ -0,0 +1,185 @@
+/**
+ * @file test_decimals.c
+ * @brief Decimal writers against printf
+ *
+ * Random mantissas of every size, INT64_MIN and INT64_MAX among them, with
+ * every scale 0..SJSON_DECIMAL_MAX_SCALE go through the single value,
+ * array, pre-encoded-key and template writers, with buffer sizes that
+ * leave little room at the end.
+ */
+
+#include <inttypes.h>
+#include "test_util.h"
+
+#define COUNT 32
+
+static char expected[1 << 14];
+static sjson_key_t key_b;
+static sjson_key_t key_d;
+
+/* mantissa / 10^scale with exactly scale decimals, from printf */
+static size_t print_decimal(char *out, int64_t mantissa, unsigned scale)
+{
+    uint64_t magnitude = (mantissa < 0) ? 0 - (uint64_t)mantissa : (uint64_t)mantissa;
+    uint64_t divisor = 1;
+    for (unsigned i = 0; i < scale; i++)
+        divisor *= 10;
+
+    if (scale == 0)
+        return (size_t)sprintf(out, "%s%" PRIu64, (mantissa < 0) ? "-" : "", magnitude);
+    return (size_t)sprintf(out, "%s%" PRIu64 ".%0*" PRIu64, (mantissa < 0) ? "-" : "", magnitude / divisor,
+                           (int)scale, magnitude % divisor);
+}
+
+static int64_t random_mantissa(void)
+{
+    static const int64_t edges[] = { 0, 1, -1, 9, -10, INT64_MAX, INT64_MIN, INT64_MIN + 1,
+                                     999999999999999999, 1000000000000000000, -1000000000000000000 };
+    if (test_rand() % 8 == 0)
+        return edges[test_rand() % (sizeof(edges) / sizeof(edges[0]))];
+
+    uint64_t bits = test_rand() >> (test_rand() % 64);
+    return (int64_t)((test_rand() & 1) ? bits : 0 - bits);
+}
+
+static void test_writers(void)
+{
+    static sjson_template_op_t ops[4];
+    int64_t mantissas[COUNT];
+    char scattered[1 + COUNT * 11];
+    sjson_template_t tmpl;
+    test_sink_t sink;
+
+    test_sink_init(&sink, sizeof(expected));
+
+    for (int iter = 0; iter < 20000; iter++)
+    {
+        unsigned scale = (unsigned)(test_rand() % (SJSON_DECIMAL_MAX_SCALE + 1));
+        size_t count = (size_t)(test_rand() % (COUNT + 1));
+        size_t buffer_size = 24 + (size_t)(test_rand() % 200);
+        char *buffer = malloc(buffer_size);
+        char format[8];
+        sjson_value_t value;
+        sjson_context_t ctx;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            mantissas[i] = random_mantissa();
+            memcpy(scattered + 1 + i * 11, &mantissas[i], sizeof(int64_t));
+        }
+        value.i = random_mantissa();
+        snprintf(format, sizeof(format), "%%d%u", scale);
+        CHECK(sjson_TemplateCompile(&tmpl, format, ops, 4) == SJSON_OK, "compile %s", format);
+
+        // [v,v,v,[mantissas],[mantissas],{"a":[mantissas],"b":[mantissas],"c":v,"d":v}]
+        size_t n = 0;
+        expected[n++] = '[';
+        for (int i = 0; i < 3; i++)
+        {
+            n += print_decimal(expected + n, value.i, scale);
+            expected[n++] = ',';
+        }
+        for (int copy = 0; copy < 3; copy++)
+        {
+            n += (size_t)sprintf(expected + n, "%s%s", copy ? "," : "", copy == 2 ? "{\"a\":[" : "[");
+            for (size_t i = 0; i < count; i++)
+            {
+                if (i)
+                    expected[n++] = ',';
+                n += print_decimal(expected + n, mantissas[i], scale);
+            }
+            expected[n++] = ']';
+        }
+        n += (size_t)sprintf(expected + n, ",\"b\":[");
+        for (size_t i = 0; i < count; i++)
+        {
+            if (i)
+                expected[n++] = ',';
+            n += print_decimal(expected + n, mantissas[i], scale);
+        }
+        n += (size_t)sprintf(expected + n, "],\"c\":");
+        n += print_decimal(expected + n, value.i, scale);
+        n += (size_t)sprintf(expected + n, ",\"d\":");
+        n += print_decimal(expected + n, value.i, scale);
+        n += (size_t)sprintf(expected + n, "}]");
+
+        sink.length = 0;
+        sjson_InitArray(&ctx, buffer, buffer_size, test_capture, &sink);
+        CHECK(sjson_AddDecimalToArray(&ctx, value.i, scale) == SJSON_OK, "decimal");
+        CHECK(sjson_EmitTemplate(&ctx, &tmpl, &value) == SJSON_OK, "template");
+        CHECK(sjson_AddDecimalToArray(&ctx, value.i, scale) == SJSON_OK, "decimal");
+
+        // Two nested arrays of single values, then the object writers
+        for (int copy = 0; copy < 3; copy++)
+        {
+            if (copy < 2)
+            {
+                sjson_AddArrayToArray(&ctx);
+                for (size_t i = 0; i < count; i++)
+                    sjson_AddDecimalToArray(&ctx, mantissas[i], scale);
+                sjson_Close(&ctx);
+                continue;
+            }
+            sjson_AddObjectToArray(&ctx);
+            CHECK(sjson_AddDecimalArrayToObject(&ctx, "a", mantissas, count, scale) == SJSON_OK, "array");
+            CHECK(sjson_AddDecimalArrayStridedToObjectByKey(&ctx, &key_b, scattered + 1, 11, count, scale) ==
+                  SJSON_OK, "strided array by key");
+            CHECK(sjson_AddDecimalToObject(&ctx, "c", value.i, scale) == SJSON_OK, "in object");
+            CHECK(sjson_AddDecimalToObjectByKey(&ctx, &key_d, value.i, scale) == SJSON_OK, "by key");
+        }
+        CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+
+        CHECK(test_sink_equals(&sink, expected, n),
+              "scale %u buffer_size=%zu:\n  got      %.*s\n  expected %.*s", scale, buffer_size,
+              (int)sink.length, sink.data, (int)n, expected);
+        free(buffer);
+    }
+
+    test_sink_free(&sink);
+}
+
+static void test_edges(void)
+{
+    static const struct {
+        int64_t mantissa;
+        unsigned scale;
+        const char *text;
+    } cases[] = {
+        { INT64_MIN, 18, "-9.223372036854775808" },
+        { INT64_MAX, 18, "9.223372036854775807" },
+        { INT64_MIN, 0, "-9223372036854775808" },
+        { -5, 3, "-0.005" },
+        { 5, 18, "0.000000000000000005" },
+        { 0, 18, "0.000000000000000000" },
+        { -1000, 3, "-1.000" },
+    };
+    char buffer[64];
+    test_sink_t sink;
+    sjson_context_t ctx;
+
+    test_sink_init(&sink, 256);
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        sink.length = 0;
+        sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+        sjson_AddDecimalToArray(&ctx, cases[i].mantissa, cases[i].scale);
+        sjson_End(&ctx);
+        CHECK(sink.length == strlen(cases[i].text) + 2 &&
+              memcmp(sink.data + 1, cases[i].text, sink.length - 2) == 0,
+              "%s: %.*s", cases[i].text, (int)sink.length, sink.data);
+    }
+
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_AddDecimalToArray(&ctx, 1, SJSON_DECIMAL_MAX_SCALE + 1) == SJSON_ERROR_INVALID_PARAM,
+          "scale 19");
+    test_sink_free(&sink);
+}
+
+int main(void)
+{
+    sjson_KeyInit(&key_b, "b");
+    sjson_KeyInit(&key_d, "d");
+    test_writers();
+    test_edges();
+    return test_finish("test_decimals");
+}
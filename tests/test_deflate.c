@@ -0,0 +1,135 @@
+/**
+ * @file test_deflate.c
+ * @brief Deflate stage round trip
+ *
+ * Documents are written once uncompressed and once through the deflate
+ * stage (each format, with and without a dictionary, plain and vectored
+ * callback); inflating the compressed stream must give the same bytes.
+ */
+
+#include "test_document.h"
+#include "stream_json_deflate.h"
+
+#define WINDOW_BITS 12
+
+static char work[SJSON_DEFLATE_WORK_SIZE(WINDOW_BITS)];
+static char out[256];
+static const char dictionary[] = "{\"key\\\"x\":[1,-2,99],\"by\\\"key\":\"hello world\"}";
+
+static bool capture_vectored(const sjson_iovec_t *iov, size_t iovcnt, void *user_data)
+{
+    for (size_t i = 0; i < iovcnt; i++)
+    {
+        if (!test_sink_append((test_sink_t *)user_data, (const char *)iov[i].base, iov[i].len))
+            return false;
+    }
+    return true;
+}
+
+/* Plain callback of a context that has a vectored one: must not be called */
+static bool reject_plain(const char *buffer, size_t length, void *user_data)
+{
+    (void)buffer;
+    (void)length;
+    (void)user_data;
+    return false;
+}
+
+/* Inflate everything in compressed; returns false on any zlib error */
+static bool inflate_all(sjson_deflate_format_t format, bool with_dict,
+                        const test_sink_t *compressed, test_sink_t *plain)
+{
+    static const int window[] = { -15, 15, 16 + 15 };
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, window[format]) != Z_OK)
+        return false;
+
+    if (with_dict && format == SJSON_DEFLATE_RAW &&
+        inflateSetDictionary(&strm, (const Bytef *)dictionary, sizeof(dictionary) - 1) != Z_OK)
+    {
+        inflateEnd(&strm);
+        return false;
+    }
+
+    strm.next_in = (Bytef *)compressed->data;
+    strm.avail_in = (uInt)compressed->length;
+    strm.next_out = (Bytef *)plain->data;
+    strm.avail_out = (uInt)plain->capacity;
+
+    int ret;
+    do
+    {
+        ret = inflate(&strm, Z_NO_FLUSH);
+        if (ret == Z_NEED_DICT && with_dict)
+        {
+            if (inflateSetDictionary(&strm, (const Bytef *)dictionary, sizeof(dictionary) - 1) != Z_OK)
+                break;
+            ret = Z_OK;
+        }
+    } while (ret == Z_OK && strm.avail_in > 0);
+
+    plain->length = (size_t)strm.total_out;
+    inflateEnd(&strm);
+    return ret == Z_STREAM_END;
+}
+
+int main(void)
+{
+    sjson_deflate_t z;
+    test_sink_t reference, compressed, plain;
+    char buffer[512];
+
+    test_document_setup();
+    test_sink_init(&reference, 1 << 20);
+    test_sink_init(&compressed, 1 << 20);
+    test_sink_init(&plain, 1 << 20);
+
+    for (uint64_t seed = 1; seed <= 600; seed++)
+    {
+        sjson_deflate_format_t format = (sjson_deflate_format_t)(seed % 3);
+        bool with_dict = format != SJSON_DEFLATE_GZIP && (seed / 3) % 2 == 1;
+        bool vectored = (seed / 6) % 2 == 1;
+        size_t buffer_size = 64 + (size_t)(test_hash(seed) % 448);
+        test_document_t doc;
+        sjson_context_t ctx;
+
+        test_document_init(&doc, seed, 200);
+        reference.length = 0;
+        test_document_begin(&doc, &ctx, buffer, buffer_size, test_capture, &reference);
+        CHECK(test_document_write(&doc, &ctx) == SJSON_OK, "reference seed=%llu", (unsigned long long)seed);
+
+        CHECK(sjson_DeflateInit(&z, format, (int)(seed % 10), WINDOW_BITS, work, sizeof(work),
+                                out, sizeof(out)) == SJSON_OK, "deflate init");
+        if (with_dict)
+            CHECK(sjson_DeflateSetDictionary(&z, dictionary, sizeof(dictionary) - 1) == SJSON_OK, "dict");
+
+        test_document_init(&doc, seed, 200);
+        compressed.length = 0;
+        test_document_begin(&doc, &ctx, buffer, buffer_size,
+                            vectored ? reject_plain : test_capture, &compressed);
+        if (vectored)
+            sjson_SetVectoredCallback(&ctx, capture_vectored);
+        CHECK(sjson_DeflateAttach(&ctx, &z) == SJSON_OK, "attach");
+
+        // A sync flush halfway must not change the decoded bytes
+        int half = doc.steps / 2;
+        for (; doc.next < half; doc.next++)
+            CHECK(test_document_step(&doc, &ctx) == SJSON_OK, "step %d", doc.next);
+        CHECK(sjson_Flush(&ctx) == SJSON_OK, "flush");
+        CHECK(test_document_write(&doc, &ctx) == SJSON_OK, "compressed seed=%llu", (unsigned long long)seed);
+        CHECK(z.strm.total_in == reference.length, "total_in %lu vs %zu",
+              (unsigned long)z.strm.total_in, reference.length);
+
+        CHECK(inflate_all(format, with_dict, &compressed, &plain),
+              "inflate seed=%llu format=%d dict=%d", (unsigned long long)seed, (int)format, (int)with_dict);
+        CHECK(test_sink_equals(&plain, reference.data, reference.length),
+              "round trip seed=%llu format=%d dict=%d vectored=%d",
+              (unsigned long long)seed, (int)format, (int)with_dict, (int)vectored);
+    }
+
+    test_sink_free(&reference);
+    test_sink_free(&compressed);
+    test_sink_free(&plain);
+    return test_finish("test_deflate");
+}
@@ -0,0 +1,170 @@
+/**
+ * @file test_document.h
+ * @brief Pseudo-random documents for comparing output modes
+ *
+ * A document is a sequence of steps derived from a seed. Step i depends only
+ * on (seed, i) and the current nesting, so the same document can be written
+ * through any output mode (blocking, non-blocking with retries, pull, dry
+ * run, framed, compressed) and the outputs compared byte for byte.
+ */
+
+#ifndef TEST_DOCUMENT_H
+#define TEST_DOCUMENT_H
+
+#include <math.h>
+#include "test_util.h"
+
+typedef struct {
+    uint64_t seed;
+    int steps;      /* Steps before sjson_End() */
+    int next;       /* Next step to run */
+} test_document_t;
+
+static sjson_key_t test_document_key;
+static sjson_template_t test_document_template;
+static sjson_template_op_t test_document_ops[16];
+
+/* Compile the key and template the documents use (once per program) */
+static inline void test_document_setup(void)
+{
+    CHECK(sjson_KeyInit(&test_document_key, "by\"key") == SJSON_OK, "key");
+    CHECK(sjson_TemplateCompile(&test_document_template,
+                                "{\"a\":%i,\"s\":%s,\"g\":%g,\"p\":\"%%\"}",
+                                test_document_ops, 16) == SJSON_OK, "template");
+}
+
+static inline uint64_t test_hash(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33;
+    x *= 0xC4CEB3F99D1C5D5Bull;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline void test_document_init(test_document_t *doc, uint64_t seed, int max_steps)
+{
+    doc->seed = seed;
+    doc->steps = 1 + (int)(test_hash(seed) % (uint64_t)max_steps);
+    doc->next = 0;
+}
+
+/* Root container of the document: object for odd seeds */
+static inline bool test_document_is_object(const test_document_t *doc)
+{
+    return (doc->seed & 1) != 0;
+}
+
+static inline sjson_status_t test_document_begin(const test_document_t *doc, sjson_context_t *ctx,
+                                                 char *buffer, size_t buffer_size,
+                                                 sjson_send_callback_t callback, void *user_data)
+{
+    return test_document_is_object(doc)
+               ? sjson_InitObject(ctx, buffer, buffer_size, callback, user_data)
+               : sjson_InitArray(ctx, buffer, buffer_size, callback, user_data);
+}
+
+/* Run step doc->next without advancing; the last step is sjson_End() */
+static inline sjson_status_t test_document_step(const test_document_t *doc, sjson_context_t *ctx)
+{
+    if (doc->next >= doc->steps)
+    {
+        return sjson_End(ctx);
+    }
+
+    uint64_t r = test_hash(doc->seed * 1000003u + (uint64_t)doc->next);
+    bool object = ctx->depth_stack[ctx->depth - 1] == '}';
+    const char *key = "key\"x";
+    int op = (int)(r % 14);
+    int64_t v = (int64_t)test_hash(r / 14);
+    r /= 14;
+
+    if (ctx->depth > 1 && op == 0)
+    {
+        return sjson_Close(ctx);
+    }
+
+    switch (op)
+    {
+    case 0:
+    case 1:
+        if (ctx->depth < 6)
+            return object ? sjson_AddObjectToObject(ctx, key) : sjson_AddObjectToArray(ctx);
+        break;
+    case 2:
+        if (ctx->depth < 6)
+            return object ? sjson_AddArrayToObject(ctx, key) : sjson_AddArrayToArray(ctx);
+        break;
+    case 4:
+    {
+        double d;
+        memcpy(&d, &v, sizeof(d));
+        if (!isfinite(d))
+            d = 1.5;
+        return object ? sjson_AddNumberToObject(ctx, key, d) : sjson_AddIntToArray(ctx, (int32_t)v);
+    }
+    case 5:
+        return object ? sjson_AddFloatToObject(ctx, key, (float)(v % 100000) / 7.0f)
+                      : sjson_AddFloatToArray(ctx, (float)(v % 1000) / 3.0f);
+    case 6:
+        return object ? sjson_AddDecimalToObject(ctx, key, v % 1000000, (unsigned)(r % 7))
+                      : sjson_AddDecimalToArray(ctx, v, (unsigned)(r % 19));
+    case 7:
+        return object ? sjson_AddTimestampToObject(ctx, key, v % 4000000000000000000LL, (unsigned)(r % 10))
+                      : sjson_AddTimestampToArray(ctx, v / 4, (unsigned)(r % 10));
+    case 8:
+    {
+        static const char *const strings[] = { "", "a\"b\\c\n", "hello world", "\x01\x1f tab\t" };
+        return object ? sjson_AddStringToObject(ctx, key, strings[r % 4])
+                      : sjson_AddStringToArray(ctx, strings[r % 4]);
+    }
+    case 9:
+    {
+        int64_t values[5] = { v, 1, -2, v / 3, 99 };
+        return object ? sjson_AddIntArrayToObject(ctx, key, values, (size_t)(r % 6))
+                      : sjson_AddIntToArray(ctx, 7);
+    }
+    case 10:
+    {
+        unsigned char bytes[10];
+        for (int j = 0; j < 10; j++)
+            bytes[j] = (unsigned char)test_hash(r + (uint64_t)j);
+        return object ? sjson_AddBase64ToObject(ctx, key, bytes, (size_t)(r % 11))
+                      : sjson_AddBase64ToArray(ctx, bytes, (size_t)(r % 11));
+    }
+    case 11:
+        return object ? sjson_AddRawToObject(ctx, key, "[true,null]") : sjson_AddIntToArray(ctx, -1);
+    case 12:
+        return object ? sjson_AddIntToObjectByKey(ctx, &test_document_key, v)
+                      : sjson_AddStringToArray(ctx, "x");
+    case 13:
+        if (!object)
+        {
+            sjson_value_t values[3];
+            values[0].i = v;
+            values[1].s = "q\"s";
+            values[2].d = 0.25;
+            return sjson_EmitTemplate(ctx, &test_document_template, values);
+        }
+        return sjson_AddRawToObject(ctx, "t", "{}");
+    default:
+        break;
+    }
+
+    return object ? sjson_AddIntToObject(ctx, key, v) : sjson_AddIntToArray(ctx, v);
+}
+
+/* Run every remaining step, stopping at the first error */
+static inline sjson_status_t test_document_write(test_document_t *doc, sjson_context_t *ctx)
+{
+    for (; doc->next <= doc->steps; doc->next++)
+    {
+        sjson_status_t status = test_document_step(doc, ctx);
+        if (status != SJSON_OK)
+            return status;
+    }
+    return SJSON_OK;
+}
+
+#endif /* TEST_DOCUMENT_H */
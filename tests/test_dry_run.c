@@ -0,0 +1,133 @@
+/**
+ * @file test_dry_run.c
+ * @brief Dry-run byte count against the real output length
+ *
+ * The count must equal the length of the document written for real, and
+ * a dry run must not call the callback.
+ */
+
+#include "test_document.h"
+
+/* Fails the test if a dry run sends anything */
+static bool no_send(const char *buffer, size_t length, void *user_data)
+{
+    (void)buffer;
+    (void)user_data;
+    CHECK(0, "dry run sent %zu bytes", length);
+    return false;
+}
+
+static void test_documents(void)
+{
+    test_sink_t reference;
+    char buffer[512];
+
+    test_sink_init(&reference, 1 << 20);
+
+    for (uint64_t seed = 1; seed <= 3000; seed++)
+    {
+        size_t buffer_size = 128 + (size_t)(test_hash(seed + 5) % 384);
+        test_document_t doc;
+        sjson_context_t ctx;
+
+        test_document_init(&doc, seed, 200);
+        reference.length = 0;
+        test_document_begin(&doc, &ctx, buffer, buffer_size, test_capture, &reference);
+        CHECK(test_document_write(&doc, &ctx) == SJSON_OK, "reference seed=%llu", (unsigned long long)seed);
+        CHECK(sjson_GetByteCount(&ctx) == reference.length, "byte count seed=%llu", (unsigned long long)seed);
+
+        test_document_init(&doc, seed, 200);
+        test_document_begin(&doc, &ctx, buffer, buffer_size, no_send, NULL);
+        CHECK(sjson_SetDryRun(&ctx, true) == SJSON_OK, "dry run");
+        CHECK(test_document_write(&doc, &ctx) == SJSON_OK, "dry run seed=%llu", (unsigned long long)seed);
+        CHECK(sjson_GetByteCount(&ctx) == reference.length, "seed=%llu: counted %zu, wrote %zu",
+              (unsigned long long)seed, sjson_GetByteCount(&ctx), reference.length);
+    }
+
+    test_sink_free(&reference);
+}
+
+/* Values larger than the buffer take the pass-through and batch paths */
+static size_t write_large(sjson_context_t *ctx)
+{
+    static char text[10000];
+    static unsigned char bytes[5000];
+
+    for (size_t i = 0; i < sizeof(text) - 1; i++)
+        text[i] = (i % 97 == 0) ? '"' : (char)('a' + i % 26);
+    for (size_t i = 0; i < sizeof(bytes); i++)
+        bytes[i] = (unsigned char)(i * 7);
+
+    int64_t values[300];
+    for (int i = 0; i < 300; i++)
+        values[i] = (int64_t)test_hash((uint64_t)i);
+
+    CHECK(sjson_AddStringToObject(ctx, "text", text) == SJSON_OK, "string");
+    CHECK(sjson_AddBase64ToObject(ctx, "bytes", bytes, sizeof(bytes)) == SJSON_OK, "base64");
+    CHECK(sjson_AddRawToObject(ctx, "raw", text + 1) == SJSON_OK, "raw");
+    CHECK(sjson_AddIntArrayToObject(ctx, "ints", values, 300) == SJSON_OK, "ints");
+    CHECK(sjson_End(ctx) == SJSON_OK, "end");
+    return sjson_GetByteCount(ctx);
+}
+
+static void test_large_values(void)
+{
+    test_sink_t reference;
+    char buffer[64];
+    sjson_context_t ctx;
+
+    test_sink_init(&reference, 1 << 20);
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &reference);
+    write_large(&ctx);
+
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), no_send, NULL);
+    sjson_SetDryRun(&ctx, true);
+    CHECK(write_large(&ctx) == reference.length, "large values: counted %zu, wrote %zu",
+          sjson_GetByteCount(&ctx), reference.length);
+
+    test_sink_free(&reference);
+}
+
+/* Switching dry run mid-document would send a corrupt document */
+static void test_toggle_refused(void)
+{
+    test_sink_t sink;
+    char buffer[64];
+    sjson_context_t ctx;
+
+    test_sink_init(&sink, 256);
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_SetDryRun(&ctx, true) == SJSON_OK, "right after Init");
+    CHECK(sjson_SetDryRun(&ctx, false) == SJSON_OK, "still nothing added");
+    CHECK(sjson_AddIntToObject(&ctx, "a", 1) == SJSON_OK, "add");
+    CHECK(sjson_SetDryRun(&ctx, true) == SJSON_ERROR_INVALID_STATE, "enabled mid-document");
+    CHECK(sjson_AddStringToObject(&ctx, "b", "x") == SJSON_OK, "add");
+    CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+    CHECK(test_sink_equals(&sink, "{\"a\":1,\"b\":\"x\"}", 15), "%.*s", (int)sink.length, sink.data);
+
+    // Once counting, the document cannot switch back to real output
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), no_send, NULL);
+    sjson_SetDryRun(&ctx, true);
+    sjson_AddIntToArray(&ctx, 1);
+    CHECK(sjson_SetDryRun(&ctx, false) == SJSON_ERROR_INVALID_STATE, "disabled mid-document");
+    sjson_End(&ctx);
+    CHECK(sjson_GetByteCount(&ctx) == 3, "count %zu", sjson_GetByteCount(&ctx));
+
+    // Also after a flush emptied the buffer
+    sink.length = 0;
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    sjson_AddIntToArray(&ctx, 1);
+    sjson_Flush(&ctx);
+    CHECK(sjson_SetDryRun(&ctx, true) == SJSON_ERROR_INVALID_STATE, "after flush");
+
+    test_sink_free(&sink);
+}
+
+int main(void)
+{
+    test_document_setup();
+    test_documents();
+    test_large_values();
+    test_toggle_refused();
+    return test_finish("test_dry_run");
+}
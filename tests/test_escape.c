@@ -0,0 +1,147 @@
+/**
+ * @file test_escape.c
+ * @brief String escaping against a scalar reference
+ *
+ * Built once per SIMD path. Keys and values of every length and escape
+ * density go through small and large buffers, so clean runs are found
+ * across vector boundaries and flushes.
+ */
+
+#include "test_util.h"
+
+#define MAX_STRING 5000
+
+/* RFC 8259 escaping one byte at a time */
+static size_t reference_escape(char *out, const char *str, size_t length)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t n = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char c = (unsigned char)str[i];
+        switch (c)
+        {
+        case '"':  out[n++] = '\\'; out[n++] = '"';  break;
+        case '\\': out[n++] = '\\'; out[n++] = '\\'; break;
+        case '\b': out[n++] = '\\'; out[n++] = 'b';  break;
+        case '\f': out[n++] = '\\'; out[n++] = 'f';  break;
+        case '\n': out[n++] = '\\'; out[n++] = 'n';  break;
+        case '\r': out[n++] = '\\'; out[n++] = 'r';  break;
+        case '\t': out[n++] = '\\'; out[n++] = 't';  break;
+        default:
+            if (c < 0x20)
+            {
+                memcpy(out + n, "\\u00", 4);
+                out[n + 4] = hex[c >> 4];
+                out[n + 5] = hex[c & 0xF];
+                n += 6;
+            }
+            else
+            {
+                out[n++] = (char)c;
+            }
+            break;
+        }
+    }
+    return n;
+}
+
+/* Random NUL-free string: mostly clean, mostly text, or arbitrary bytes */
+static void random_string(char *str, size_t length)
+{
+    int density = (int)(test_rand() % 3);
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned c = (unsigned)(test_rand() % 256);
+        if (density == 0 && (c < 0x20 || c == '"' || c == '\\'))
+            c = 'a';
+        else if (density == 1 && test_rand() % 20 != 0)
+            c = 'a' + (unsigned)(test_rand() % 26);
+        str[i] = (char)(c ? c : 1);
+    }
+    str[length] = '\0';
+}
+
+static char key[64];
+static char value[MAX_STRING + 1];
+static char expected[6 * (MAX_STRING + 64) + 16];
+
+int main(void)
+{
+    if (!test_isa_supported())
+    {
+        return TEST_SKIP;
+    }
+
+    test_sink_t sink;
+    test_sink_init(&sink, sizeof(expected));
+
+    for (int iter = 0; iter < 20000; iter++)
+    {
+        size_t buffer_size = 4 + (size_t)(test_rand() % ((iter % 50 == 0) ? 5000 : 200));
+        size_t value_length = (size_t)(test_rand() % ((iter % 10 == 0) ? MAX_STRING : 100));
+        size_t key_length = (size_t)(test_rand() % 40);
+        bool array = (iter & 1) != 0;
+        char *buffer = malloc(buffer_size);
+        sjson_context_t ctx;
+
+        random_string(key, key_length);
+        random_string(value, value_length);
+
+        // {"key":"value"} or ["value"]
+        size_t n = 0;
+        expected[n++] = array ? '[' : '{';
+        if (!array)
+        {
+            expected[n++] = '"';
+            n += reference_escape(expected + n, key, key_length);
+            expected[n++] = '"';
+            expected[n++] = ':';
+        }
+        expected[n++] = '"';
+        n += reference_escape(expected + n, value, value_length);
+        expected[n++] = '"';
+        expected[n++] = array ? ']' : '}';
+
+        sink.length = 0;
+        if (array)
+        {
+            sjson_InitArray(&ctx, buffer, buffer_size, test_capture, &sink);
+            CHECK(sjson_AddStringToArray(&ctx, value) == SJSON_OK, "add");
+        }
+        else
+        {
+            sjson_InitObject(&ctx, buffer, buffer_size, test_capture, &sink);
+            CHECK(sjson_AddStringToObject(&ctx, key, value) == SJSON_OK, "add");
+        }
+        CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+        CHECK(test_sink_equals(&sink, expected, n), "buffer_size=%zu key_length=%zu value_length=%zu",
+              buffer_size, key_length, value_length);
+
+        free(buffer);
+    }
+
+    // Every control character and the two escaped printables
+    for (int c = 1; c <= 0x7F; c++)
+    {
+        char buffer[32];
+        char str[2] = { (char)c, '\0' };
+        sjson_context_t ctx;
+
+        sink.length = 0;
+        sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+        sjson_AddStringToArray(&ctx, str);
+        sjson_End(&ctx);
+
+        size_t n = 0;
+        expected[n++] = '[';
+        expected[n++] = '"';
+        n += reference_escape(expected + n, str, 1);
+        expected[n++] = '"';
+        expected[n++] = ']';
+        CHECK(test_sink_equals(&sink, expected, n), "byte 0x%02x", c);
+    }
+
+    test_sink_free(&sink);
+    return test_finish("test_escape");
+}
@@ -0,0 +1,220 @@
+/**
+ * @file test_fd.c
+ * @brief File descriptor values against AddString/AddBase64
+ *
+ * Data comes from a temporary file and from a pipe fed slowly by a child
+ * process while a timer interrupts the blocked read() (EINTR), and must
+ * give the same document as the value added in one call.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "test_util.h"
+#include "stream_json_fd.h"
+
+#define DATA_SIZE 20000
+
+static char data[DATA_SIZE + 1];
+static volatile sig_atomic_t interrupts;
+
+static void on_alarm(int sig)
+{
+    (void)sig;
+    interrupts++;
+}
+
+static void make_text(size_t length)
+{
+    static const char chars[] = "\"\\\n\tab \x01\xc3\xa9";
+    for (size_t i = 0; i < length; i++)
+        data[i] = chars[test_rand() % (sizeof(chars) - 1)];
+    data[length] = '\0';
+}
+
+/* {"v":<data>,"l":[<data>]} in one call per value */
+static void write_reference(test_sink_t *sink, size_t length, sjson_encoding_t encoding)
+{
+    char buffer[256];
+    sjson_context_t ctx;
+
+    sink->length = 0;
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, sink);
+    if (encoding == SJSON_ENCODING_BASE64)
+        sjson_AddBase64ToObject(&ctx, "v", data, length);
+    else
+        sjson_AddStringToObject(&ctx, "v", data);
+    sjson_AddArrayToObject(&ctx, "l");
+    if (encoding == SJSON_ENCODING_BASE64)
+        sjson_AddBase64ToArray(&ctx, data, length);
+    else
+        sjson_AddStringToArray(&ctx, data);
+    sjson_End(&ctx);
+}
+
+static void test_file(void)
+{
+    test_sink_t reference, streamed;
+    char buffer[300];
+
+    test_sink_init(&reference, 1 << 17);
+    test_sink_init(&streamed, 1 << 17);
+
+    for (int iter = 0; iter < 40; iter++)
+    {
+        sjson_encoding_t encoding = (iter & 1) ? SJSON_ENCODING_BASE64 : SJSON_ENCODING_STRING;
+        size_t length = (size_t)(test_rand() % DATA_SIZE);
+        size_t buffer_size = SJSON_STREAM_MIN_SPACE + (size_t)(test_rand() % (sizeof(buffer) - 63));
+        FILE *file = tmpfile();
+        sjson_context_t ctx;
+
+        if (!file)
+        {
+            printf("no temporary file\n");
+            exit(TEST_SKIP);
+        }
+
+        make_text(length);
+        if (encoding == SJSON_ENCODING_BASE64)
+        {
+            for (size_t i = 0; i < length; i++)
+                data[i] = (char)test_rand();
+        }
+        CHECK(fwrite(data, 1, length, file) == length && fflush(file) == 0, "write file");
+        write_reference(&reference, length, encoding);
+
+        int fd = fileno(file);
+        streamed.length = 0;
+        sjson_InitObject(&ctx, buffer, buffer_size, test_capture, &streamed);
+        lseek(fd, 0, SEEK_SET);
+        CHECK(sjson_AddFdToObject(&ctx, "v", fd, encoding) == SJSON_OK, "fd to object");
+        sjson_AddArrayToObject(&ctx, "l");
+        lseek(fd, 0, SEEK_SET);
+        CHECK(sjson_AddFdToArray(&ctx, fd, encoding) == SJSON_OK, "fd to array");
+        CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+
+        CHECK(test_sink_equals(&streamed, reference.data, reference.length),
+              "file iter %d buffer_size=%zu: %zu vs %zu bytes", iter, buffer_size,
+              streamed.length, reference.length);
+        fclose(file);
+    }
+
+    test_sink_free(&reference);
+    test_sink_free(&streamed);
+}
+
+/* A child writes the data in small, delayed pieces; a timer keeps interrupting read() */
+static void test_pipe_interrupted(void)
+{
+    static const struct timespec pause = { 0, 2000000 };
+    test_sink_t reference, streamed;
+    char buffer[512];
+    sjson_context_t ctx;
+    struct sigaction action;
+    struct itimerval timer;
+    int fds[2];
+    size_t length = 6000;
+
+    make_text(length);
+    test_sink_init(&reference, 1 << 16);
+    test_sink_init(&streamed, 1 << 16);
+
+    if (pipe(fds) != 0)
+    {
+        printf("no pipe\n");
+        exit(TEST_SKIP);
+    }
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(fds[0]);
+        for (size_t pos = 0; pos < length; pos += 200)
+        {
+            size_t n = (length - pos < 200) ? length - pos : 200;
+            if (write(fds[1], data + pos, n) != (ssize_t)n)
+                _exit(1);
+            nanosleep(&pause, NULL);
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    CHECK(child > 0, "fork");
+
+    // No SA_RESTART, so the blocked read() fails with EINTR
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_alarm;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGALRM, &action, NULL);
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 500;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_REAL, &timer, NULL);
+
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &streamed);
+    CHECK(sjson_AddFdToObject(&ctx, "v", fds[0], SJSON_ENCODING_STRING) == SJSON_OK, "pipe to object");
+
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_REAL, &timer, NULL);
+    close(fds[0]);
+
+    int child_status = 1;
+    waitpid(child, &child_status, 0);
+    CHECK(WIFEXITED(child_status) && WEXITSTATUS(child_status) == 0, "writer process failed");
+
+    // The pipe carried only the first value, the array is added directly
+    sjson_AddArrayToObject(&ctx, "l");
+    sjson_AddStringToArray(&ctx, data);
+    CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+    write_reference(&reference, length, SJSON_ENCODING_STRING);
+
+    CHECK(interrupts > 0, "timer never fired");
+    CHECK(test_sink_equals(&streamed, reference.data, reference.length), "pipe: %zu vs %zu bytes",
+          streamed.length, reference.length);
+
+    test_sink_free(&reference);
+    test_sink_free(&streamed);
+}
+
+static void test_errors(void)
+{
+    char buffer[128];
+    test_sink_t sink;
+    sjson_context_t ctx;
+    sjson_key_t key;
+
+    test_sink_init(&sink, 1024);
+    sjson_KeyInit(&key, "k");
+
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_AddFdToObject(&ctx, "v", -1, SJSON_ENCODING_STRING) == SJSON_ERROR_INVALID_PARAM, "fd -1");
+    CHECK(sjson_AddFdToObjectByKey(&ctx, &key, -1, SJSON_ENCODING_RAW) == SJSON_ERROR_INVALID_PARAM,
+          "fd -1 by key");
+
+    // read() on a directory fails with EISDIR
+    int dir = open(".", O_RDONLY);
+    if (dir >= 0)
+    {
+        CHECK(sjson_AddFdToObject(&ctx, "v", dir, SJSON_ENCODING_BASE64) == SJSON_ERROR_BUFFER_FULL,
+              "read error");
+        close(dir);
+    }
+
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_AddFdToArray(&ctx, -1, SJSON_ENCODING_STRING) == SJSON_ERROR_INVALID_PARAM, "fd -1 in array");
+
+    test_sink_free(&sink);
+}
+
+int main(void)
+{
+    test_file();
+    test_pipe_interrupted();
+    test_errors();
+    return test_finish("test_fd");
+}
@@ -0,0 +1,88 @@
+/**
+ * @file test_float_precision.c
+ * @brief Fixed-precision float mode (sjson_SetFloatPrecision)
+ *
+ * In range, values must have exactly the requested decimals and be within
+ * half a unit of the last place. Out of range, floats fall back to the
+ * shortest float digits, not to the digits of the widened double.
+ */
+
+#include <math.h>
+#include "test_util.h"
+
+/* Writes [value] with the given precision and returns the text between the brackets */
+static size_t format_one(char *text, float value, int decimals, bool trim)
+{
+    char buffer[64];
+    test_sink_t sink;
+    sjson_context_t ctx;
+
+    test_sink_init(&sink, 64);
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_SetFloatPrecision(&ctx, decimals, trim) == SJSON_OK, "precision %d", decimals);
+    CHECK(sjson_AddFloatToArray(&ctx, value) == SJSON_OK, "add");
+    CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+
+    size_t length = sink.length - 2;
+    memcpy(text, sink.data + 1, length);
+    text[length] = '\0';
+    test_sink_free(&sink);
+    return length;
+}
+
+static void test_in_range(void)
+{
+    char text[64];
+
+    for (int iter = 0; iter < 20000; iter++)
+    {
+        int decimals = (int)(test_rand() % (SJSON_FLOAT_MAX_PRECISION + 1));
+        float value = (float)((double)(int64_t)(test_rand() % 2000000001) - 1e9) /
+                      (float)(1u << (test_rand() % 24));
+        format_one(text, value, decimals, false);
+
+        const char *point = strchr(text, '.');
+        size_t fraction = point ? strlen(point + 1) : 0;
+        CHECK(fraction == (size_t)decimals, "%.9g with %d decimals: %s", value, decimals, text);
+
+        double error = fabs(strtod(text, NULL) - (double)value);
+        CHECK(error <= 0.5 * pow(10.0, -decimals) * (1.0 + 1e-9) + fabs((double)value) * 1e-15,
+              "%.9g with %d decimals: %s", value, decimals, text);
+    }
+
+    CHECK(format_one(text, 1.5f, 3, false) == 5 && strcmp(text, "1.500") == 0, "%s", text);
+    CHECK(format_one(text, 1.5f, 3, true) == 3 && strcmp(text, "1.5") == 0, "%s", text);
+    CHECK(format_one(text, -0.004f, 2, false) == 4 && strcmp(text, "0.00") == 0, "%s", text);
+    CHECK(format_one(text, 2.0f, 2, true) == 1 && strcmp(text, "2") == 0, "%s", text);
+}
+
+/* Scaled value does not fit an int64: shortest float digits */
+static void test_out_of_range(void)
+{
+    char text[64];
+
+    format_one(text, 1e19f, 2, false);
+    CHECK(strcmp(text, "1e19") == 0, "1e19f: %s", text);
+
+    format_one(text, -3e30f, 0, false);
+    CHECK(strcmp(text, "-3e30") == 0, "-3e30f: %s", text);
+
+    format_one(text, 3.4028235e38f, SJSON_FLOAT_MAX_PRECISION, false);
+    CHECK(strcmp(text, "3.4028235e38") == 0, "FLT_MAX: %s", text);
+
+    format_one(text, 1e10f, SJSON_FLOAT_MAX_PRECISION, true);
+    CHECK(strtod(text, NULL) == 1e10, "1e10f: %s", text);
+
+    format_one(text, NAN, 2, false);
+    CHECK(strcmp(text, "null") == 0, "NaN: %s", text);
+
+    format_one(text, -INFINITY, 2, false);
+    CHECK(strcmp(text, "null") == 0, "-inf: %s", text);
+}
+
+int main(void)
+{
+    test_in_range();
+    test_out_of_range();
+    return test_finish("test_float_precision");
+}
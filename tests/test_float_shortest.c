@@ -0,0 +1,197 @@
+/**
+ * @file test_float_shortest.c
+ * @brief Shortest float and double output against strtod/strtof
+ *
+ * Random bit patterns must read back as the same value. Where a shorter
+ * %e text would also read back, the output may have at most three digits
+ * more, and only for the small share of inputs the documentation states.
+ */
+
+#include <float.h>
+#include <math.h>
+#include "test_util.h"
+
+#define SAMPLES 200000
+
+#ifndef FLT_TRUE_MIN
+#define FLT_TRUE_MIN 1.40129846e-45F  /* C11, smallest subnormal float */
+#endif
+
+/* Writes [value] and returns the text between the brackets */
+static size_t format_double(char *text, double value)
+{
+    char buffer[64];
+    test_sink_t sink = { text, 0, 64, 0 };
+    sjson_context_t ctx;
+
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    sjson_AddObjectToArray(&ctx);
+    sjson_AddNumberToObject(&ctx, "x", value);
+    sjson_End(&ctx);
+
+    // Strip [{"x": and }]
+    size_t length = sink.length - 8;
+    memmove(text, text + 6, length);
+    text[length] = '\0';
+    return length;
+}
+
+static size_t format_float(char *text, float value)
+{
+    char buffer[64];
+    test_sink_t sink = { text, 0, 64, 0 };
+    sjson_context_t ctx;
+
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    sjson_AddFloatToArray(&ctx, value);
+    sjson_End(&ctx);
+
+    size_t length = sink.length - 2;
+    memmove(text, text + 1, length);
+    text[length] = '\0';
+    return length;
+}
+
+/* Significant digits, without sign, point, exponent, leading or trailing zeros */
+static int significant_digits(const char *text)
+{
+    int n = 0;
+    int trailing = 0;
+
+    for (; *text && *text != 'e' && *text != 'E'; text++)
+    {
+        if (*text < '0' || *text > '9' || (n == 0 && *text == '0'))
+            continue;
+        n++;
+        trailing = (*text == '0') ? trailing + 1 : 0;
+    }
+    return n - trailing;
+}
+
+/* Fewest %e digits that read back as the same double */
+static int shortest_double(double value)
+{
+    char text[40];
+    for (int digits = 1; digits < 17; digits++)
+    {
+        snprintf(text, sizeof(text), "%.*e", digits - 1, value);
+        if (strtod(text, NULL) == value)
+            return digits;
+    }
+    return 17;
+}
+
+static int shortest_float(float value)
+{
+    char text[40];
+    for (int digits = 1; digits < 9; digits++)
+    {
+        snprintf(text, sizeof(text), "%.*e", digits - 1, (double)value);
+        if (strtof(text, NULL) == value)
+            return digits;
+    }
+    return 9;
+}
+
+static void test_double(void)
+{
+    char text[64];
+    size_t longer = 0;
+    size_t finite = 0;
+
+    for (int iter = 0; iter < SAMPLES; iter++)
+    {
+        uint64_t bits = test_rand();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+
+        format_double(text, value);
+        if (!isfinite(value))
+        {
+            CHECK(strcmp(text, "null") == 0, "%s", text);
+            continue;
+        }
+        finite++;
+
+        double back = strtod(text, NULL);
+        CHECK(memcmp(&back, &value, sizeof(value)) == 0, "%.17g written as %s", value, text);
+
+        int extra = significant_digits(text) - shortest_double(value);
+        CHECK(extra <= 3, "%.17g written as %s, %d digits too many", value, text, extra);
+        longer += (extra > 0);
+    }
+
+    // About 0.08% (documented as about 0.1% in stream_json_write.c and README)
+    CHECK(longer * 500 < finite, "%zu of %zu doubles longer than shortest", longer, finite);
+}
+
+static void test_float(void)
+{
+    char text[64];
+    size_t longer = 0;
+    size_t finite = 0;
+
+    for (int iter = 0; iter < SAMPLES; iter++)
+    {
+        uint32_t bits = (uint32_t)test_rand();
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+
+        format_float(text, value);
+        if (!isfinite(value))
+        {
+            CHECK(strcmp(text, "null") == 0, "%s", text);
+            continue;
+        }
+        finite++;
+
+        float back = strtof(text, NULL);
+        CHECK(memcmp(&back, &value, sizeof(value)) == 0, "%.9g written as %s", (double)value, text);
+
+        int extra = significant_digits(text) - shortest_float(value);
+        CHECK(extra <= 3, "%.9g written as %s, %d digits too many", (double)value, text, extra);
+        longer += (extra > 0);
+    }
+
+    // About 0.22% (documented as about 0.2%)
+    CHECK(longer * 250 < finite, "%zu of %zu floats longer than shortest", longer, finite);
+}
+
+static void test_named(void)
+{
+    char text[64];
+
+    format_double(text, 23.5);
+    CHECK(strcmp(text, "23.5") == 0, "23.5: %s", text);
+    format_double(text, 1e20);
+    CHECK(strtod(text, NULL) == 1e20 && significant_digits(text) == 1, "1e20: %s", text);
+    format_double(text, -0.0);
+    CHECK(strcmp(text, "-0") == 0, "-0: %s", text);
+    format_double(text, 5e-324);
+    CHECK(strcmp(text, "5e-324") == 0, "5e-324: %s", text);
+    format_double(text, DBL_MAX);
+    CHECK(strtod(text, NULL) == DBL_MAX, "DBL_MAX: %s", text);
+
+    format_float(text, 23.5f);
+    CHECK(strcmp(text, "23.5") == 0, "23.5f: %s", text);
+    format_float(text, 1e20f);
+    CHECK(strtof(text, NULL) == 1e20f && significant_digits(text) == 1, "1e20f: %s", text);
+    format_float(text, -0.0f);
+    CHECK(strcmp(text, "-0") == 0, "-0f: %s", text);
+    format_float(text, FLT_TRUE_MIN);
+    CHECK(strcmp(text, "1e-45") == 0, "FLT_TRUE_MIN: %s", text);
+    format_float(text, FLT_MAX);
+    CHECK(strtof(text, NULL) == FLT_MAX, "FLT_MAX: %s", text);
+
+    // One digit more than the shortest: 49665070 is a tie and not used
+    format_float(text, 49665072.0f);
+    CHECK(strtof(text, NULL) == 49665072.0f && shortest_float(49665072.0f) == 7, "49665072: %s", text);
+}
+
+int main(void)
+{
+    test_double();
+    test_float();
+    test_named();
+    return test_finish("test_float_shortest");
+}
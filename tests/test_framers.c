@@ -0,0 +1,155 @@
+/**
+ * @file test_framers.c
+ * @brief Built-in framers: decoded payload against unframed output
+ *
+ * Documents are written through each framer with random buffer sizes and
+ * flushes, via the plain and the vectored callback. Decoding the frames
+ * must give the unframed output, and the framing itself must be valid.
+ */
+
+#include "test_document.h"
+
+static bool capture_vectored(const sjson_iovec_t *iov, size_t iovcnt, void *user_data)
+{
+    for (size_t i = 0; i < iovcnt; i++)
+    {
+        if (!test_sink_append((test_sink_t *)user_data, (const char *)iov[i].base, iov[i].len))
+            return false;
+    }
+    return true;
+}
+
+/* WebSocket frames in place: text then continuations, FIN on the last only */
+static size_t decode_websocket(char *data, size_t length)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    size_t in = 0;
+    size_t out = 0;
+    bool first = true;
+
+    while (in + 2 <= length)
+    {
+        bool fin = (p[in] & 0x80) != 0;
+        unsigned opcode = p[in] & 0x0F;
+        uint64_t size = p[in + 1];
+        size_t header = 2;
+
+        if ((p[in] & 0x70) != 0 || (p[in + 1] & 0x80) != 0 || opcode != (first ? 1u : 0u))
+            return (size_t)-1;
+
+        if (size == 126)
+        {
+            size = (uint64_t)p[in + 2] << 8 | p[in + 3];
+            header = 4;
+        }
+        else if (size == 127)
+        {
+            size = 0;
+            for (int i = 0; i < 8; i++)
+                size = size << 8 | p[in + 2 + i];
+            header = 10;
+        }
+
+        in += header;
+        if (size > length - in)
+            return (size_t)-1;
+        memmove(data + out, data + in, (size_t)size);
+        out += (size_t)size;
+        in += (size_t)size;
+        first = false;
+
+        if (fin)
+            return (in == length) ? out : (size_t)-1;
+    }
+    return (size_t)-1;
+}
+
+/* 4-byte big-endian length before every chunk */
+static size_t decode_length_prefix(char *data, size_t length)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < length)
+    {
+        if (length - in < 4)
+            return (size_t)-1;
+        size_t size = (size_t)p[in] << 24 | (size_t)p[in + 1] << 16 | (size_t)p[in + 2] << 8 | p[in + 3];
+        in += 4;
+        if (size > length - in)
+            return (size_t)-1;
+        memmove(data + out, data + in, size);
+        out += size;
+        in += size;
+    }
+    return out;
+}
+
+typedef struct {
+    const char *name;
+    const sjson_framer_t *framer;
+    size_t (*decode)(char *data, size_t length);
+} framer_case_t;
+
+int main(void)
+{
+    static const framer_case_t cases[] = {
+        { "chunked", &sjson_framer_chunked, test_dechunk },
+        { "websocket", &sjson_framer_websocket, decode_websocket },
+        { "length_prefix", &sjson_framer_length_prefix, decode_length_prefix },
+    };
+    test_sink_t reference, framed;
+    char buffer[1024];
+
+    test_document_setup();
+    test_sink_init(&reference, 1 << 20);
+    test_sink_init(&framed, 1 << 21);
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        const framer_case_t *fc = &cases[c];
+
+        for (uint64_t seed = 1; seed <= 1000; seed++)
+        {
+            size_t buffer_size = fc->framer->headroom + fc->framer->tailroom + 128 +
+                                 (size_t)(test_hash(seed + 5) % 800);
+            bool vectored = (seed & 2) != 0;
+            test_document_t doc;
+            sjson_context_t ctx;
+
+            test_document_init(&doc, seed, 200);
+            reference.length = 0;
+            test_document_begin(&doc, &ctx, buffer, buffer_size, test_capture, &reference);
+            CHECK(test_document_write(&doc, &ctx) == SJSON_OK, "reference seed=%llu", (unsigned long long)seed);
+
+            test_document_init(&doc, seed, 200);
+            framed.length = 0;
+            test_document_begin(&doc, &ctx, buffer, buffer_size, test_capture, &framed);
+            if (vectored)
+                sjson_SetVectoredCallback(&ctx, capture_vectored);
+            CHECK(sjson_SetFramer(&ctx, fc->framer) == SJSON_OK, "set framer");
+
+            for (; doc.next <= doc.steps; doc.next++)
+            {
+                CHECK(test_document_step(&doc, &ctx) == SJSON_OK, "%s seed=%llu step %d",
+                      fc->name, (unsigned long long)seed, doc.next);
+                if (test_hash(seed + (uint64_t)doc.next) % 40 == 0)
+                    CHECK(sjson_Flush(&ctx) == SJSON_OK, "flush");
+            }
+
+            CHECK(sjson_GetByteCount(&ctx) == reference.length, "%s byte count seed=%llu",
+                  fc->name, (unsigned long long)seed);
+
+            size_t payload = fc->decode(framed.data, framed.length);
+            CHECK(payload != (size_t)-1, "%s seed=%llu: malformed framing", fc->name, (unsigned long long)seed);
+            framed.length = payload;
+            CHECK(payload == (size_t)-1 || test_sink_equals(&framed, reference.data, reference.length),
+                  "%s seed=%llu vectored=%d: payload differs", fc->name, (unsigned long long)seed, (int)vectored);
+        }
+    }
+
+    test_sink_free(&reference);
+    test_sink_free(&framed);
+    return test_finish("test_framers");
+}
@@ -0,0 +1,96 @@
+/**
+ * @file test_integers.c
+ * @brief Integer writers against snprintf
+ *
+ * Built once per SIMD path. Values of every digit count (the 9-16 digit
+ * kernel and its edges in particular) go through the single value and
+ * array writers with buffer sizes that leave little room at the end.
+ */
+
+#include <inttypes.h>
+#include "test_util.h"
+
+#define COUNT 64
+
+/* Random value with exactly digits decimal digits (1..20) */
+static uint64_t random_digits(int digits)
+{
+    uint64_t low = 1;
+    for (int i = 1; i < digits; i++)
+        low *= 10;
+    uint64_t span = (digits == 20) ? UINT64_MAX - low : low * 9;
+    return low + test_rand() % span;
+}
+
+static const uint64_t edges[] = {
+    0, 1, 9, 10, 99999999, 100000000, 999999999, 1000000000,
+    9999999999999999ull, 10000000000000000ull, 99999999999999999ull,
+    INT64_MAX, (uint64_t)INT64_MAX + 1, UINT64_MAX
+};
+
+static char expected[3 * COUNT * 22 + 128];
+
+int main(void)
+{
+    if (!test_isa_supported())
+    {
+        return TEST_SKIP;
+    }
+
+    test_sink_t sink;
+    int64_t ints[COUNT];
+    uint64_t uints[COUNT];
+    int32_t ints32[COUNT];
+
+    test_sink_init(&sink, sizeof(expected));
+
+    for (int iter = 0; iter < 5000; iter++)
+    {
+        size_t buffer_size = 16 + (size_t)(test_rand() % 300);
+        char *buffer = malloc(buffer_size);
+        sjson_context_t ctx;
+
+        for (int i = 0; i < COUNT; i++)
+        {
+            uint64_t u = (test_rand() % 4 == 0) ? edges[test_rand() % (sizeof(edges) / sizeof(edges[0]))]
+                                                 : random_digits(1 + (int)(test_rand() % 20));
+            uints[i] = u;
+            ints[i] = (int64_t)((test_rand() & 1) ? u : 0 - u);
+            ints32[i] = (int32_t)ints[i];
+        }
+
+        // {"i":[...],"u":[...],"w":[...],"v":n}
+        size_t n = 0;
+        n += (size_t)sprintf(expected + n, "{\"i\":[");
+        for (int i = 0; i < COUNT; i++)
+            n += (size_t)sprintf(expected + n, "%s%" PRId64, i ? "," : "", ints[i]);
+        n += (size_t)sprintf(expected + n, "],\"u\":[");
+        for (int i = 0; i < COUNT; i++)
+            n += (size_t)sprintf(expected + n, "%s%" PRIu64, i ? "," : "", uints[i]);
+        n += (size_t)sprintf(expected + n, "],\"w\":[");
+        for (int i = 0; i < COUNT; i++)
+            n += (size_t)sprintf(expected + n, "%s%" PRId32, i ? "," : "", ints32[i]);
+        n += (size_t)sprintf(expected + n, "],\"v\":%" PRId64 ",\"a\":[%" PRId64 "]}", ints[0], ints[1]);
+
+        sink.length = 0;
+        sjson_InitObject(&ctx, buffer, buffer_size, test_capture, &sink);
+        CHECK(sjson_AddIntArrayToObject(&ctx, "i", ints, COUNT) == SJSON_OK, "int64 array");
+        CHECK(sjson_AddUInt64ArrayToObject(&ctx, "u", uints, COUNT) == SJSON_OK, "uint64 array");
+        CHECK(sjson_AddInt32ArrayToObject(&ctx, "w", ints32, COUNT) == SJSON_OK, "int32 array");
+        CHECK(sjson_AddIntToObject(&ctx, "v", ints[0]) == SJSON_OK, "int");
+        CHECK(sjson_AddArrayToObject(&ctx, "a") == SJSON_OK, "array");
+        CHECK(sjson_AddIntToArray(&ctx, ints[1]) == SJSON_OK, "int in array");
+        CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+
+        if (!test_sink_equals(&sink, expected, n))
+        {
+            CHECK(0, "buffer_size=%zu:\n  got      %.*s\n  expected %.*s", buffer_size,
+                  (int)sink.length, sink.data, (int)n, expected);
+        }
+
+        free(buffer);
+    }
+
+    test_sink_free(&sink);
+    return test_finish("test_integers");
+}
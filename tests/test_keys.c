@@ -0,0 +1,344 @@
+/**
+ * @file test_keys.c
+ * @brief Pre-encoded keys (sjson_KeyInit) and the ByKey object writers
+ *
+ * Every ByKey writer, in random order and with keys that need escaping,
+ * must give the same bytes as its plain-key counterpart, including the
+ * comma being left out for the first member. sjson_KeyInit() must accept
+ * keys up to exactly SJSON_KEY_MAX_ENCODED encoded bytes and refuse longer
+ * ones.
+ */
+
+#include "test_util.h"
+
+#define MEMBERS 40
+#define COUNT 5
+#define STRIDE 11
+
+/* Encodes to exactly SJSON_KEY_MAX_ENCODED bytes: ," + 60 + ": */
+#define LONGEST_KEY "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefgh"
+
+static const char *const names[] = {
+    "k", "q\"\\\n\x01\x1f/", "caf\xc3\xa9", LONGEST_KEY,
+};
+
+typedef struct {
+    const char *data;
+    size_t length;
+    size_t pos;
+} memory_reader_t;
+
+static size_t read_memory(char *buffer, size_t capacity, void *state)
+{
+    memory_reader_t *reader = (memory_reader_t *)state;
+    size_t n = reader->length - reader->pos;
+    if (n > capacity)
+        n = capacity;
+    if (n > 3)
+        n = 3;
+    memcpy(buffer, reader->data + reader->pos, n);
+    reader->pos += n;
+    return n;
+}
+
+/* The same writer with the plain key (key == NULL) or the key handle */
+#define BOTH(Fn, ...)                                                  \
+    (key ? sjson_##Fn##ToObjectByKey(ctx, key, __VA_ARGS__)            \
+         : sjson_##Fn##ToObject(ctx, name, __VA_ARGS__))
+
+/* Member number op of the test object */
+static sjson_status_t write_member(sjson_context_t *ctx, int op, const char *name, const sjson_key_t *key)
+{
+    static const int64_t ints[COUNT] = { 0, -1, INT64_MAX, INT64_MIN, 42 };
+    static const int8_t int8s[COUNT] = { 0, -1, 127, -128, 42 };
+    static const int16_t int16s[COUNT] = { 0, -1, 32767, -32768, 42 };
+    static const int32_t int32s[COUNT] = { 0, -1, 2147483647, -2147483647 - 1, 42 };
+    static const uint8_t uint8s[COUNT] = { 0, 1, 255, 128, 42 };
+    static const uint16_t uint16s[COUNT] = { 0, 1, 65535, 32768, 42 };
+    static const uint32_t uint32s[COUNT] = { 0, 1, 4294967295u, 2147483648u, 42 };
+    static const uint64_t uint64s[COUNT] = { 0, 1, UINT64_MAX, 1ull << 63, 42 };
+    static const float floats[COUNT] = { 0.0f, -1.5f, 3.25e10f, 1e-7f, 42.0f };
+    static const double doubles[COUNT] = { 0.0, -1.5, 3.25e100, 1e-300, 42.0 };
+    static const uint16_t halves[COUNT] = { 0x0000, 0xBC00, 0x7BFF, 0x0001, 0x5140 };
+    static char scattered[COUNT * STRIDE + 8];
+    static const unsigned char bytes[7] = { 0, 1, 2, 0xFD, 0xFE, 0xFF, 'x' };
+    sjson_status_t status;
+
+    // Element i of the strided arrays at scattered + 1 + i * STRIDE
+#define SCATTER(values)                                                                    \
+    for (size_t i = 0; i < COUNT; i++)                                                     \
+        memcpy(scattered + 1 + i * STRIDE, &values[i], sizeof(values[0]))
+
+    switch (op)
+    {
+    case 0:
+        return BOTH(AddString, "a\"b\n\xe2\x82\xac");
+    case 1:
+        return BOTH(AddInt, INT64_MIN);
+    case 2:
+        return BOTH(AddFloat, 1.1f);
+    case 3:
+        return BOTH(AddNumber, -2.5e-8);
+    case 4:
+        return BOTH(AddDecimal, -12345, 3);
+    case 5:
+        return BOTH(AddTimestamp, -1, 6);
+    case 6:
+        return BOTH(AddRaw, "[true,{\"n\":null}]");
+    case 7:
+        return BOTH(AddBase64, bytes, sizeof(bytes));
+    case 8:
+    case 9:
+        status = key ? (op == 8 ? sjson_AddArrayToObjectByKey(ctx, key) : sjson_AddObjectToObjectByKey(ctx, key))
+                     : (op == 8 ? sjson_AddArrayToObject(ctx, name) : sjson_AddObjectToObject(ctx, name));
+        if (status != SJSON_OK)
+            return status;
+        status = (op == 8) ? sjson_AddIntToArray(ctx, 1) : sjson_AddIntToObject(ctx, "x", 1);
+        if (status != SJSON_OK)
+            return status;
+        return sjson_Close(ctx);
+    case 10:
+    {
+        status = key ? sjson_BeginValueInObjectByKey(ctx, key) : sjson_BeginValueInObject(ctx, name);
+        if (status != SJSON_OK)
+            return status;
+        char *p = sjson_Reserve(ctx, 4);
+        if (!p)
+            return SJSON_ERROR_BUFFER_FULL;
+        memcpy(p, "true", 4);
+        sjson_Commit(ctx, 4);
+        return SJSON_OK;
+    }
+    case 11:
+        status = key ? sjson_BeginStringInObjectByKey(ctx, key) : sjson_BeginStringInObject(ctx, name);
+        if (status != SJSON_OK)
+            return status;
+        status = sjson_AppendString(ctx, "ap\"pended", 9);
+        if (status != SJSON_OK)
+            return status;
+        return sjson_EndString(ctx);
+    case 12:
+    case 13:
+    case 14:
+    {
+        static const char data[] = "streamed \"text\"\n with \x01 bytes";
+        memory_reader_t reader = { data, sizeof(data) - 1, 0 };
+        sjson_encoding_t encoding = (sjson_encoding_t)(op - 12);
+        if (encoding == SJSON_ENCODING_RAW)
+            reader.data = "[1,2,3,4,5,6,7,8,9]", reader.length = 19;
+        return BOTH(AddStream, read_memory, &reader, encoding);
+    }
+    case 15:
+        return BOTH(AddIntArray, ints, COUNT);
+    case 16:
+        SCATTER(ints);
+        return BOTH(AddIntArrayStrided, scattered + 1, STRIDE, COUNT);
+    case 17:
+        return BOTH(AddInt8Array, int8s, COUNT);
+    case 18:
+        SCATTER(int8s);
+        return BOTH(AddInt8ArrayStrided, scattered + 1, STRIDE, COUNT);
+    case 19:
+        return BOTH(AddInt16Array, int16s, COUNT);
+    case 20:
+        SCATTER(int16s);
+        return BOTH(AddInt16ArrayStrided, scattered + 1, STRIDE, COUNT);
+    case 21:
+        return BOTH(AddInt32Array, int32s, COUNT);
+    case 22:
+        SCATTER(int32s);
+        return BOTH(AddInt32ArrayStrided, scattered + 1, STRIDE, COUNT);
+    case 23:
+        return BOTH(AddUInt8Array, uint8s, COUNT);
+    case 24:
+        SCATTER(uint8s);
+        return BOTH(AddUInt8ArrayStrided, scattered + 1, STRIDE, COUNT);
+    case 25:
+        return BOTH(AddUInt16Array, uint16s, COUNT);
+    case 26:
+        SCATTER(uint16s);
+        return BOTH(AddUInt16ArrayStrided, scattered + 1, STRIDE, COUNT);
+    case 27:
+        return BOTH(AddUInt32Array, uint32s, COUNT);
+    case 28:
+        SCATTER(uint32s);
+        return BOTH(AddUInt32ArrayStrided, scattered + 1, STRIDE, COUNT);
+    case 29:
+        return BOTH(AddUInt64Array, uint64s, COUNT);
+    case 30:
+        SCATTER(uint64s);
+        return BOTH(AddUInt64ArrayStrided, scattered + 1, STRIDE, COUNT);
+    case 31:
+        return BOTH(AddFloatArray, floats, COUNT);
+    case 32:
+        SCATTER(floats);
+        return BOTH(AddFloatArrayStrided, scattered + 1, STRIDE, COUNT);
+    case 33:
+        return BOTH(AddDoubleArray, doubles, COUNT);
+    case 34:
+        SCATTER(doubles);
+        return BOTH(AddDoubleArrayStrided, scattered + 1, STRIDE, COUNT);
+    case 35:
+        return BOTH(AddHalfArray, halves, COUNT);
+    case 36:
+        SCATTER(halves);
+        return BOTH(AddHalfArrayStrided, scattered + 1, STRIDE, COUNT);
+    case 37:
+        return BOTH(AddDecimalArray, ints, COUNT, 4);
+    case 38:
+        SCATTER(ints);
+        return BOTH(AddDecimalArrayStrided, scattered + 1, STRIDE, COUNT, 18);
+    default:
+        return BOTH(AddInt, 0);
+    }
+#undef SCATTER
+}
+
+static void test_writers(void)
+{
+    static char reference_buffer[1 << 14];
+    sjson_key_t keys[sizeof(names) / sizeof(names[0])];
+    test_sink_t reference;
+    test_sink_t sink;
+
+    for (size_t k = 0; k < sizeof(names) / sizeof(names[0]); k++)
+        CHECK(sjson_KeyInit(&keys[k], names[k]) == SJSON_OK, "key %zu", k);
+
+    test_sink_init(&reference, 1 << 16);
+    test_sink_init(&sink, 1 << 16);
+
+    for (int iter = 0; iter < 3000; iter++)
+    {
+        size_t buffer_size = SJSON_STREAM_MIN_SPACE + (size_t)(test_rand() % 300);
+        char *buffer = malloc(buffer_size);
+        int count = (int)(test_rand() % (MEMBERS + 1));
+        int ops[MEMBERS];
+        size_t key_index[MEMBERS];
+        sjson_context_t ref;
+        sjson_context_t ctx;
+
+        for (int i = 0; i < count; i++)
+        {
+            ops[i] = (int)(test_rand() % MEMBERS);
+            key_index[i] = (size_t)(test_rand() % (sizeof(names) / sizeof(names[0])));
+        }
+
+        // Same members in a nested object too, so the comma state is per level
+        reference.length = 0;
+        sink.length = 0;
+        sjson_InitObject(&ref, reference_buffer, sizeof(reference_buffer), test_capture, &reference);
+        sjson_InitObject(&ctx, buffer, buffer_size, test_capture, &sink);
+        for (int level = 0; level < 2; level++)
+        {
+            if (level)
+            {
+                sjson_AddObjectToObjectByKey(&ref, &keys[0]);
+                sjson_AddObjectToObjectByKey(&ctx, &keys[0]);
+            }
+            for (int i = 0; i < count; i++)
+            {
+                CHECK(write_member(&ref, ops[i], names[key_index[i]], NULL) == SJSON_OK, "reference op %d", ops[i]);
+                CHECK(write_member(&ctx, ops[i], NULL, &keys[key_index[i]]) == SJSON_OK, "op %d buffer_size=%zu",
+                      ops[i], buffer_size);
+            }
+        }
+        sjson_End(&ref);
+        CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+
+        CHECK(test_sink_equals(&sink, reference.data, reference.length),
+              "buffer_size=%zu:\n  by key %.*s\n  plain  %.*s", buffer_size, (int)sink.length, sink.data,
+              (int)reference.length, reference.data);
+        free(buffer);
+    }
+
+    test_sink_free(&reference);
+    test_sink_free(&sink);
+}
+
+/* Key escaping, spelled out */
+static void test_escaping(void)
+{
+    static const char expected[] = "{\"q\\\"\\\\\\n\\u0001\\u001f/\":1,\"caf\xc3\xa9\":2}";
+    char buffer[64];
+    sjson_key_t key;
+    test_sink_t sink;
+    sjson_context_t ctx;
+
+    test_sink_init(&sink, 256);
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    sjson_KeyInit(&key, names[1]);
+    sjson_AddIntToObjectByKey(&ctx, &key, 1);
+    sjson_KeyInit(&key, names[2]);
+    sjson_AddIntToObjectByKey(&ctx, &key, 2);
+    sjson_End(&ctx);
+    CHECK(test_sink_equals(&sink, expected, strlen(expected)), "%.*s", (int)sink.length, sink.data);
+    test_sink_free(&sink);
+}
+
+/* Longest accepted key, one byte more refused, with and without escapes */
+static void test_key_limits(void)
+{
+    char name[SJSON_KEY_MAX_ENCODED + 1];
+    sjson_key_t key;
+
+    CHECK(sjson_KeyInit(&key, LONGEST_KEY) == SJSON_OK && key.length == SJSON_KEY_MAX_ENCODED, "longest key");
+    CHECK(sjson_KeyInit(&key, LONGEST_KEY "x") == SJSON_ERROR_INVALID_PARAM, "key one byte too long");
+
+    // Escapes count with their encoded size: 58 + "\n" fits, 59 + "\n" does not
+    memset(name, 'a', sizeof(name));
+    name[58] = '\n';
+    name[59] = '\0';
+    CHECK(sjson_KeyInit(&key, name) == SJSON_OK && key.length == SJSON_KEY_MAX_ENCODED, "escape at the end");
+    name[58] = 'a';
+    name[59] = '\n';
+    name[60] = '\0';
+    CHECK(sjson_KeyInit(&key, name) == SJSON_ERROR_INVALID_PARAM, "escape past the end");
+    name[54] = '\x01';
+    name[55] = '\0';
+    CHECK(sjson_KeyInit(&key, name) == SJSON_OK && key.length == SJSON_KEY_MAX_ENCODED, "\\u escape at the end");
+    name[54] = 'a';
+    name[55] = '\x01';
+    name[56] = '\0';
+    CHECK(sjson_KeyInit(&key, name) == SJSON_ERROR_INVALID_PARAM, "\\u escape past the end");
+
+    // Empty names are refused, as by sjson_AddArrayToObject()
+    CHECK(sjson_KeyInit(&key, "") == SJSON_ERROR_INVALID_PARAM, "empty key");
+    CHECK(sjson_KeyInit(&key, NULL) == SJSON_ERROR_INVALID_PARAM, "NULL name");
+    CHECK(sjson_KeyInit(NULL, "k") == SJSON_ERROR_INVALID_PARAM, "NULL key");
+}
+
+static void test_errors(void)
+{
+    char buffer[64];
+    int64_t ints[1] = { 1 };
+    sjson_key_t key;
+    test_sink_t sink;
+    sjson_context_t ctx;
+
+    sjson_KeyInit(&key, "k");
+    test_sink_init(&sink, 256);
+
+    // Only in objects, and not with a NULL handle
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_AddIntToObjectByKey(&ctx, &key, 1) == SJSON_ERROR_INVALID_STATE, "int in array");
+    CHECK(sjson_AddArrayToObjectByKey(&ctx, &key) == SJSON_ERROR_INVALID_STATE, "array in array");
+    CHECK(sjson_AddIntArrayToObjectByKey(&ctx, &key, ints, 1) == SJSON_ERROR_INVALID_STATE, "int array in array");
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_AddIntToObjectByKey(&ctx, NULL, 1) == SJSON_ERROR_INVALID_PARAM, "NULL key handle");
+    CHECK(sjson_AddStringToObjectByKey(&ctx, &key, NULL) == SJSON_ERROR_INVALID_PARAM, "NULL string");
+    CHECK(sjson_AddDecimalToObjectByKey(&ctx, &key, 1, SJSON_DECIMAL_MAX_SCALE + 1) == SJSON_ERROR_INVALID_PARAM,
+          "decimal scale");
+    CHECK(sjson_AddTimestampToObjectByKey(&ctx, &key, 0, 10) == SJSON_ERROR_INVALID_PARAM, "timestamp precision");
+    sjson_End(&ctx);
+    CHECK(sjson_AddIntToObjectByKey(&ctx, &key, 1) == SJSON_ERROR_INVALID_STATE, "after end");
+    test_sink_free(&sink);
+}
+
+int main(void)
+{
+    test_writers();
+    test_escaping();
+    test_key_limits();
+    test_errors();
+    return test_finish("test_keys");
+}
@@ -0,0 +1,156 @@
+/**
+ * @file test_nonblocking.c
+ * @brief Non-blocking output against blocking output
+ *
+ * The sink accepts a random part of each chunk, often nothing. Every call
+ * that returns SJSON_WOULD_BLOCK is repeated until it succeeds; the bytes
+ * accepted must equal the blocking output of the same document.
+ */
+
+#include "test_document.h"
+
+typedef struct {
+    test_sink_t sink;
+    uint64_t seed;
+} partial_sink_t;
+
+static size_t partial_capture(const char *buffer, size_t length, void *user_data)
+{
+    partial_sink_t *partial = (partial_sink_t *)user_data;
+    partial->seed = test_hash(partial->seed + 1);
+
+    // A quarter of the calls accept nothing, the rest a random prefix
+    size_t accepted = (partial->seed % 4 == 0) ? 0 : (size_t)((partial->seed >> 8) % (length + 1));
+    if (!test_sink_append(&partial->sink, buffer, accepted))
+    {
+        return SJSON_SEND_FAILED;
+    }
+    return accepted;
+}
+
+static size_t refuse_all(const char *buffer, size_t length, void *user_data)
+{
+    (void)buffer;
+    (void)length;
+    (void)user_data;
+    return 0;
+}
+
+static void test_documents(void)
+{
+    test_sink_t reference;
+    partial_sink_t partial;
+    size_t would_block = 0;
+    char buffer[1024];
+
+    test_sink_init(&reference, 1 << 20);
+    test_sink_init(&partial.sink, 1 << 20);
+
+    for (uint64_t seed = 1; seed <= 3000; seed++)
+    {
+        size_t buffer_size = 128 + (size_t)(test_hash(seed + 5) % 400);
+        test_document_t doc;
+        sjson_context_t ctx;
+
+        test_document_init(&doc, seed, 200);
+        reference.length = 0;
+        test_document_begin(&doc, &ctx, buffer, buffer_size, test_capture, &reference);
+        CHECK(test_document_write(&doc, &ctx) == SJSON_OK, "reference seed=%llu", (unsigned long long)seed);
+
+        test_document_init(&doc, seed, 200);
+        partial.sink.length = 0;
+        partial.seed = seed;
+        test_document_begin(&doc, &ctx, buffer, buffer_size, test_capture, &partial);
+        CHECK(sjson_SetNonBlockingCallback(&ctx, partial_capture) == SJSON_OK, "set callback");
+
+        int retries = 0;
+        while (doc.next <= doc.steps && retries < 10000)
+        {
+            sjson_status_t status = test_document_step(&doc, &ctx);
+            if (status == SJSON_WOULD_BLOCK)
+            {
+                would_block++;
+                retries++;
+                continue;
+            }
+            CHECK(status == SJSON_OK, "seed=%llu step %d status=%d", (unsigned long long)seed, doc.next, status);
+            if (status != SJSON_OK)
+                break;
+            doc.next++;
+            retries = 0;
+        }
+
+        CHECK(test_sink_equals(&partial.sink, reference.data, reference.length),
+              "seed=%llu buffer_size=%zu: %zu vs %zu bytes", (unsigned long long)seed, buffer_size,
+              partial.sink.length, reference.length);
+        CHECK(sjson_GetByteCount(&ctx) == reference.length, "byte count seed=%llu", (unsigned long long)seed);
+    }
+
+    // Otherwise the retry path was not exercised
+    CHECK(would_block > 1000, "only %zu SJSON_WOULD_BLOCK", would_block);
+
+    test_sink_free(&reference);
+    test_sink_free(&partial.sink);
+}
+
+/* A call larger than the buffer fails without touching the document */
+static void test_too_large(void)
+{
+    char buffer[64];
+    char value[200];
+    partial_sink_t partial;
+    sjson_context_t ctx;
+
+    memset(value, 'x', sizeof(value) - 1);
+    value[sizeof(value) - 1] = '\0';
+    test_sink_init(&partial.sink, 1024);
+    partial.seed = 3;
+
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &partial);
+    sjson_SetNonBlockingCallback(&ctx, partial_capture);
+    CHECK(sjson_AddIntToObject(&ctx, "a", 1) == SJSON_OK, "add");
+
+    // Blocks while earlier bytes are pending, then fails
+    sjson_status_t status;
+    do
+    {
+        status = sjson_AddStringToObject(&ctx, "big", value);
+    } while (status == SJSON_WOULD_BLOCK);
+    CHECK(status == SJSON_ERROR_BUFFER_FULL, "big string status=%d", status);
+
+    do
+    {
+        status = sjson_End(&ctx);
+    } while (status == SJSON_WOULD_BLOCK);
+    CHECK(status == SJSON_OK, "end status=%d", status);
+    CHECK(test_sink_equals(&partial.sink, "{\"a\":1}", 7), "after failed call: %.*s",
+          (int)partial.sink.length, partial.sink.data);
+
+    test_sink_free(&partial.sink);
+}
+
+/* A sink that never accepts anything keeps returning SJSON_WOULD_BLOCK */
+static void test_stalled(void)
+{
+    char buffer[32];
+    sjson_context_t ctx;
+
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, NULL);
+    sjson_SetNonBlockingCallback(&ctx, refuse_all);
+
+    int added = 0;
+    while (added < 100 && sjson_AddIntToArray(&ctx, 123456) == SJSON_OK)
+        added++;
+    CHECK(added > 0 && added < 100, "added %d before blocking", added);
+    CHECK(sjson_AddIntToArray(&ctx, 123456) == SJSON_WOULD_BLOCK, "still blocked");
+    CHECK(sjson_End(&ctx) == SJSON_WOULD_BLOCK, "end blocked");
+}
+
+int main(void)
+{
+    test_document_setup();
+    test_documents();
+    test_too_large();
+    test_stalled();
+    return test_finish("test_nonblocking");
+}
@@ -0,0 +1,201 @@
+/**
+ * @file test_passthrough.c
+ * @brief Values at least as large as the buffer reach the callback uncopied
+ *
+ * In plain callback mode a raw value or clean string run of buffer_size
+ * bytes or more is handed to the callback straight from the caller's
+ * memory: the buffered bytes go first, then the value in one call. Smaller
+ * values, non-blocking mode and failing sinks keep the copying path.
+ */
+
+#include "test_util.h"
+
+#define BUFFER_SIZE 64
+#define MAX_CALLS 16
+
+/* Records every callback, and whether it pointed into the caller's value */
+typedef struct {
+    test_sink_t sink;
+    const char *pointers[MAX_CALLS];
+    size_t lengths[MAX_CALLS];
+} recording_sink_t;
+
+static bool record(const char *buffer, size_t length, void *user_data)
+{
+    recording_sink_t *rec = (recording_sink_t *)user_data;
+    if (rec->sink.calls < MAX_CALLS)
+    {
+        rec->pointers[rec->sink.calls] = buffer;
+        rec->lengths[rec->sink.calls] = length;
+    }
+    return test_capture(buffer, length, user_data);
+}
+
+static void recording_init(recording_sink_t *rec)
+{
+    test_sink_init(&rec->sink, 1 << 16);
+}
+
+static void recording_reset(recording_sink_t *rec)
+{
+    rec->sink.length = 0;
+    rec->sink.calls = 0;
+}
+
+/* Number of callbacks that pointed into value[0..length) */
+static size_t calls_into(const recording_sink_t *rec, const char *value, size_t length)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < rec->sink.calls && i < MAX_CALLS; i++)
+    {
+        if (rec->pointers[i] >= value && rec->pointers[i] < value + length)
+            n++;
+    }
+    return n;
+}
+
+/* {"k":raw} with raw of every length around the buffer size */
+static void test_raw(void)
+{
+    static char value[4 * BUFFER_SIZE + 1];
+    char buffer[BUFFER_SIZE];
+    char expected[sizeof(value) + 8];
+    recording_sink_t rec;
+    sjson_context_t ctx;
+
+    recording_init(&rec);
+    for (size_t length = BUFFER_SIZE - 8; length < sizeof(value); length++)
+    {
+        memset(value, '1', length);
+        value[length] = '\0';
+
+        recording_reset(&rec);
+        sjson_InitObject(&ctx, buffer, sizeof(buffer), record, &rec);
+        CHECK(sjson_AddRawToObject(&ctx, "k", value) == SJSON_OK, "raw %zu", length);
+        size_t calls = rec.sink.calls;
+        CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+
+        size_t n = (size_t)sprintf(expected, "{\"k\":%s}", value);
+        CHECK(test_sink_equals(&rec.sink, expected, n), "raw %zu: %.*s", length, (int)rec.sink.length,
+              rec.sink.data);
+
+        if (length >= BUFFER_SIZE)
+        {
+            // {"k": then the value itself, then } on End
+            CHECK(calls == 2 && rec.pointers[1] == value && rec.lengths[1] == length,
+                  "raw %zu: %zu calls, second %p/%zu, value %p", length, calls, (void *)rec.pointers[1],
+                  rec.lengths[1], (void *)value);
+            CHECK(rec.pointers[0] == buffer && rec.lengths[0] == 5, "raw %zu: buffered key first", length);
+        }
+        else
+        {
+            CHECK(calls_into(&rec, value, length) == 0, "raw %zu passed through", length);
+        }
+    }
+    test_sink_free(&rec.sink);
+}
+
+/* A long clean run inside a string is passed through, escapes are copied */
+static void test_string(void)
+{
+    static char value[10000 + 1];
+    char buffer[BUFFER_SIZE];
+    char expected[sizeof(value) + 16];
+    recording_sink_t rec;
+    sjson_context_t ctx;
+
+    memset(value, 'a', sizeof(value) - 1);
+    value[sizeof(value) - 1] = '\0';
+
+    recording_init(&rec);
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), record, &rec);
+    CHECK(sjson_AddStringToArray(&ctx, value) == SJSON_OK, "string");
+    CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+    size_t n = (size_t)sprintf(expected, "[\"%s\"]", value);
+    CHECK(test_sink_equals(&rec.sink, expected, n), "long string");
+    CHECK(rec.sink.calls == 3 && rec.pointers[1] == value && rec.lengths[1] == sizeof(value) - 1,
+          "long string: %zu calls", rec.sink.calls);
+
+    // An escape splits the run; both halves are still larger than the buffer
+    value[5000] = '\n';
+    recording_reset(&rec);
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), record, &rec);
+    sjson_AddStringToArray(&ctx, value);
+    sjson_End(&ctx);
+    n = (size_t)sprintf(expected, "[\"%.5000s\\n%s\"]", value, value + 5001);
+    CHECK(test_sink_equals(&rec.sink, expected, n), "split string");
+    CHECK(calls_into(&rec, value, sizeof(value)) == 2 && rec.pointers[1] == value && rec.lengths[1] == 5000,
+          "split string: %zu calls into the value", calls_into(&rec, value, sizeof(value)));
+    test_sink_free(&rec.sink);
+}
+
+/* The framer wraps the passed-through value in the same frame */
+static void test_framed(void)
+{
+    static char value[3 * BUFFER_SIZE + 1];
+    char buffer[128];
+    char expected[sizeof(value) + 8];
+    recording_sink_t rec;
+    sjson_context_t ctx;
+
+    memset(value, '2', sizeof(value) - 1);
+    value[sizeof(value) - 1] = '\0';
+
+    recording_init(&rec);
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), record, &rec);
+    CHECK(sjson_SetFramer(&ctx, &sjson_framer_chunked) == SJSON_OK, "framer");
+    CHECK(sjson_AddRawToObject(&ctx, "k", value) == SJSON_OK, "raw");
+    CHECK(calls_into(&rec, value, sizeof(value)) == 1, "framed raw not passed through");
+    CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+
+    size_t n = (size_t)sprintf(expected, "{\"k\":%s}", value);
+    size_t length = test_dechunk(rec.sink.data, rec.sink.length);
+    CHECK(length == n && memcmp(rec.sink.data, expected, n) == 0, "framed raw: %zu bytes", length);
+    test_sink_free(&rec.sink);
+}
+
+static size_t accept_all(const char *buffer, size_t length, void *user_data)
+{
+    return test_sink_append((test_sink_t *)user_data, buffer, length) ? length : SJSON_SEND_FAILED;
+}
+
+static bool failing_send(const char *buffer, size_t length, void *user_data)
+{
+    (void)buffer;
+    (void)length;
+    (void)user_data;
+    return false;
+}
+
+/* Non-blocking mode copies (and so refuses) values larger than the buffer */
+static void test_other_modes(void)
+{
+    static char value[2 * BUFFER_SIZE + 1];
+    char buffer[BUFFER_SIZE];
+    test_sink_t sink;
+    sjson_context_t ctx;
+
+    memset(value, '3', sizeof(value) - 1);
+    value[sizeof(value) - 1] = '\0';
+
+    test_sink_init(&sink, 1024);
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    sjson_SetNonBlockingCallback(&ctx, accept_all);
+    CHECK(sjson_AddRawToObject(&ctx, "k", value) == SJSON_ERROR_BUFFER_FULL, "non-blocking raw");
+    CHECK(sjson_AddIntToObject(&ctx, "i", 1) == SJSON_OK, "non-blocking int after refusal");
+    CHECK(sjson_End(&ctx) == SJSON_OK, "non-blocking end");
+    CHECK(test_sink_equals(&sink, "{\"i\":1}", 7), "%.*s", (int)sink.length, sink.data);
+
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), failing_send, NULL);
+    CHECK(sjson_AddRawToObject(&ctx, "k", value) == SJSON_ERROR_BUFFER_FULL, "failing sink");
+    test_sink_free(&sink);
+}
+
+int main(void)
+{
+    test_raw();
+    test_string();
+    test_framed();
+    test_other_modes();
+    return test_finish("test_passthrough");
+}
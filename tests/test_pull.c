@@ -0,0 +1,73 @@
+/**
+ * @file test_pull.c
+ * @brief Pull mode output against blocking output
+ *
+ * The document steps run as the producer; chunks pulled with random
+ * capacities must join up to the blocking output of the same document.
+ */
+
+#include "test_document.h"
+
+/* Producer: one document step per call, advancing only on success */
+static sjson_status_t produce(sjson_context_t *ctx, void *state)
+{
+    test_document_t *doc = (test_document_t *)state;
+    sjson_status_t status = test_document_step(doc, ctx);
+    if (status == SJSON_OK)
+    {
+        doc->next++;
+    }
+    return status;
+}
+
+int main(void)
+{
+    test_sink_t reference, pulled;
+    char buffer[512];
+
+    test_document_setup();
+    test_sink_init(&reference, 1 << 20);
+    test_sink_init(&pulled, 1 << 20);
+
+    for (uint64_t seed = 1; seed <= 3000; seed++)
+    {
+        test_document_t doc;
+        sjson_context_t ctx;
+
+        test_document_init(&doc, seed, 200);
+        reference.length = 0;
+        test_document_begin(&doc, &ctx, buffer, 128 + (size_t)(test_hash(seed + 5) % 384),
+                            test_capture, &reference);
+        CHECK(test_document_write(&doc, &ctx) == SJSON_OK, "reference seed=%llu", (unsigned long long)seed);
+
+        test_document_init(&doc, seed, 200);
+        pulled.length = 0;
+        CHECK((test_document_is_object(&doc) ? sjson_InitPullObject(&ctx, produce, &doc)
+                                             : sjson_InitPullArray(&ctx, produce, &doc)) == SJSON_OK,
+              "init pull");
+
+        for (int chunk = 0; chunk < 100000; chunk++)
+        {
+            size_t capacity = 64 + (size_t)(test_hash(seed * 7 + (uint64_t)chunk) % 448);
+            size_t length = 0;
+            sjson_status_t status = sjson_Pull(&ctx, buffer, capacity, &length);
+            CHECK(status == SJSON_OK, "seed=%llu pull status=%d", (unsigned long long)seed, status);
+            CHECK(length <= capacity, "chunk of %zu bytes into %zu", length, capacity);
+            if (status != SJSON_OK || length == 0)
+                break;
+            CHECK(test_sink_append(&pulled, buffer, length), "sink");
+        }
+
+        CHECK(test_sink_equals(&pulled, reference.data, reference.length),
+              "seed=%llu: %zu vs %zu bytes", (unsigned long long)seed, pulled.length, reference.length);
+
+        // A finished document keeps returning empty chunks
+        size_t length = 1;
+        CHECK(sjson_Pull(&ctx, buffer, sizeof(buffer), &length) == SJSON_OK && length == 0,
+              "pull after end");
+    }
+
+    test_sink_free(&reference);
+    test_sink_free(&pulled);
+    return test_finish("test_pull");
+}
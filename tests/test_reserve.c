@@ -0,0 +1,193 @@
+/**
+ * @file test_reserve.c
+ * @brief Custom values through BeginValue + sjson_Reserve()/sjson_Commit()
+ *
+ * Values written with plain stores into reserved space, often reserving
+ * more than is committed, must give the same bytes as the raw and string
+ * writers, with buffer sizes down to the largest single reservation. A
+ * reservation larger than the buffer fails without touching the document.
+ */
+
+#include "test_util.h"
+
+#define MAX_VALUE 120
+
+static sjson_key_t key_b;
+
+/* A quoted run of letters, 2..MAX_VALUE bytes with the quotes */
+static size_t make_value(char *value)
+{
+    size_t length = 2 + (size_t)(test_rand() % (MAX_VALUE - 1));
+    value[0] = '"';
+    for (size_t i = 1; i < length - 1; i++)
+        value[i] = (char)('a' + test_rand() % 26);
+    value[length - 1] = '"';
+    value[length] = '\0';
+    return length;
+}
+
+/* Stores the value into reserved space, sometimes reserving extra */
+static sjson_status_t put_value(sjson_context_t *ctx, const char *value, size_t length)
+{
+    size_t n = length;
+    if (test_rand() & 1)
+        n += (size_t)(test_rand() % 8);
+    if (n > ctx->buffer_size)
+        n = length;
+
+    char *p = sjson_Reserve(ctx, n);
+    if (!p)
+        return SJSON_ERROR_BUFFER_FULL;
+    memcpy(p, value, length);
+    sjson_Commit(ctx, length);
+    return SJSON_OK;
+}
+
+static void test_values(void)
+{
+    static char reference_buffer[1 << 14];
+    char value[MAX_VALUE + 1];
+    test_sink_t reference;
+    test_sink_t sink;
+
+    test_sink_init(&reference, 1 << 16);
+    test_sink_init(&sink, 1 << 16);
+
+    for (int iter = 0; iter < 5000; iter++)
+    {
+        size_t buffer_size = MAX_VALUE + 8 + (size_t)(test_rand() % 300);
+        char *buffer = malloc(buffer_size);
+        int count = (int)(test_rand() % 20);
+        sjson_context_t ref;
+        sjson_context_t ctx;
+
+        // {"a":v,"b":v,...,"l":[v,v,...]}
+        reference.length = 0;
+        sink.length = 0;
+        sjson_InitObject(&ref, reference_buffer, sizeof(reference_buffer), test_capture, &reference);
+        sjson_InitObject(&ctx, buffer, buffer_size, test_capture, &sink);
+
+        for (int i = 0; i < count; i++)
+        {
+            size_t length = make_value(value);
+            if (i & 1)
+            {
+                sjson_AddRawToObjectByKey(&ref, &key_b, value);
+                CHECK(sjson_BeginValueInObjectByKey(&ctx, &key_b) == SJSON_OK, "begin by key");
+            }
+            else
+            {
+                sjson_AddRawToObject(&ref, "a", value);
+                CHECK(sjson_BeginValueInObject(&ctx, "a") == SJSON_OK, "begin in object");
+            }
+            CHECK(put_value(&ctx, value, length) == SJSON_OK, "reserve %zu of %zu", length, buffer_size);
+        }
+
+        sjson_AddArrayToObject(&ref, "l");
+        sjson_AddArrayToObject(&ctx, "l");
+        for (int i = 0; i < count; i++)
+        {
+            size_t length = make_value(value);
+            value[length - 1] = '\0';
+            sjson_AddStringToArray(&ref, value + 1);
+            value[length - 1] = '"';
+            CHECK(sjson_BeginValueInArray(&ctx) == SJSON_OK, "begin in array");
+            CHECK(put_value(&ctx, value, length) == SJSON_OK, "reserve %zu of %zu", length, buffer_size);
+        }
+        sjson_End(&ref);
+        CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+
+        CHECK(test_sink_equals(&sink, reference.data, reference.length),
+              "buffer_size=%zu:\n  got      %.*s\n  expected %.*s", buffer_size, (int)sink.length, sink.data,
+              (int)reference.length, reference.data);
+        free(buffer);
+    }
+
+    test_sink_free(&reference);
+    test_sink_free(&sink);
+}
+
+/* The fast path stays in the buffer, the slow path flushes once */
+static void test_reserve_paths(void)
+{
+    char buffer[32];
+    test_sink_t sink;
+    sjson_context_t ctx;
+
+    test_sink_init(&sink, 256);
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+
+    // "[" is buffered, 31 bytes left
+    CHECK(sjson_BeginValueInArray(&ctx) == SJSON_OK, "begin");
+    char *p = sjson_Reserve(&ctx, 31);
+    CHECK(p == buffer + 1 && sink.calls == 0, "fast path: %p %zu calls", (void *)p, sink.calls);
+    memcpy(p, "1", 1);
+    sjson_Commit(&ctx, 1);
+
+    // Does not fit behind "[1": flushed, then the whole buffer is free
+    CHECK(sjson_BeginValueInArray(&ctx) == SJSON_OK, "begin");
+    p = sjson_Reserve(&ctx, sizeof(buffer));
+    CHECK(p == buffer && sink.calls == 1 && test_sink_equals(&sink, "[1,", 3), "slow path: %zu calls %.*s",
+          sink.calls, (int)sink.length, sink.data);
+    memset(p, '2', sizeof(buffer));
+    sjson_Commit(&ctx, sizeof(buffer));
+
+    // Larger than the buffer: NULL, nothing sent or buffered
+    CHECK(sjson_BeginValueInArray(&ctx) == SJSON_OK, "begin");
+    size_t used = ctx.used;
+    size_t calls = sink.calls;
+    CHECK(sjson_Reserve(&ctx, sizeof(buffer) + 1) == NULL, "reserve above buffer size");
+    CHECK(sjson_ReserveSlow(&ctx, sizeof(buffer) + 1) == NULL, "slow reserve above buffer size");
+    CHECK(ctx.used == used && sink.calls == calls, "failed reserve changed state");
+    p = sjson_Reserve(&ctx, 1);
+    p[0] = '3';
+    sjson_Commit(&ctx, 1);
+    CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+    CHECK(test_sink_equals(&sink, "[1,22222222222222222222222222222222,3]", 38), "%.*s", (int)sink.length,
+          sink.data);
+    test_sink_free(&sink);
+}
+
+static bool failing_send(const char *buffer, size_t length, void *user_data)
+{
+    (void)buffer;
+    (void)length;
+    (void)user_data;
+    return false;
+}
+
+static void test_errors(void)
+{
+    char buffer[16];
+    test_sink_t sink;
+    sjson_context_t ctx;
+
+    test_sink_init(&sink, 64);
+
+    // The flush behind a slow reserve fails
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), failing_send, NULL);
+    sjson_BeginValueInArray(&ctx);
+    CHECK(sjson_Reserve(&ctx, 8) != NULL, "reserve without flush");
+    CHECK(sjson_Reserve(&ctx, sizeof(buffer)) == NULL, "reserve with failing flush");
+
+    // Begin in the wrong container, or without a key
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_BeginValueInArray(&ctx) == SJSON_ERROR_INVALID_STATE, "array begin in object");
+    CHECK(sjson_BeginValueInObject(&ctx, NULL) == SJSON_ERROR_INVALID_PARAM, "NULL key");
+    CHECK(sjson_BeginValueInObjectByKey(&ctx, NULL) == SJSON_ERROR_INVALID_PARAM, "NULL key handle");
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_BeginValueInObject(&ctx, "k") == SJSON_ERROR_INVALID_STATE, "object begin in array");
+    CHECK(sjson_BeginValueInObjectByKey(&ctx, &key_b) == SJSON_ERROR_INVALID_STATE, "by key in array");
+    sjson_End(&ctx);
+    CHECK(sjson_BeginValueInArray(&ctx) == SJSON_ERROR_INVALID_STATE, "begin after end");
+    test_sink_free(&sink);
+}
+
+int main(void)
+{
+    sjson_KeyInit(&key_b, "b");
+    test_values();
+    test_reserve_paths();
+    test_errors();
+    return test_finish("test_reserve");
+}
@@ -0,0 +1,358 @@
+/**
+ * @file test_streams.c
+ * @brief Streamed values against AddString/AddBase64/AddRaw
+ *
+ * Random and escape-heavy data is read in random short pieces into
+ * buffers of several sizes, plain, framed and through the ring, and must
+ * give the same document as the value added in one call. Also checks the
+ * smallest buffer each framer accepts and the refused modes.
+ */
+
+#include "test_util.h"
+#ifdef SJSON_TEST_RING
+#include "stream_json_ring.h"
+#endif
+
+#define MAX_DATA 4000
+
+typedef struct {
+    const char *data;
+    size_t length;
+    size_t pos;
+    size_t max_read;   /* Longest piece handed out per call */
+    size_t reads;
+} source_t;
+
+/* sjson_read_callback_t over memory, in random short pieces */
+static size_t source_read(char *buffer, size_t capacity, void *state)
+{
+    source_t *src = (source_t *)state;
+    size_t n = 1 + (size_t)(test_rand() % src->max_read);
+
+    CHECK(capacity > 0, "read with zero capacity");
+    if (n > capacity)
+        n = capacity;
+    if (n > src->length - src->pos)
+        n = src->length - src->pos;
+    memcpy(buffer, src->data + src->pos, n);
+    src->pos += n;
+    src->reads++;
+    return n;
+}
+
+static size_t failing_read(char *buffer, size_t capacity, void *state)
+{
+    (void)buffer;
+    (void)capacity;
+    (void)state;
+    return SJSON_READ_FAILED;
+}
+
+/* Claims more than it was given room for */
+static size_t overlong_read(char *buffer, size_t capacity, void *state)
+{
+    (void)buffer;
+    (void)state;
+    return capacity + 1;
+}
+
+static size_t refuse_partial(const char *buffer, size_t length, void *user_data)
+{
+    (void)buffer;
+    (void)length;
+    (void)user_data;
+    return 0;
+}
+
+/* Random bytes, escape-heavy text, or plain text; no NUL so AddString can compare */
+static size_t make_data(char *data, sjson_encoding_t encoding)
+{
+    static const char heavy[] = "\"\\\n\r\t\b\f\x01\x1f\x7f/a \xc3\xa9\xe2\x82\xac";
+    size_t length = (size_t)(test_rand() % MAX_DATA);
+    int kind = (int)(test_rand() % 3);
+
+    if (test_rand() % 8 == 0)
+        length = (size_t)(test_rand() % 8);
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if (encoding == SJSON_ENCODING_BASE64)
+            data[i] = (char)test_rand();
+        else if (kind == 0)
+            data[i] = (char)(1 + test_rand() % 255);
+        else if (kind == 1)
+            data[i] = heavy[test_rand() % (sizeof(heavy) - 1)];
+        else
+            data[i] = (char)('a' + test_rand() % 26);
+    }
+    data[length] = '\0';
+    return length;
+}
+
+static sjson_status_t add_reference(sjson_context_t *ctx, const char *key, const char *data, size_t length,
+                                    sjson_encoding_t encoding)
+{
+    if (encoding == SJSON_ENCODING_BASE64)
+        return key ? sjson_AddBase64ToObject(ctx, key, data, length) : sjson_AddBase64ToArray(ctx, data, length);
+    if (encoding == SJSON_ENCODING_RAW && key)
+        return sjson_AddRawToObject(ctx, key, data);
+    if (encoding == SJSON_ENCODING_RAW)
+    {
+        // No AddRawToArray, the raw bytes go in through Reserve/Commit
+        sjson_status_t status = sjson_BeginValueInArray(ctx);
+        char *p = (status == SJSON_OK && length > 0) ? sjson_Reserve(ctx, length) : NULL;
+        if (p)
+        {
+            memcpy(p, data, length);
+            sjson_Commit(ctx, length);
+        }
+        return (status == SJSON_OK && length > 0 && !p) ? SJSON_ERROR_BUFFER_FULL : status;
+    }
+    return key ? sjson_AddStringToObject(ctx, key, data) : sjson_AddStringToArray(ctx, data);
+}
+
+/* {"a":1,"v":<data>,"k":<data>,"l":[2,<data>]} */
+static void write_document(sjson_context_t *ctx, const char *data, size_t length, sjson_encoding_t encoding,
+                           size_t max_read, bool streamed)
+{
+    static sjson_key_t key_k;
+    static bool key_ready;
+    source_t src;
+
+    if (!key_ready)
+    {
+        CHECK(sjson_KeyInit(&key_k, "k") == SJSON_OK, "key");
+        key_ready = true;
+    }
+
+    CHECK(sjson_AddIntToObject(ctx, "a", 1) == SJSON_OK, "int");
+    for (int i = 0; i < 3; i++)
+    {
+        if (i == 2)
+        {
+            CHECK(sjson_AddArrayToObject(ctx, "l") == SJSON_OK, "array");
+            CHECK(sjson_AddIntToArray(ctx, 2) == SJSON_OK, "int in array");
+        }
+
+        sjson_status_t status;
+        src.data = data;
+        src.length = length;
+        src.pos = 0;
+        src.max_read = max_read;
+        src.reads = 0;
+
+        if (!streamed)
+            status = add_reference(ctx, (i == 2) ? NULL : (i == 0) ? "v" : "k", data, length, encoding);
+        else if (i == 0)
+            status = sjson_AddStreamToObject(ctx, "v", source_read, &src, encoding);
+        else if (i == 1)
+            status = sjson_AddStreamToObjectByKey(ctx, &key_k, source_read, &src, encoding);
+        else
+            status = sjson_AddStreamToArray(ctx, source_read, &src, encoding);
+
+        CHECK(status == SJSON_OK, "value %d encoding %d: status %d", i, (int)encoding, (int)status);
+        CHECK(!streamed || src.pos == length, "stream stopped at %zu of %zu", src.pos, length);
+    }
+    CHECK(sjson_End(ctx) == SJSON_OK, "end");
+}
+
+static void test_against_reference(void)
+{
+    static char data[MAX_DATA + 1];
+    static char reference_buffer[2 * MAX_DATA];
+    char buffer[1024];
+    test_sink_t reference, streamed;
+
+    test_sink_init(&reference, 1 << 20);
+    test_sink_init(&streamed, 1 << 20);
+
+    for (int iter = 0; iter < 6000; iter++)
+    {
+        sjson_encoding_t encoding = (sjson_encoding_t)(test_rand() % 3);
+        bool framed = (iter % 3) == 1;
+        const sjson_framer_t *framer = &sjson_framer_chunked;
+        size_t minimum = SJSON_STREAM_MIN_SPACE;
+        size_t buffer_size;
+        size_t max_read = 1 + (size_t)(test_rand() % ((test_rand() & 1) ? 16 : 2000));
+        size_t length = make_data(data, encoding);
+        sjson_context_t ctx;
+
+        if (framed)
+            minimum = framer->headroom + 2 * framer->tailroom + SJSON_STREAM_MIN_SPACE;
+        buffer_size = minimum + (size_t)(test_rand() % (sizeof(buffer) - minimum + 1));
+        if (test_rand() % 4 == 0)
+            buffer_size = minimum + (size_t)(test_rand() % 8);
+
+        reference.length = 0;
+        sjson_InitObject(&ctx, reference_buffer, sizeof(reference_buffer), test_capture, &reference);
+        write_document(&ctx, data, length, encoding, max_read, false);
+
+        streamed.length = 0;
+        sjson_InitObject(&ctx, buffer, buffer_size, test_capture, &streamed);
+        if (framed)
+            CHECK(sjson_SetFramer(&ctx, framer) == SJSON_OK, "set framer");
+        write_document(&ctx, data, length, encoding, max_read, true);
+        CHECK(sjson_GetByteCount(&ctx) == reference.length, "byte count %zu vs %zu",
+              sjson_GetByteCount(&ctx), reference.length);
+
+        if (framed)
+        {
+            size_t payload = test_dechunk(streamed.data, streamed.length);
+            CHECK(payload != (size_t)-1, "iter %d: malformed chunks", iter);
+            streamed.length = (payload == (size_t)-1) ? 0 : payload;
+        }
+
+        CHECK(test_sink_equals(&streamed, reference.data, reference.length),
+              "iter %d encoding %d buffer_size=%zu framed=%d max_read=%zu length=%zu:\n"
+              "  streamed  %.*s\n  reference %.*s",
+              iter, (int)encoding, buffer_size, (int)framed, max_read, length,
+              (int)streamed.length, streamed.data, (int)reference.length, reference.data);
+    }
+
+    test_sink_free(&reference);
+    test_sink_free(&streamed);
+}
+
+#ifdef SJSON_TEST_RING
+static void test_ring(void)
+{
+    static char data[MAX_DATA + 1];
+    static char memory[3 * 512];
+    static char buffer[2 * MAX_DATA];
+    test_sink_t reference, streamed;
+
+    test_sink_init(&reference, 1 << 20);
+    test_sink_init(&streamed, 1 << 20);
+
+    for (size_t buffer_size = SJSON_STREAM_MIN_SPACE; buffer_size <= 512; buffer_size *= 2)
+    {
+        sjson_ring_t ring;
+        CHECK(sjson_RingStart(&ring, memory, buffer_size, 3, test_capture, &streamed) == SJSON_OK,
+              "ring start %zu", buffer_size);
+
+        for (int iter = 0; iter < 300; iter++)
+        {
+            sjson_encoding_t encoding = (sjson_encoding_t)(test_rand() % 3);
+            size_t max_read = 1 + (size_t)(test_rand() % 300);
+            size_t length = make_data(data, encoding);
+            sjson_context_t ctx;
+
+            reference.length = 0;
+            sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &reference);
+            write_document(&ctx, data, length, encoding, max_read, false);
+
+            // The sink is only read after sjson_End() has waited for the sender
+            streamed.length = 0;
+            sjson_RingInitObject(&ctx, &ring);
+            write_document(&ctx, data, length, encoding, max_read, true);
+
+            CHECK(test_sink_equals(&streamed, reference.data, reference.length),
+                  "ring buffer_size=%zu iter %d encoding %d: %zu vs %zu bytes", buffer_size, iter,
+                  (int)encoding, streamed.length, reference.length);
+        }
+
+        CHECK(sjson_RingStop(&ring) == SJSON_OK, "ring stop");
+    }
+
+    test_sink_free(&reference);
+    test_sink_free(&streamed);
+}
+#endif
+
+/* Framed buffers need headroom + 2 * tailroom + SJSON_STREAM_MIN_SPACE bytes */
+static void test_minimum_size(void)
+{
+    static const sjson_framer_t *const framers[] = {
+        &sjson_framer_chunked, &sjson_framer_websocket, &sjson_framer_length_prefix
+    };
+    char buffer[256];
+    test_sink_t sink;
+    source_t src;
+
+    test_sink_init(&sink, 1 << 12);
+
+    for (size_t f = 0; f < sizeof(framers) / sizeof(framers[0]); f++)
+    {
+        const sjson_framer_t *framer = framers[f];
+        size_t minimum = framer->headroom + 2 * framer->tailroom + SJSON_STREAM_MIN_SPACE;
+
+        for (size_t size = minimum - 8; size <= minimum; size++)
+        {
+            sjson_context_t ctx;
+            sjson_status_t expected = (size < minimum) ? SJSON_ERROR_INVALID_PARAM : SJSON_OK;
+
+            src.data = "text";
+            src.length = 4;
+            src.pos = 0;
+            src.max_read = 4;
+            sink.length = 0;
+            sjson_InitArray(&ctx, buffer, size, test_capture, &sink);
+            CHECK(sjson_SetFramer(&ctx, framer) == SJSON_OK, "set framer");
+            CHECK(sjson_AddStreamToArray(&ctx, source_read, &src, SJSON_ENCODING_STRING) == expected,
+                  "framer %zu buffer %zu (minimum %zu)", f, size, minimum);
+
+            // Other values still fit
+            CHECK(sjson_AddStringToArray(&ctx, "text") == SJSON_OK, "string framer %zu buffer %zu", f, size);
+            CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+        }
+    }
+
+    // The example from the documentation: 88 bytes is too small for chunked
+    sjson_context_t ctx;
+    sink.length = 0;
+    sjson_InitObject(&ctx, buffer, 88, test_capture, &sink);
+    sjson_SetFramer(&ctx, &sjson_framer_chunked);
+    src.pos = 0;
+    CHECK(sjson_AddStreamToObject(&ctx, "v", source_read, &src, SJSON_ENCODING_BASE64) ==
+          SJSON_ERROR_INVALID_PARAM, "88-byte chunked buffer");
+
+    // Unframed, SJSON_STREAM_MIN_SPACE is enough
+    sjson_InitObject(&ctx, buffer, SJSON_STREAM_MIN_SPACE - 1, test_capture, &sink);
+    CHECK(sjson_AddStreamToObject(&ctx, "v", source_read, &src, SJSON_ENCODING_RAW) ==
+          SJSON_ERROR_INVALID_PARAM, "buffer below minimum");
+
+    test_sink_free(&sink);
+}
+
+static void test_errors(void)
+{
+    char buffer[256];
+    test_sink_t sink;
+    sjson_context_t ctx;
+    source_t src = { "abc", 3, 0, 3, 0 };
+
+    test_sink_init(&sink, 1 << 12);
+
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_AddStreamToArray(&ctx, failing_read, NULL, SJSON_ENCODING_STRING) == SJSON_ERROR_BUFFER_FULL,
+          "reader failed");
+
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_AddStreamToArray(&ctx, overlong_read, NULL, SJSON_ENCODING_BASE64) == SJSON_ERROR_BUFFER_FULL,
+          "reader overran capacity");
+
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_AddStreamToArray(&ctx, source_read, &src, (sjson_encoding_t)7) == SJSON_ERROR_INVALID_PARAM,
+          "unknown encoding");
+    CHECK(src.reads == 0, "read before the encoding was checked");
+
+    // A read cannot be undone, so no non-blocking mode
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    sjson_SetNonBlockingCallback(&ctx, refuse_partial);
+    CHECK(sjson_AddStreamToArray(&ctx, source_read, &src, SJSON_ENCODING_STRING) == SJSON_ERROR_INVALID_STATE,
+          "non-blocking");
+    CHECK(src.reads == 0, "read in non-blocking mode");
+
+    test_sink_free(&sink);
+}
+
+int main(void)
+{
+    test_against_reference();
+#ifdef SJSON_TEST_RING
+    test_ring();
+#endif
+    test_minimum_size();
+    test_errors();
+    return test_finish("test_streams");
+}
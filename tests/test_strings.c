@@ -0,0 +1,257 @@
+/**
+ * @file test_strings.c
+ * @brief Incremental strings (BeginString/AppendString/EndString)
+ *
+ * A string appended in random pieces, down to single bytes so that escape
+ * sequences and UTF-8 sequences are split across calls, must give the same
+ * bytes as sjson_AddStringToObject(), blocking and non-blocking. While a
+ * string is open every other writer must be refused.
+ */
+
+#include "test_util.h"
+
+#define MAX_TEXT 3000
+
+static sjson_key_t key_k;
+static size_t would_block;
+
+typedef struct {
+    test_sink_t sink;
+    uint64_t seed;
+} partial_sink_t;
+
+/* Accepts a random prefix, often nothing */
+static size_t partial_capture(const char *buffer, size_t length, void *user_data)
+{
+    partial_sink_t *partial = (partial_sink_t *)user_data;
+    partial->seed = partial->seed * 6364136223846793005ull + 1442695040888963407ull;
+
+    size_t accepted = ((partial->seed >> 33) % 3 == 0) ? 0 : (size_t)((partial->seed >> 20) % (length + 1));
+    if (!test_sink_append(&partial->sink, buffer, accepted))
+    {
+        return SJSON_SEND_FAILED;
+    }
+    return accepted;
+}
+
+static size_t make_text(char *text)
+{
+    static const char heavy[] = "\"\\\n\r\t\b\f\x01\x1f\x7f/ a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80";
+    size_t length = (size_t)(test_rand() % MAX_TEXT);
+    int kind = (int)(test_rand() % 3);
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if (kind == 0)
+            text[i] = (char)(1 + test_rand() % 255);
+        else if (kind == 1)
+            text[i] = heavy[test_rand() % (sizeof(heavy) - 1)];
+        else
+            text[i] = (char)('a' + test_rand() % 26);
+    }
+    text[length] = '\0';
+    return length;
+}
+
+/* Repeats a call while it returns SJSON_WOULD_BLOCK */
+#define RETRY(status, call)                                            \
+    do                                                                 \
+    {                                                                  \
+        int tries_ = 0;                                                \
+        do                                                             \
+        {                                                              \
+            status = (call);                                           \
+            would_block += (status == SJSON_WOULD_BLOCK);              \
+        } while (status == SJSON_WOULD_BLOCK && ++tries_ < 100000);    \
+    } while (0)
+
+/* Appends text in random pieces of at most max_piece bytes, some empty */
+static sjson_status_t append_pieces(sjson_context_t *ctx, const char *text, size_t length, size_t max_piece)
+{
+    size_t pos = 0;
+    while (pos < length)
+    {
+        size_t n = (size_t)(test_rand() % (max_piece + 1));
+        if (n > length - pos)
+            n = length - pos;
+
+        sjson_status_t status;
+        RETRY(status, sjson_AppendString(ctx, text + pos, n));
+        if (status != SJSON_OK)
+            return status;
+        pos += n;
+    }
+    return SJSON_OK;
+}
+
+/* {"v":text,"k":text,"l":[text]}, in one call per value or in pieces */
+static void write_document(sjson_context_t *ctx, const char *text, size_t length, size_t max_piece,
+                           bool pieces)
+{
+    sjson_status_t status;
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (i == 2)
+        {
+            RETRY(status, sjson_AddArrayToObject(ctx, "l"));
+            CHECK(status == SJSON_OK, "array");
+        }
+
+        if (!pieces)
+        {
+            if (i == 2)
+                RETRY(status, sjson_AddStringToArray(ctx, text));
+            else
+                RETRY(status, sjson_AddStringToObject(ctx, i ? "k" : "v", text));
+            CHECK(status == SJSON_OK, "reference %d", i);
+            continue;
+        }
+
+        if (i == 0)
+            RETRY(status, sjson_BeginStringInObject(ctx, "v"));
+        else if (i == 1)
+            RETRY(status, sjson_BeginStringInObjectByKey(ctx, &key_k));
+        else
+            RETRY(status, sjson_BeginStringInArray(ctx));
+        CHECK(status == SJSON_OK, "begin %d: %d", i, (int)status);
+
+        status = append_pieces(ctx, text, length, max_piece);
+        CHECK(status == SJSON_OK, "append %d: %d", i, (int)status);
+
+        RETRY(status, sjson_EndString(ctx));
+        CHECK(status == SJSON_OK, "end string %d: %d", i, (int)status);
+    }
+
+    RETRY(status, sjson_End(ctx));
+    CHECK(status == SJSON_OK, "end: %d", (int)status);
+}
+
+static void test_pieces(bool nonblocking)
+{
+    static char text[MAX_TEXT + 1];
+    static char reference_buffer[1 << 15];
+    char buffer[512];
+    test_sink_t reference;
+    partial_sink_t partial;
+
+    test_sink_init(&reference, 1 << 16);
+    test_sink_init(&partial.sink, 1 << 16);
+
+    for (int iter = 0; iter < 3000; iter++)
+    {
+        size_t length = make_text(text);
+        size_t buffer_size = 24 + (size_t)(test_rand() % (sizeof(buffer) - 23));
+        size_t max_piece = (test_rand() & 1) ? 1 + (size_t)(test_rand() % 4) : 1 + (size_t)(test_rand() % 600);
+        sjson_context_t ctx;
+
+        // Non-blocking, each escaped piece must fit in the buffer
+        if (nonblocking && max_piece > (buffer_size - 8) / 6)
+            max_piece = (buffer_size - 8) / 6;
+
+        reference.length = 0;
+        sjson_InitObject(&ctx, reference_buffer, sizeof(reference_buffer), test_capture, &reference);
+        write_document(&ctx, text, length, max_piece, false);
+
+        partial.sink.length = 0;
+        partial.seed = (uint64_t)iter;
+        sjson_InitObject(&ctx, buffer, buffer_size, test_capture, &partial);
+        if (nonblocking)
+            CHECK(sjson_SetNonBlockingCallback(&ctx, partial_capture) == SJSON_OK, "set callback");
+        write_document(&ctx, text, length, max_piece, true);
+
+        CHECK(test_sink_equals(&partial.sink, reference.data, reference.length),
+              "iter %d nonblocking=%d buffer_size=%zu max_piece=%zu:\n  pieces    %.*s\n  reference %.*s",
+              iter, (int)nonblocking, buffer_size, max_piece, (int)partial.sink.length, partial.sink.data,
+              (int)reference.length, reference.data);
+    }
+
+    // Otherwise the retry path was not exercised
+    CHECK(!nonblocking || would_block > 1000, "only %zu SJSON_WOULD_BLOCK", would_block);
+
+    test_sink_free(&reference);
+    test_sink_free(&partial.sink);
+}
+
+/* '\0' cannot go through AddString but can be appended */
+static void test_nul(void)
+{
+    char buffer[64];
+    test_sink_t sink;
+    sjson_context_t ctx;
+
+    test_sink_init(&sink, 256);
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    sjson_BeginStringInArray(&ctx);
+    CHECK(sjson_AppendString(&ctx, "a\0b", 3) == SJSON_OK, "append NUL");
+    CHECK(sjson_AppendString(&ctx, NULL, 0) == SJSON_OK, "empty append");
+    CHECK(sjson_AppendString(&ctx, NULL, 1) == SJSON_ERROR_INVALID_PARAM, "NULL append");
+    sjson_EndString(&ctx);
+    sjson_End(&ctx);
+    CHECK(test_sink_equals(&sink, "[\"a\\u0000b\"]", 12), "%.*s", (int)sink.length, sink.data);
+    test_sink_free(&sink);
+}
+
+/* Every other writer is refused while a string is open, and has no effect */
+static void test_refused(void)
+{
+    static const char expected[] = "{\"s\":\"ab\",\"n\":1,\"l\":[\"x\",2]}";
+    static sjson_template_op_t ops[2];
+    sjson_template_t tmpl;
+    sjson_value_t value;
+    int64_t ints[2] = { 1, 2 };
+    char buffer[64];
+    test_sink_t sink;
+    sjson_context_t ctx;
+
+    value.i = 1;
+    sjson_TemplateCompile(&tmpl, "\"t\":%i", ops, 2);
+    test_sink_init(&sink, 256);
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+
+    CHECK(sjson_AppendString(&ctx, "x", 1) == SJSON_ERROR_INVALID_STATE, "append before begin");
+    CHECK(sjson_EndString(&ctx) == SJSON_ERROR_INVALID_STATE, "end before begin");
+
+    CHECK(sjson_BeginStringInObject(&ctx, "s") == SJSON_OK, "begin");
+    CHECK(sjson_AppendString(&ctx, "a", 1) == SJSON_OK, "append");
+    CHECK(sjson_AddIntToObject(&ctx, "i", 1) == SJSON_ERROR_INVALID_STATE, "int");
+    CHECK(sjson_AddStringToObject(&ctx, "s", "x") == SJSON_ERROR_INVALID_STATE, "string");
+    CHECK(sjson_AddNumberToObject(&ctx, "d", 1.5) == SJSON_ERROR_INVALID_STATE, "number");
+    CHECK(sjson_AddIntArrayToObject(&ctx, "a", ints, 2) == SJSON_ERROR_INVALID_STATE, "int array");
+    CHECK(sjson_AddArrayToObject(&ctx, "a") == SJSON_ERROR_INVALID_STATE, "array");
+    CHECK(sjson_AddObjectToObject(&ctx, "o") == SJSON_ERROR_INVALID_STATE, "object");
+    CHECK(sjson_AddIntToObjectByKey(&ctx, &key_k, 1) == SJSON_ERROR_INVALID_STATE, "int by key");
+    CHECK(sjson_BeginStringInObject(&ctx, "t") == SJSON_ERROR_INVALID_STATE, "second string");
+    CHECK(sjson_BeginValueInObject(&ctx, "r") == SJSON_ERROR_INVALID_STATE, "raw value");
+    CHECK(sjson_EmitTemplate(&ctx, &tmpl, &value) == SJSON_ERROR_INVALID_STATE, "template");
+    CHECK(sjson_Close(&ctx) == SJSON_ERROR_INVALID_STATE, "close");
+    CHECK(sjson_End(&ctx) == SJSON_ERROR_INVALID_STATE, "end");
+    CHECK(sjson_AppendString(&ctx, "b", 1) == SJSON_OK, "append after refusals");
+    CHECK(sjson_EndString(&ctx) == SJSON_OK, "end string");
+    CHECK(sjson_EndString(&ctx) == SJSON_ERROR_INVALID_STATE, "second end string");
+
+    CHECK(sjson_AddIntToObject(&ctx, "n", 1) == SJSON_OK, "int after string");
+    sjson_AddArrayToObject(&ctx, "l");
+    CHECK(sjson_BeginStringInArray(&ctx) == SJSON_OK, "begin in array");
+    CHECK(sjson_AddIntToArray(&ctx, 1) == SJSON_ERROR_INVALID_STATE, "int in array");
+    CHECK(sjson_AddStringToArray(&ctx, "y") == SJSON_ERROR_INVALID_STATE, "string in array");
+    CHECK(sjson_AddArrayToArray(&ctx) == SJSON_ERROR_INVALID_STATE, "array in array");
+    CHECK(sjson_BeginStringInArray(&ctx) == SJSON_ERROR_INVALID_STATE, "second string in array");
+    sjson_AppendString(&ctx, "x", 1);
+    sjson_EndString(&ctx);
+    CHECK(sjson_AddIntToArray(&ctx, 2) == SJSON_OK, "int after string in array");
+    CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+
+    CHECK(test_sink_equals(&sink, expected, strlen(expected)), "%.*s", (int)sink.length, sink.data);
+    test_sink_free(&sink);
+}
+
+int main(void)
+{
+    sjson_KeyInit(&key_k, "k");
+    test_pieces(false);
+    test_pieces(true);
+    test_nul();
+    test_refused();
+    return test_finish("test_strings");
+}
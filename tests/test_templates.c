@@ -0,0 +1,183 @@
+/**
+ * @file test_templates.c
+ * @brief Compiled templates against the equivalent Add calls
+ *
+ * Every placeholder type is emitted with random values into objects and
+ * arrays, and must give the same bytes as writing the members one by one.
+ */
+
+#include <inttypes.h>
+#include "test_util.h"
+
+static const char object_skeleton[] =
+    "\"i\":%i,\"u\":%u,\"f\":%f,\"g\":%g,\"d\":%d3,\"t\":%t6,"
+    "\"s\":%s,\"r\":%r,\"b\":%b,\"p\":\"100%%\"";
+
+static const char array_skeleton[] = "{\"a\":%i,\"s\":%s}";
+
+static const char *const strings[] = { "plain", "q\"uote\\d\n", "", NULL };
+static const char *const raws[] = { "[1,2]", "{\"x\":null}", "7", NULL };
+
+static double random_double(void)
+{
+    uint64_t bits = test_rand();
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return (d == d) ? d : 0.5;
+}
+
+/* The object template's members, one Add call each */
+static sjson_status_t add_members(sjson_context_t *ctx, const sjson_value_t *v)
+{
+    char digits[24];
+    snprintf(digits, sizeof(digits), "%" PRIu64, v[1].u);
+
+    sjson_AddIntToObject(ctx, "i", v[0].i);
+    sjson_AddRawToObject(ctx, "u", digits);
+    sjson_AddFloatToObject(ctx, "f", v[2].f);
+    sjson_AddNumberToObject(ctx, "g", v[3].d);
+    sjson_AddDecimalToObject(ctx, "d", v[4].i, 3);
+    sjson_AddTimestampToObject(ctx, "t", v[5].i, 6);
+    if (v[6].s)
+        sjson_AddStringToObject(ctx, "s", v[6].s);
+    else
+        sjson_AddRawToObject(ctx, "s", "null");
+    sjson_AddRawToObject(ctx, "r", v[7].s ? v[7].s : "null");
+    sjson_AddRawToObject(ctx, "b", v[8].b ? "true" : "false");
+    return sjson_AddStringToObject(ctx, "p", "100%");
+}
+
+static void test_emit(void)
+{
+    static sjson_template_op_t object_ops[12];
+    static sjson_template_op_t array_ops[3];
+    sjson_template_t object_tmpl, array_tmpl;
+    test_sink_t expected, emitted;
+    char buffer[1024];
+
+    CHECK(sjson_TemplateCompile(&object_tmpl, object_skeleton, object_ops, 12) == SJSON_OK, "compile");
+    CHECK(object_tmpl.hole_count == 9, "hole count %zu", object_tmpl.hole_count);
+    CHECK(sjson_TemplateCompile(&array_tmpl, array_skeleton, array_ops, 3) == SJSON_OK, "compile");
+
+    test_sink_init(&expected, 1 << 16);
+    test_sink_init(&emitted, 1 << 16);
+
+    for (int iter = 0; iter < 5000; iter++)
+    {
+        size_t buffer_size = 32 + (size_t)(test_rand() % 900);
+        int precision = (int)(test_rand() % (SJSON_FLOAT_MAX_PRECISION + 2)) - 1;
+        bool trim = (test_rand() & 1) != 0;
+        int records = 1 + (int)(test_rand() % 4);
+        sjson_value_t v[4][9];
+        sjson_context_t ctx;
+
+        for (int r = 0; r < records; r++)
+        {
+            v[r][0].i = (int64_t)test_rand();
+            v[r][1].u = test_rand() >> (test_rand() % 64);
+            v[r][2].f = (float)((int64_t)(test_rand() % 2000001) - 1000000) / 64.0f;
+            v[r][3].d = random_double();
+            v[r][4].i = (int64_t)test_rand() >> (test_rand() % 64);
+            v[r][5].i = (int64_t)(test_rand() % 4000000000000000000ull);
+            v[r][6].s = strings[test_rand() % 4];
+            v[r][7].s = raws[test_rand() % 4];
+            v[r][8].b = (test_rand() & 1) != 0;
+        }
+
+        // {"first":1,<members>...,"list":[{"a":..,"s":..},...]}
+        for (int mode = 0; mode < 2; mode++)
+        {
+            test_sink_t *sink = mode ? &emitted : &expected;
+            sink->length = 0;
+            sjson_InitObject(&ctx, buffer, buffer_size, test_capture, sink);
+            sjson_SetFloatPrecision(&ctx, precision, trim);
+            sjson_AddIntToObject(&ctx, "first", 1);
+
+            for (int r = 0; r < records; r++)
+            {
+                if (mode)
+                    CHECK(sjson_EmitTemplate(&ctx, &object_tmpl, v[r]) == SJSON_OK, "emit");
+                else
+                    add_members(&ctx, v[r]);
+            }
+
+            sjson_AddArrayToObject(&ctx, "list");
+            for (int r = 0; r < records; r++)
+            {
+                if (mode)
+                {
+                    sjson_value_t item[2];
+                    item[0].i = v[r][0].i;
+                    item[1].s = v[r][6].s;
+                    CHECK(sjson_EmitTemplate(&ctx, &array_tmpl, item) == SJSON_OK, "emit in array");
+                }
+                else
+                {
+                    sjson_AddObjectToArray(&ctx);
+                    sjson_AddIntToObject(&ctx, "a", v[r][0].i);
+                    if (v[r][6].s)
+                        sjson_AddStringToObject(&ctx, "s", v[r][6].s);
+                    else
+                        sjson_AddRawToObject(&ctx, "s", "null");
+                    sjson_Close(&ctx);
+                }
+            }
+            CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+        }
+
+        CHECK(test_sink_equals(&emitted, expected.data, expected.length),
+              "buffer_size=%zu precision=%d:\n  emitted  %.*s\n  expected %.*s", buffer_size, precision,
+              (int)emitted.length, emitted.data, (int)expected.length, expected.data);
+    }
+
+    test_sink_free(&expected);
+    test_sink_free(&emitted);
+}
+
+/* A template can only be emitted where a value or member can be added */
+static void test_emit_state(void)
+{
+    static sjson_template_op_t ops[2];
+    sjson_template_t tmpl;
+    sjson_value_t v[1];
+    char buffer[64];
+    test_sink_t sink;
+    sjson_context_t ctx;
+
+    v[0].i = 5;
+    test_sink_init(&sink, 64);
+    CHECK(sjson_TemplateCompile(&tmpl, "\"n\":%i", ops, 2) == SJSON_OK, "compile");
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_EmitTemplate(&ctx, NULL, v) == SJSON_ERROR_INVALID_PARAM, "NULL template");
+    sjson_End(&ctx);
+    CHECK(sjson_EmitTemplate(&ctx, &tmpl, v) == SJSON_ERROR_INVALID_STATE, "after end");
+    test_sink_free(&sink);
+}
+
+static void test_compile_errors(void)
+{
+    static const char *const invalid[] = { "%x", "%d", "%d19", "%t10", "%", "\"a\":%i%" };
+    sjson_template_op_t ops[8];
+    sjson_template_t tmpl;
+
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        CHECK(sjson_TemplateCompile(&tmpl, invalid[i], ops, 8) == SJSON_ERROR_INVALID_PARAM,
+              "accepted \"%s\"", invalid[i]);
+    }
+
+    // One op per placeholder and per %%, plus one
+    CHECK(sjson_TemplateCompile(&tmpl, "%i,%%,%s", ops, 3) == SJSON_ERROR_INVALID_PARAM, "ops too small");
+    CHECK(sjson_TemplateCompile(&tmpl, "%i,%%,%s", ops, 4) == SJSON_OK, "ops exact");
+    CHECK(sjson_TemplateCompile(&tmpl, "%d18%t9", ops, 8) == SJSON_OK, "max params");
+    CHECK(sjson_TemplateCompile(&tmpl, "", ops, 1) == SJSON_OK && tmpl.hole_count == 0, "empty");
+    CHECK(sjson_TemplateCompile(NULL, "", ops, 1) == SJSON_ERROR_INVALID_PARAM, "NULL template");
+}
+
+int main(void)
+{
+    test_emit();
+    test_emit_state();
+    test_compile_errors();
+    return test_finish("test_templates");
+}
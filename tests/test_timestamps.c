@@ -0,0 +1,168 @@
+/**
+ * @file test_timestamps.c
+ * @brief Timestamp writers against gmtime
+ *
+ * Runs of timestamps, many within the same second so the cached date and
+ * time are reused while the precision changes, others jumping across the
+ * whole int64 nanosecond range (1677..2262, negative epochs included),
+ * must match gmtime_r() with the fraction truncated.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <inttypes.h>
+#include <time.h>
+#include "test_util.h"
+
+#define RUN 64
+
+static char expected[RUN * 40 + 64];
+static sjson_key_t key_t3;
+
+/* "YYYY-MM-DDTHH:MM:SS[.fff]Z" with quotes, via gmtime_r() */
+static size_t print_timestamp(char *out, int64_t epoch_ns, unsigned precision)
+{
+    // Floor division: the fraction counts forward from the second before
+    int64_t second = epoch_ns / 1000000000;
+    int64_t nanos = epoch_ns % 1000000000;
+    if (nanos < 0)
+    {
+        nanos += 1000000000;
+        second--;
+    }
+
+    time_t t = (time_t)second;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+
+    size_t n = strftime(out, 32, "\"%Y-%m-%dT%H:%M:%S", &tm);
+    if (precision > 0)
+    {
+        int64_t divisor = 1;
+        for (unsigned i = precision; i < 9; i++)
+            divisor *= 10;
+        n += (size_t)sprintf(out + n, ".%0*" PRId64, (int)precision, nanos / divisor);
+    }
+    out[n++] = 'Z';
+    out[n++] = '"';
+    return n;
+}
+
+static int64_t random_epoch(void)
+{
+    static const int64_t edges[] = { 0, -1, 1, -1000000000, 999999999, INT64_MIN, INT64_MAX,
+                                     INT64_MIN + 999999999, 951782400000000000 /* 2000-02-29 */ };
+    if (test_rand() % 16 == 0)
+        return edges[test_rand() % (sizeof(edges) / sizeof(edges[0]))];
+    return (int64_t)test_rand();
+}
+
+static void test_runs(void)
+{
+    test_sink_t sink;
+
+    test_sink_init(&sink, sizeof(expected));
+
+    for (int iter = 0; iter < 20000; iter++)
+    {
+        size_t buffer_size = 40 + (size_t)(test_rand() % 300);
+        char *buffer = malloc(buffer_size);
+        int64_t epoch = random_epoch();
+        sjson_context_t ctx;
+        size_t n = 0;
+
+        // {"t":[...],"u":ts,"t3":ts}
+        sink.length = 0;
+        sjson_InitObject(&ctx, buffer, buffer_size, test_capture, &sink);
+        sjson_AddArrayToObject(&ctx, "t");
+        n += (size_t)sprintf(expected, "{\"t\":[");
+
+        for (int i = 0; i < RUN; i++)
+        {
+            unsigned precision = (unsigned)(test_rand() % 10);
+            uint64_t step = test_rand() % 8;
+
+            // Mostly within the same second, sometimes to a neighbour or anywhere
+            bool inside = epoch > INT64_MIN + 2000000000 && epoch < INT64_MAX - 2000000000;
+            int64_t floor_ns = ((epoch % 1000000000) + 1000000000) % 1000000000;
+            if (inside && step < 5)
+                epoch = epoch - floor_ns + (int64_t)(test_rand() % 1000000000);
+            else if (inside && step == 5)
+                epoch += 1000000000;
+            else if (inside && step == 6)
+                epoch -= 1000000000;
+            else
+                epoch = random_epoch();
+
+            CHECK(sjson_AddTimestampToArray(&ctx, epoch, precision) == SJSON_OK, "timestamp");
+            if (i)
+                expected[n++] = ',';
+            n += print_timestamp(expected + n, epoch, precision);
+        }
+        sjson_Close(&ctx);
+
+        CHECK(sjson_AddTimestampToObject(&ctx, "u", epoch, 9) == SJSON_OK, "in object");
+        CHECK(sjson_AddTimestampToObjectByKey(&ctx, &key_t3, epoch, 3) == SJSON_OK, "by key");
+        CHECK(sjson_End(&ctx) == SJSON_OK, "end");
+        n += (size_t)sprintf(expected + n, "],\"u\":");
+        n += print_timestamp(expected + n, epoch, 9);
+        n += (size_t)sprintf(expected + n, ",\"t3\":");
+        n += print_timestamp(expected + n, epoch, 3);
+        expected[n++] = '}';
+
+        CHECK(test_sink_equals(&sink, expected, n), "buffer_size=%zu:\n  got      %.*s\n  expected %.*s",
+              buffer_size, (int)sink.length, sink.data, (int)n, expected);
+        free(buffer);
+    }
+
+    test_sink_free(&sink);
+}
+
+static void test_edges(void)
+{
+    static const struct {
+        int64_t epoch_ns;
+        unsigned precision;
+        const char *text;
+    } cases[] = {
+        { 0, 0, "\"1970-01-01T00:00:00Z\"" },  // The first second after Init
+        { -1, 9, "\"1969-12-31T23:59:59.999999999Z\"" },
+        { -1, 3, "\"1969-12-31T23:59:59.999Z\"" },
+        { -1000000000, 1, "\"1969-12-31T23:59:59.0Z\"" },
+        { INT64_MIN, 9, "\"1677-09-21T00:12:43.145224192Z\"" },
+        { INT64_MAX, 9, "\"2262-04-11T23:47:16.854775807Z\"" },
+        { 951782400123456789, 6, "\"2000-02-29T00:00:00.123456Z\"" },
+    };
+    char buffer[64];
+    test_sink_t sink;
+    sjson_context_t ctx;
+
+    test_sink_init(&sink, 256);
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        sink.length = 0;
+        sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+        sjson_AddTimestampToArray(&ctx, cases[i].epoch_ns, cases[i].precision);
+        sjson_End(&ctx);
+        CHECK(sink.length == strlen(cases[i].text) + 2 &&
+              memcmp(sink.data + 1, cases[i].text, sink.length - 2) == 0,
+              "%s: %.*s", cases[i].text, (int)sink.length, sink.data);
+    }
+
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), test_capture, &sink);
+    CHECK(sjson_AddTimestampToArray(&ctx, 0, 10) == SJSON_ERROR_INVALID_PARAM, "precision 10");
+    test_sink_free(&sink);
+}
+
+int main(void)
+{
+    if (sizeof(time_t) < 8)
+    {
+        printf("32-bit time_t, no reference\n");
+        return TEST_SKIP;
+    }
+
+    sjson_KeyInit(&key_t3, "t3");
+    test_runs();
+    test_edges();
+    return test_finish("test_timestamps");
+}
@@ -0,0 +1,170 @@
+/**
+ * @file test_util.h
+ * @brief Shared helpers for the stream_json tests
+ *
+ * Each test is a standalone program: it counts failed checks, prints the
+ * first few and exits non-zero if any failed. Exit code 77 marks a test
+ * as skipped (e.g. the CPU lacks the instruction set it was built for).
+ */
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stream_json.h"
+
+#define TEST_SKIP 77
+
+static int test_failures;
+
+#define CHECK(cond, ...)                                               \
+    do                                                                 \
+    {                                                                  \
+        if (!(cond))                                                   \
+        {                                                              \
+            if (test_failures++ < 20)                                  \
+            {                                                          \
+                printf("%s:%d: check failed: ", __FILE__, __LINE__);   \
+                printf(__VA_ARGS__);                                   \
+                printf("\n");                                          \
+            }                                                          \
+        }                                                              \
+    } while (0)
+
+/* Print the result and return the exit code for main() */
+static inline int test_finish(const char *name)
+{
+    if (test_failures > 0)
+    {
+        printf("%s: %d check(s) failed\n", name, test_failures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+/* Deterministic xorshift64, so failures reproduce */
+static uint64_t test_rng_state = 0x9E3779B97F4A7C15ull;
+
+static inline uint64_t test_rand(void)
+{
+    test_rng_state ^= test_rng_state << 13;
+    test_rng_state ^= test_rng_state >> 7;
+    test_rng_state ^= test_rng_state << 17;
+    return test_rng_state;
+}
+
+/* ========================================================================
+ * Capture Sink
+ * ======================================================================== */
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    size_t calls;
+} test_sink_t;
+
+static inline void test_sink_init(test_sink_t *sink, size_t capacity)
+{
+    sink->data = malloc(capacity);
+    sink->length = 0;
+    sink->capacity = capacity;
+    sink->calls = 0;
+    if (!sink->data)
+    {
+        printf("out of memory\n");
+        exit(1);
+    }
+}
+
+static inline void test_sink_free(test_sink_t *sink)
+{
+    free(sink->data);
+    sink->data = NULL;
+}
+
+static inline bool test_sink_append(test_sink_t *sink, const char *data, size_t length)
+{
+    if (length > sink->capacity - sink->length)
+    {
+        return false;
+    }
+    memcpy(sink->data + sink->length, data, length);
+    sink->length += length;
+    return true;
+}
+
+/* sjson_send_callback_t appending to the test_sink_t in user_data */
+static inline bool test_capture(const char *buffer, size_t length, void *user_data)
+{
+    test_sink_t *sink = (test_sink_t *)user_data;
+    sink->calls++;
+    return test_sink_append(sink, buffer, length);
+}
+
+/* True if the sink holds exactly the expected bytes */
+static inline bool test_sink_equals(const test_sink_t *sink, const char *expected, size_t length)
+{
+    return sink->length == length && memcmp(sink->data, expected, length) == 0;
+}
+
+/*
+ * Decode HTTP/1.1 chunked transfer coding in place. Returns the payload
+ * length, or (size_t)-1 if the framing is malformed or the terminating
+ * zero-size chunk is missing.
+ */
+static inline size_t test_dechunk(char *data, size_t length)
+{
+    size_t in = 0;
+    size_t out = 0;
+    for (;;)
+    {
+        char *end;
+        if (in >= length)
+        {
+            return (size_t)-1;
+        }
+        unsigned long size = strtoul(data + in, &end, 16);
+        size_t header = (size_t)(end - (data + in));
+        if (header == 0 || in + header + 2 > length || end[0] != '\r' || end[1] != '\n')
+        {
+            return (size_t)-1;
+        }
+        in += header + 2;
+        if (size > length - in || length - in - size < 2 ||
+            data[in + size] != '\r' || data[in + size + 1] != '\n')
+        {
+            return (size_t)-1;
+        }
+        if (size == 0)
+        {
+            return (in + 2 == length) ? out : (size_t)-1;
+        }
+        memmove(data + out, data + in, size);
+        out += size;
+        in += size + 2;
+    }
+}
+
+/* ========================================================================
+ * Instruction Set Check
+ * Tests built for a wider instruction set than the default skip themselves
+ * when the CPU running them does not have it.
+ * ======================================================================== */
+
+static inline bool test_isa_supported(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#if defined(__AVX2__)
+    return __builtin_cpu_supports("avx2");
+#elif defined(__SSSE3__)
+    return __builtin_cpu_supports("ssse3");
+#endif
+#endif
+    return true;
+}
+
+#endif /* TEST_UTIL_H */
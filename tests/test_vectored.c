@@ -0,0 +1,189 @@
+/**
+ * @file test_vectored.c
+ * @brief Vectored callback (sjson_SetVectoredCallback)
+ *
+ * Once a vectored callback is set it receives all output and the plain
+ * callback none. Documents must match the plain callback byte for byte;
+ * a flush that passes a large value through arrives as one call with the
+ * buffered bytes and the caller's value as separate spans (plus the frame
+ * trailer with a framer). Setting NULL goes back to the plain callback.
+ */
+
+#include "test_util.h"
+#include "test_document.h"
+
+#define MAX_CALLS 16
+
+typedef struct {
+    test_sink_t sink;
+    size_t plain_calls;
+    size_t span_counts[MAX_CALLS];
+    sjson_iovec_t spans[MAX_CALLS][3];
+    bool fail;
+} vectored_sink_t;
+
+static bool capture_vectored(const sjson_iovec_t *iov, size_t iovcnt, void *user_data)
+{
+    vectored_sink_t *vec = (vectored_sink_t *)user_data;
+    size_t call = vec->sink.calls++;
+
+    CHECK(iovcnt >= 1 && iovcnt <= 3, "%zu spans", iovcnt);
+    if (call < MAX_CALLS)
+    {
+        vec->span_counts[call] = iovcnt;
+        memcpy(vec->spans[call], iov, (iovcnt <= 3 ? iovcnt : 3) * sizeof(sjson_iovec_t));
+    }
+    if (vec->fail)
+        return false;
+
+    for (size_t i = 0; i < iovcnt; i++)
+    {
+        if (!test_sink_append(&vec->sink, (const char *)iov[i].base, iov[i].len))
+            return false;
+    }
+    return true;
+}
+
+/* The plain callback given to Init, counted separately */
+static bool capture_plain(const char *buffer, size_t length, void *user_data)
+{
+    vectored_sink_t *vec = (vectored_sink_t *)user_data;
+    vec->plain_calls++;
+    return test_sink_append(&vec->sink, buffer, length);
+}
+
+static void vectored_reset(vectored_sink_t *vec)
+{
+    vec->sink.length = 0;
+    vec->sink.calls = 0;
+    vec->plain_calls = 0;
+    vec->fail = false;
+}
+
+static void test_documents(void)
+{
+    char buffer[1024];
+    test_sink_t reference;
+    vectored_sink_t vec;
+
+    test_sink_init(&reference, 1 << 20);
+    test_sink_init(&vec.sink, 1 << 20);
+
+    for (uint64_t seed = 1; seed <= 1000; seed++)
+    {
+        size_t buffer_size = 32 + (size_t)(test_hash(seed + 5) % 900);
+        test_document_t doc;
+        sjson_context_t ctx;
+
+        test_document_init(&doc, seed, 200);
+        reference.length = 0;
+        test_document_begin(&doc, &ctx, buffer, buffer_size, test_capture, &reference);
+        CHECK(test_document_write(&doc, &ctx) == SJSON_OK, "reference seed=%llu", (unsigned long long)seed);
+
+        test_document_init(&doc, seed, 200);
+        vectored_reset(&vec);
+        test_document_begin(&doc, &ctx, buffer, buffer_size, capture_plain, &vec);
+        CHECK(sjson_SetVectoredCallback(&ctx, capture_vectored) == SJSON_OK, "set callback");
+        CHECK(test_document_write(&doc, &ctx) == SJSON_OK, "vectored seed=%llu", (unsigned long long)seed);
+
+        CHECK(vec.plain_calls == 0, "seed=%llu: %zu plain calls", (unsigned long long)seed, vec.plain_calls);
+        CHECK(test_sink_equals(&vec.sink, reference.data, reference.length), "seed=%llu differs",
+              (unsigned long long)seed);
+
+        // Nothing here is large enough to pass through: one span per flush
+        for (size_t i = 0; i < vec.sink.calls && i < MAX_CALLS; i++)
+        {
+            CHECK(vec.span_counts[i] == 1 && vec.spans[i][0].base == buffer, "seed=%llu call %zu: %zu spans",
+                  (unsigned long long)seed, i, vec.span_counts[i]);
+        }
+    }
+
+    test_sink_free(&reference);
+    test_sink_free(&vec.sink);
+}
+
+/* A passed-through value: buffered bytes and value in one call */
+static void test_passthrough(void)
+{
+    static char value[200 + 1];
+    char buffer[64];
+    char framed_buffer[128];
+    char expected[sizeof(value) + 8];
+    vectored_sink_t vec;
+    sjson_context_t ctx;
+
+    memset(value, '7', sizeof(value) - 1);
+    value[sizeof(value) - 1] = '\0';
+    size_t n = (size_t)sprintf(expected, "{\"k\":%s}", value);
+    test_sink_init(&vec.sink, 4096);
+
+    vectored_reset(&vec);
+    sjson_InitObject(&ctx, buffer, sizeof(buffer), capture_plain, &vec);
+    sjson_SetVectoredCallback(&ctx, capture_vectored);
+    CHECK(sjson_AddRawToObject(&ctx, "k", value) == SJSON_OK, "raw");
+    CHECK(vec.sink.calls == 1 && vec.span_counts[0] == 2, "%zu calls, %zu spans", vec.sink.calls,
+          vec.span_counts[0]);
+    CHECK(vec.spans[0][0].base == buffer && vec.spans[0][0].len == 5, "buffered span");
+    CHECK(vec.spans[0][1].base == value && vec.spans[0][1].len == sizeof(value) - 1, "value span");
+    sjson_End(&ctx);
+    CHECK(vec.plain_calls == 0 && test_sink_equals(&vec.sink, expected, n), "%.*s", (int)vec.sink.length,
+          vec.sink.data);
+
+    // Chunked: header and buffered bytes, the value, then the chunk trailer
+    vectored_reset(&vec);
+    sjson_InitObject(&ctx, framed_buffer, sizeof(framed_buffer), capture_plain, &vec);
+    sjson_SetVectoredCallback(&ctx, capture_vectored);
+    sjson_SetFramer(&ctx, &sjson_framer_chunked);
+    CHECK(sjson_AddRawToObject(&ctx, "k", value) == SJSON_OK, "framed raw");
+    CHECK(vec.sink.calls == 1 && vec.span_counts[0] == 3, "framed: %zu calls, %zu spans", vec.sink.calls,
+          vec.span_counts[0]);
+    CHECK(vec.spans[0][1].base == value && vec.spans[0][2].len == 2 &&
+          memcmp(vec.spans[0][2].base, "\r\n", 2) == 0, "framed spans");
+    sjson_End(&ctx);
+    size_t length = test_dechunk(vec.sink.data, vec.sink.length);
+    CHECK(length == n && memcmp(vec.sink.data, expected, n) == 0, "framed: %zu bytes", length);
+    test_sink_free(&vec.sink);
+}
+
+static void test_switching(void)
+{
+    char buffer[64];
+    vectored_sink_t vec;
+    sjson_context_t ctx;
+
+    test_sink_init(&vec.sink, 256);
+    vectored_reset(&vec);
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), capture_plain, &vec);
+
+    CHECK(sjson_SetVectoredCallback(NULL, capture_vectored) == SJSON_ERROR_INVALID_PARAM, "NULL context");
+    sjson_SetVectoredCallback(&ctx, capture_vectored);
+    sjson_AddIntToArray(&ctx, 1);
+    sjson_Flush(&ctx);
+    CHECK(vec.sink.calls == 1 && vec.plain_calls == 0, "vectored flush");
+
+    // Back to the plain callback
+    CHECK(sjson_SetVectoredCallback(&ctx, NULL) == SJSON_OK, "unset");
+    sjson_AddIntToArray(&ctx, 2);
+    sjson_End(&ctx);
+    CHECK(vec.sink.calls == 1 && vec.plain_calls == 1, "plain after unset: %zu", vec.plain_calls);
+    CHECK(test_sink_equals(&vec.sink, "[1,2]", 5), "%.*s", (int)vec.sink.length, vec.sink.data);
+
+    // A failing vectored callback fails the flush
+    vectored_reset(&vec);
+    sjson_InitArray(&ctx, buffer, sizeof(buffer), capture_plain, &vec);
+    sjson_SetVectoredCallback(&ctx, capture_vectored);
+    vec.fail = true;
+    sjson_AddIntToArray(&ctx, 1);
+    CHECK(sjson_Flush(&ctx) == SJSON_ERROR_BUFFER_FULL, "failing flush");
+    CHECK(vec.plain_calls == 0, "plain callback after failure");
+    test_sink_free(&vec.sink);
+}
+
+int main(void)
+{
+    test_document_setup();
+    test_documents();
+    test_passthrough();
+    test_switching();
+    return test_finish("test_vectored");
+}
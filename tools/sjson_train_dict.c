@@ -0,0 +1,329 @@
+/**
+ * @file sjson_train_dict.c
+ * @brief Train a preset deflate dictionary from captured JSON output
+ *
+ * Host tool for sjson_DeflateSetDictionary(). Each input file holds captured
+ * documents, one per line (the writer emits no newlines). Documents of a
+ * recurring shape share their keys and punctuation; numbers differ. The
+ * tool splits every document at digit runs, scores each remaining fragment
+ * by how many documents contain it times its length, and packs the best
+ * fragments into the dictionary with the most valuable ones last (deflate
+ * reaches the end of the dictionary with the shortest distances).
+ *
+ * Usage: sjson_train_dict [-s size] [-c name] dict_file captures...
+ *   -s size  Dictionary size in bytes (default 1024, at most 32768)
+ *   -c name  Write a C array named name instead of raw bytes
+ *
+ * Compile: gcc sjson_train_dict.c -lz -o sjson_train_dict
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <zlib.h>
+
+#define MIN_FRAGMENT 3
+#define MAX_DICT 32768
+
+typedef struct {
+    const char *data;
+    size_t length;
+} span_t;
+
+typedef struct {
+    span_t text;
+    size_t documents;     /* Documents containing the fragment */
+    size_t last_document; /* To count each document once */
+    size_t score;
+} fragment_t;
+
+static fragment_t *fragments;
+static size_t fragment_count;
+static size_t fragment_capacity;
+
+/* Open-addressing index into fragments[], sized to a power of two */
+static size_t *slots;
+static size_t slot_mask;
+
+static void *xrealloc(void *p, size_t size)
+{
+    p = realloc(p, size);
+    if (!p)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+static size_t hash_span(const char *s, size_t n)
+{
+    size_t h = 14695981039346656037u;
+    for (size_t i = 0; i < n; i++)
+    {
+        h = (h ^ (unsigned char)s[i]) * 1099511628211u;
+    }
+    return h;
+}
+
+static void grow_slots(void)
+{
+    size_t count = (slot_mask + 1) * 2;
+    free(slots);
+    slots = xrealloc(NULL, count * sizeof(*slots));
+    memset(slots, 0xff, count * sizeof(*slots));
+    slot_mask = count - 1;
+
+    for (size_t f = 0; f < fragment_count; f++)
+    {
+        size_t i = hash_span(fragments[f].text.data, fragments[f].text.length) & slot_mask;
+        while (slots[i] != (size_t)-1)
+        {
+            i = (i + 1) & slot_mask;
+        }
+        slots[i] = f;
+    }
+}
+
+static void add_fragment(const char *s, size_t n, size_t document)
+{
+    if (fragment_count * 2 >= slot_mask + 1)
+    {
+        grow_slots();
+    }
+
+    size_t i = hash_span(s, n) & slot_mask;
+    while (slots[i] != (size_t)-1)
+    {
+        fragment_t *f = &fragments[slots[i]];
+        if (f->text.length == n && memcmp(f->text.data, s, n) == 0)
+        {
+            if (f->last_document != document)
+            {
+                f->documents++;
+                f->last_document = document;
+            }
+            return;
+        }
+        i = (i + 1) & slot_mask;
+    }
+
+    if (fragment_count == fragment_capacity)
+    {
+        fragment_capacity = fragment_capacity ? fragment_capacity * 2 : 1024;
+        fragments = xrealloc(fragments, fragment_capacity * sizeof(*fragments));
+    }
+
+    fragment_t *f = &fragments[fragment_count];
+    f->text.data = s;
+    f->text.length = n;
+    f->documents = 1;
+    f->last_document = document;
+    slots[i] = fragment_count++;
+}
+
+static int by_score_desc(const void *a, const void *b)
+{
+    const fragment_t *fa = (const fragment_t *)a;
+    const fragment_t *fb = (const fragment_t *)b;
+    return (fa->score < fb->score) - (fa->score > fb->score);
+}
+
+static char *read_file(const char *path, size_t *length)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        exit(1);
+    }
+
+    char *data = NULL;
+    size_t used = 0, capacity = 0, n;
+    do
+    {
+        if (used == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 65536;
+            data = xrealloc(data, capacity);
+        }
+        n = fread(data + used, 1, capacity - used, f);
+        used += n;
+    } while (n > 0);
+
+    fclose(f);
+    *length = used;
+    return data;
+}
+
+/* Raw deflate size of one document, with or without the dictionary */
+static size_t compressed_size(span_t doc, const char *dict, size_t dict_length)
+{
+    static unsigned char out[65536];
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    deflateInit2(&strm, 9, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    if (dict_length > 0)
+    {
+        deflateSetDictionary(&strm, (const Bytef *)dict, (uInt)dict_length);
+    }
+
+    size_t total = 0;
+    int ret;
+    strm.next_in = (Bytef *)doc.data;
+    strm.avail_in = (uInt)doc.length;
+    do
+    {
+        strm.next_out = out;
+        strm.avail_out = sizeof(out);
+        ret = deflate(&strm, Z_FINISH);
+        total += sizeof(out) - strm.avail_out;
+    } while (ret != Z_STREAM_END);
+
+    deflateEnd(&strm);
+    return total;
+}
+
+static void write_dictionary(FILE *f, const char *dict, size_t length, const char *name)
+{
+    if (!name)
+    {
+        fwrite(dict, 1, length, f);
+        return;
+    }
+
+    fprintf(f, "/* Generated by sjson_train_dict */\n");
+    fprintf(f, "static const char %s[%zu] = {", name, length);
+    for (size_t i = 0; i < length; i++)
+    {
+        fprintf(f, "%s0x%02x,", (i % 12 == 0) ? "\n    " : " ", (unsigned char)dict[i]);
+    }
+    fprintf(f, "\n};\n");
+}
+
+int main(int argc, char **argv)
+{
+    size_t dict_size = 1024;
+    const char *name = NULL;
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; arg += 2)
+    {
+        if (arg + 1 >= argc)
+            break;
+        if (strcmp(argv[arg], "-s") == 0)
+            dict_size = strtoul(argv[arg + 1], NULL, 10);
+        else if (strcmp(argv[arg], "-c") == 0)
+            name = argv[arg + 1];
+        else
+            break;
+    }
+
+    if (argc - arg < 2 || dict_size == 0 || dict_size > MAX_DICT)
+    {
+        fprintf(stderr, "usage: %s [-s size] [-c name] dict_file captures...\n", argv[0]);
+        return 1;
+    }
+    const char *dict_path = argv[arg++];
+
+    // Collect documents, one per line
+    span_t *docs = NULL;
+    size_t doc_count = 0, doc_capacity = 0, input_bytes = 0;
+    for (; arg < argc; arg++)
+    {
+        size_t length;
+        char *data = read_file(argv[arg], &length);
+        for (size_t start = 0, end; start < length; start = end + 1)
+        {
+            const char *nl = memchr(data + start, '\n', length - start);
+            end = nl ? (size_t)(nl - data) : length;
+            if (end == start)
+                continue;
+            if (doc_count == doc_capacity)
+            {
+                doc_capacity = doc_capacity ? doc_capacity * 2 : 256;
+                docs = xrealloc(docs, doc_capacity * sizeof(*docs));
+            }
+            docs[doc_count].data = data + start;
+            docs[doc_count].length = end - start;
+            doc_count++;
+            input_bytes += end - start;
+        }
+    }
+
+    if (doc_count == 0)
+    {
+        fprintf(stderr, "no documents found\n");
+        return 1;
+    }
+
+    // Fragments between digit runs: keys, punctuation, constant strings
+    slot_mask = 1023;
+    slots = xrealloc(NULL, (slot_mask + 1) * sizeof(*slots));
+    memset(slots, 0xff, (slot_mask + 1) * sizeof(*slots));
+    for (size_t d = 0; d < doc_count; d++)
+    {
+        const char *s = docs[d].data;
+        size_t n = docs[d].length;
+        size_t i = 0;
+        while (i < n)
+        {
+            size_t start = i;
+            while (i < n && !isdigit((unsigned char)s[i]))
+                i++;
+            if (i - start >= MIN_FRAGMENT)
+                add_fragment(s + start, i - start, d);
+            while (i < n && isdigit((unsigned char)s[i]))
+                i++;
+        }
+    }
+
+    // Fragments seen in a single document are not worth dictionary space
+    for (size_t f = 0; f < fragment_count; f++)
+    {
+        fragments[f].score = (doc_count > 1 && fragments[f].documents < 2)
+            ? 0 : fragments[f].documents * fragments[f].text.length;
+    }
+    qsort(fragments, fragment_count, sizeof(*fragments), by_score_desc);
+
+    // Pick the best that fit, then lay them out best-last
+    char *dict = xrealloc(NULL, dict_size);
+    size_t picked = 0, dict_length = 0;
+    for (size_t f = 0; f < fragment_count && fragments[f].score > 0; f++)
+    {
+        if (dict_length + fragments[f].text.length <= dict_size)
+        {
+            fragments[picked++] = fragments[f];
+            dict_length += fragments[f].text.length;
+        }
+    }
+    size_t pos = 0;
+    while (picked > 0)
+    {
+        span_t t = fragments[--picked].text;
+        memcpy(dict + pos, t.data, t.length);
+        pos += t.length;
+    }
+
+    FILE *out = fopen(dict_path, name ? "w" : "wb");
+    if (!out)
+    {
+        perror(dict_path);
+        return 1;
+    }
+    write_dictionary(out, dict, dict_length, name);
+    fclose(out);
+
+    // Report the effect per document, as sent with sjson_DeflateAttach()
+    size_t plain = 0, primed = 0;
+    for (size_t d = 0; d < doc_count; d++)
+    {
+        plain += compressed_size(docs[d], NULL, 0);
+        primed += compressed_size(docs[d], dict, dict_length);
+    }
+    printf("%zu documents, %zu bytes, dictionary %zu bytes\n", doc_count, input_bytes, dict_length);
+    printf("per-document raw deflate: %zu bytes without, %zu bytes with dictionary\n", plain, primed);
+
+    return 0;
+}